@@ -0,0 +1,26 @@
+#ifndef ALERTS_HPP
+#define ALERTS_HPP
+
+#include "db.hpp"
+#include <map>
+
+// A product whose quantity is below its reorder level
+struct StockAlert {
+    int productId;
+    std::string name;
+    int quantity;
+    int reorderLevel;
+};
+
+// Load the current below-threshold set once (partial index, no table scan) and
+// keep it up to date from product change notifications.
+void initAlerts();
+void shutdownAlerts();
+
+// Active alerts ordered by product ID
+const std::map<int, StockAlert> &getStockAlerts();
+
+// Bumped whenever the alert set changes, so panels can cache derived data
+unsigned getAlertsRevision();
+
+#endif // ALERTS_HPP
@@ -0,0 +1,49 @@
+#ifndef ALLOCATION_HPP
+#define ALLOCATION_HPP
+
+#include <string>
+#include <vector>
+
+// First-expired-first-out allocation from lots. Each product's usable lots
+// are kept in a binary heap ordered by expiry date, loaded from the
+// database the first time the product is allocated and reused while the
+// product's row version says nothing else changed it. Taking a lot off the
+// top is O(log n) in the product's lot count, and a partly used lot stays
+// on top without reordering.
+struct LotPick {
+    int lotId;
+    std::string code;
+    std::string expires;
+    int quantity;
+};
+
+// Allocate quantity units of a product, earliest expiry first. Lots that
+// expired before today (YYYY-MM-DD) are never picked. All or nothing: if
+// the unexpired lots cannot cover the line, nothing is taken and false is
+// returned. Picks are appended and the lots are decremented in the
+// database, inside the caller's transaction if there is one.
+bool allocateFefo(int productId, int quantity, const std::string &today, std::vector<LotPick> &picks);
+
+// Units allocateFefo could take right now (unexpired lots only)
+long long availableUnits(int productId, const std::string &today);
+
+// Drop every cached heap, e.g. after the database was replaced
+void clearLotQueues();
+
+// The local date as YYYY-MM-DD
+std::string todayDate();
+
+// Throughput of the batch allocator against querying lots in expiry order
+// for every line, on a scratch catalogue with `lots` lots per product
+struct AllocationBenchOptions {
+    std::string dbPath = "fefo-bench.db"; // recreated, then removed
+    int rows = 1000;
+    int lots = 20;
+    int lines = 100000;
+    int batch = 1000;                     // order lines per transaction
+};
+
+// Prints lines/s per method; non-zero if the units do not add up
+int runAllocationBench(const AllocationBenchOptions &options);
+
+#endif // ALLOCATION_HPP
@@ -0,0 +1,47 @@
+#ifndef AUDIT_HPP
+#define AUDIT_HPP
+
+#include "money.hpp"
+#include <string>
+#include <vector>
+
+// One recorded product change
+struct AuditEntry {
+    long long changedAt; // Unix time in milliseconds
+    std::string user;
+    std::string source;  // "gui", "cli", "api"
+    int productId;
+    std::string action;  // "add", "update", "delete"
+    std::string name;
+    int oldQuantity;
+    int newQuantity;
+    Money oldPrice;
+    Money newPrice;
+};
+
+// Audit trail of every product change, written to its own database next to
+// the inventory (<dbPath>.audit) so it never contends for the inventory's
+// write lock. Change notifications only push onto a lock-free queue; a
+// background thread writes them in batched transactions.
+bool initAudit(const std::string &dbPath, const std::string &source);
+// Writes everything still queued before returning
+void shutdownAudit();
+
+// Block until every change made so far has been written (or given up on:
+// a batch that still fails after a few retries is counted as lost, and
+// shutdownAudit() reports how many records were)
+void flushAudit();
+
+// Most recent first. Flushes pending records so the result is complete.
+std::vector<AuditEntry> getProductHistory(int productId, int limit = 200);
+
+struct AuditStats {
+    long long queued;   // records handed to the writer
+    long long written;  // committed to the audit file
+    long long lost;     // dropped after repeated write failures
+    int batches;
+    double lastBatchMs;
+};
+AuditStats getAuditStats();
+
+#endif // AUDIT_HPP
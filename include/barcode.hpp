@@ -0,0 +1,37 @@
+#ifndef BARCODE_HPP
+#define BARCODE_HPP
+
+#include <deque>
+#include <string>
+
+// In-memory barcode -> product ID map, loaded once from the SKU index and
+// kept current from product change notifications. Lookups are O(1).
+void initBarcodeIndex();
+void shutdownBarcodeIndex();
+
+// Product ID for a scanned code, or -1
+int findProductByCode(const std::string &code);
+
+// Scanner input. Keyboard-wedge scanners "type" the code followed by Enter;
+// in scan mode those keystrokes are fed here instead of to the widgets.
+struct ScanResult {
+    std::string code;
+    int productId;   // -1 if the code is unknown
+    int delta;
+    int newQuantity;
+    bool applied;
+};
+
+void setScanMode(bool enabled);
+bool isScanMode();
+
+void feedScanText(const char *text); // characters of the code being typed
+void completeScan();                 // Enter: queue the buffered code
+
+// Apply all queued scans in one transaction; returns how many were applied
+int applyPendingScans(int delta);
+
+// Most recent scans first (bounded)
+const std::deque<ScanResult> &getRecentScans();
+
+#endif // BARCODE_HPP
@@ -0,0 +1,75 @@
+#ifndef BITMAP_HPP
+#define BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of 32-bit integers (product IDs), organised like a Roaring
+// bitmap: values are grouped by their upper 16 bits, and each group is
+// stored either as a sorted array of the lower halves (sparse, at most 4096
+// entries) or as a 65536-bit bitset (dense). AND/OR work group by group, so
+// their cost depends on the stored data rather than on the largest ID.
+class RoaringBitmap
+{
+public:
+    void add(uint32_t value);
+    void remove(uint32_t value);
+    bool contains(uint32_t value) const;
+
+    uint64_t cardinality() const;
+    bool empty() const { return containers.empty(); }
+    void clear() { containers.clear(); }
+
+    RoaringBitmap &operator&=(const RoaringBitmap &other);
+    RoaringBitmap &operator|=(const RoaringBitmap &other);
+    friend RoaringBitmap operator&(RoaringBitmap a, const RoaringBitmap &b) { return a &= b; }
+    friend RoaringBitmap operator|(RoaringBitmap a, const RoaringBitmap &b) { return a |= b; }
+
+    // |a AND b| without building the intersection
+    static uint64_t andCardinality(const RoaringBitmap &a, const RoaringBitmap &b);
+
+    // Calls f(value) in ascending order
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (const Container &c : containers)
+        {
+            uint32_t high = (uint32_t)c.key << 16;
+            if (c.isBitset())
+            {
+                for (size_t w = 0; w < c.bits.size(); ++w)
+                    for (uint64_t word = c.bits[w]; word; word &= word - 1)
+                        f(high | (uint32_t)(w * 64 + countTrailingZeros(word)));
+            }
+            else
+            {
+                for (uint16_t low : c.array)
+                    f(high | low);
+            }
+        }
+    }
+
+    // Approximate heap usage
+    size_t bytes() const;
+
+private:
+    struct Container
+    {
+        uint16_t key;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array; // sorted; used while cardinality <= arrayLimit
+        std::vector<uint64_t> bits;  // 1024 words once the group is dense
+
+        bool isBitset() const { return !bits.empty(); }
+    };
+
+    static int countTrailingZeros(uint64_t word);
+
+    Container *find(uint16_t key);
+    const Container *find(uint16_t key) const;
+
+    std::vector<Container> containers; // sorted by key
+};
+
+#endif // BITMAP_HPP
@@ -0,0 +1,21 @@
+#ifndef BUSY_OVERLAY_HPP
+#define BUSY_OVERLAY_HPP
+
+#include <SDL2/SDL.h>
+
+// Keeps the window alive while a long statement holds the render thread.
+// Through the database progress handler it pumps SDL events and, once a
+// frame has been blocked for a while, redraws a "Working" overlay with a
+// Cancel button (Esc works too, and closing the window cancels as well).
+// Input that arrives meanwhile is kept and handed to the next frame.
+void initBusyOverlay(SDL_Window *window);
+void shutdownBusyOverlay();
+
+// Call at the start of every frame; the overlay appears when one frame has
+// been blocked longer than the delay
+void beginBusyFrame();
+
+// Events held back while the overlay was up, oldest first
+bool takeDeferredEvent(SDL_Event &event);
+
+#endif // BUSY_OVERLAY_HPP
@@ -0,0 +1,8 @@
+#ifndef CLI_HPP
+#define CLI_HPP
+
+// Headless batch mode: inventory-app [--db FILE] <command> [options] [FILE|-]
+// Returns the process exit code.
+int runCLI(int argc, char **argv);
+
+#endif // CLI_HPP
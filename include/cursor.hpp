@@ -0,0 +1,97 @@
+#ifndef CURSOR_HPP
+#define CURSOR_HPP
+
+#include <utility>
+
+struct sqlite3_stmt;
+
+// Statement helpers shared by all cursors (db.cpp)
+bool stepRow(sqlite3_stmt *stmt); // true while a row is available
+void finalizeStatement(sqlite3_stmt *stmt);
+
+// Forward-only, lazily evaluated query result. Each next() performs one
+// sqlite3_step and decodes that row into a single reused entity, so memory
+// stays constant and the first row is available as soon as SQLite has it.
+//
+//     for (const Product &p : openProducts()) { ... }
+//
+// The statement is finalized when the cursor is exhausted or destroyed.
+template <typename Entity>
+class Cursor
+{
+public:
+    using Reader = void (*)(sqlite3_stmt *, Entity &);
+
+    Cursor() = default;
+    Cursor(sqlite3_stmt *stmt, Reader reader) : stmt(stmt), reader(reader) {}
+    Cursor(const Cursor &) = delete;
+    Cursor &operator=(const Cursor &) = delete;
+    Cursor(Cursor &&other) noexcept
+        : stmt(std::exchange(other.stmt, nullptr)), reader(other.reader), row(std::move(other.row)) {}
+    Cursor &operator=(Cursor &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            stmt = std::exchange(other.stmt, nullptr);
+            reader = other.reader;
+            row = std::move(other.row);
+        }
+        return *this;
+    }
+    ~Cursor() { close(); }
+
+    // Advance to the next row; false once the result is exhausted
+    bool next()
+    {
+        if (!stmt)
+            return false;
+        if (stepRow(stmt))
+        {
+            reader(stmt, row);
+            return true;
+        }
+        close();
+        return false;
+    }
+
+    const Entity &current() const { return row; }
+
+    void close()
+    {
+        if (stmt)
+        {
+            finalizeStatement(stmt);
+            stmt = nullptr;
+        }
+    }
+
+    class iterator
+    {
+    public:
+        explicit iterator(Cursor *cursor) : cursor(cursor) {}
+        const Entity &operator*() const { return cursor->row; }
+        const Entity *operator->() const { return &cursor->row; }
+        iterator &operator++()
+        {
+            if (!cursor->next())
+                cursor = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return cursor == other.cursor; }
+        bool operator!=(const iterator &other) const { return cursor != other.cursor; }
+
+    private:
+        Cursor *cursor;
+    };
+
+    iterator begin() { return iterator(next() ? this : nullptr); }
+    iterator end() { return iterator(nullptr); }
+
+private:
+    sqlite3_stmt *stmt = nullptr;
+    Reader reader = nullptr;
+    Entity row{};
+};
+
+#endif // CURSOR_HPP
@@ -1,6 +1,9 @@
 #ifndef DB_HPP
 #define DB_HPP
 
+#include "cursor.hpp"
+#include "money.hpp"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -9,12 +12,176 @@ struct Product {
     int id;
     std::string name;
     int quantity;
-    double price;
+    Money price;
+    int reorderLevel = 0; // alert when quantity drops below this (0 = never)
+    std::string sku;      // barcode / SKU, unique when not empty
+    int categoryId = 0;   // 0 = uncategorized
+    int version = 0;      // bumped by every change; see updateProductIfUnchanged
+};
+
+// No product: what getProductById returns for an unknown ID, the missing
+// side of an add or delete change, and a blank form to fill in
+extern const Product noProduct;
+
+// Barcode -> product mapping, read without loading whole products
+struct SkuEntry {
+    int productId;
+    std::string sku;
+};
+
+// A warehouse or other place stock is kept. products and units are kept up
+// to date by triggers on the stock table, so listing locations never
+// aggregates stock rows.
+struct Location {
+    int id;
+    std::string name;
+    int products;     // stock rows at this location
+    long long units;
+};
+
+// A node of the category tree with the cached totals of its whole subtree
+struct Category {
+    int id;
+    int parentId;     // 0 = top level
+    std::string name;
+    int children;     // direct subcategories
+    int products;     // products in this category and everything below it
+    long long units;
+    Money value;
+};
+
+// A batch of one product received together, with its own expiry date
+struct Lot {
+    int id;
+    int productId;
+    std::string code;     // supplier lot / batch number
+    std::string expires;  // YYYY-MM-DD, empty = does not expire
+    int quantity;         // units left in this lot
+};
+
+// One product's quantity at one location
+struct StockEntry {
+    int locationId;
+    int quantity;
+};
+
+// A row of one location's stock list
+struct LocationStock {
+    int productId;
+    std::string name;
+    int quantity;     // at this location
+    int total;        // the product's total over all locations and unassigned
+};
+
+// Describes one committed product mutation. The missing side of an add or
+// delete has id -1.
+struct ProductChange {
+    enum Kind { Added, Updated, Deleted };
+    Kind kind;
+    Product before;
+    Product after;
+};
+
+// Outcome of an optimistic update
+enum class UpdateResult { Updated, Conflict, NotFound, Failed };
+
+// Catalogue-wide totals for the dashboard
+struct InventorySummary {
+    int productCount;
+    long long totalUnits;
+    Money totalValue;
+};
+
+// One row: product count, units, and the value in two parts (whole
+// billions of cents, and the rest). A single SUM of quantity * price could
+// overflow and fail; each part fits for any catalogue. Shared with the
+// HTTP read pool.
+extern const char *const inventorySummarySQL;
+// The value from the two parts, clamped to what Money can hold
+Money inventoryValue(long long billions, long long rest);
+
+using ProductObserver = std::function<void(const ProductChange &)>;
+
+// Called every few thousand VM instructions while a statement runs on the
+// main connection. Returning false cancels the statement (SQLITE_INTERRUPT);
+// inside an explicit transaction SQLite then rolls the transaction back.
+using QueryProgressHandler = std::function<bool()>;
+
+// State of the online backup started by startBackup()
+struct BackupProgress {
+    bool active;         // a backup is in progress
+    bool succeeded;      // the last finished backup completed
+    std::string path;
+    std::string error;   // why the last backup failed
+    int totalPages;
+    int remainingPages;
+    int steps;
+    int busySteps;       // steps that found the database locked and will retry
+    double lastStepMs;
+    double maxStepMs;    // worst time the caller was held up by one step
+    double totalStepMs;
+};
+
+// What a writer does when another process holds the database lock: wait
+// with exponential backoff (initialDelayMs doubling up to maxDelayMs, with
+// jitter so terminals that collided do not retry in lockstep), giving up
+// once timeoutMs have been spent waiting. The write then fails. The first
+// writer left waiting takes a turnstile ("<db>-turnstile") and retries every
+// initialDelayMs; writes started meanwhile queue behind it, so a busy
+// terminal cannot keep the lock away from a waiting one.
+struct BusyPolicy {
+    int maxRetries = 0;      // optional cap on the number of waits, 0 = none
+    int initialDelayMs = 1;
+    int maxDelayMs = 100;
+    int timeoutMs = 3000;
+};
+
+// Lock contention seen by this process since startup
+struct ContentionStats {
+    long long writes;        // write statements and transactions started
+    long long busyEvents;    // times a lock was found held by someone else
+    long long retries;       // backoff waits
+    long long gaveUp;        // lock waits that ran out of retries or time
+    long long failedWrites;  // writes that failed because of it
+    double waitedMs;
+    double maxWaitMs;        // longest single wait for one lock
 };
 
 // Database function declarations
 bool initDB(const std::string& dbName);
+void closeDB();
+
+void setBusyPolicy(const BusyPolicy &policy);
+const BusyPolicy &getBusyPolicy();
+const ContentionStats &getContentionStats();
+// Whether the most recent write failed because the database stayed locked
+bool lastWriteWasBusy();
+// Wall-clock time (ns since the epoch) of this connection's latest commit,
+// taken while the write lock was held, so commits made by several processes
+// sort in the order they really happened
+long long lastCommitTime();
+
+// Group many writes into one transaction (batch jobs). BEGIN IMMEDIATE: the
+// write lock is taken (or waited for) up front, so a transaction never
+// fails half way because another terminal started writing first.
+bool beginTransaction();
+bool commitTransaction();
+void rollbackTransaction();
+
+// Online backup of the open database to another file. Each stepBackup()
+// copies at most pagesPerStep pages, so it can run in idle frames without
+// blocking writers for long. Writes made through this connection while the
+// backup runs are carried into the copy.
+bool startBackup(const std::string &path, int pagesPerStep = 64);
+bool stepBackup(); // true while more steps are needed
+void cancelBackup();
+const BackupProgress &getBackupProgress();
+
 bool addProduct(const Product& product);
+// ID assigned by the most recent successful addProduct()
+int lastInsertedProductId();
+// Insert a product under its existing ID (undoing a delete)
+bool restoreProduct(const Product& product);
 // bool deleteProduct(int productId);
 // bool updateProduct(const Product& product);
 std::vector<Product> getAllProducts();
@@ -26,10 +193,105 @@ std::vector<Product> searchProducts(const std::string& keyword);
 // Get a product by ID
 Product getProductById(int id);
 
-// Update product
+// Update product (last writer wins; used by undo and batch jobs)
 bool updateProduct(const Product& p);
 
+// Optimistic update: writes p only if the stored row still has p.version,
+// i.e. nobody changed it since p was read. Nothing is locked while the user
+// edits. current receives the row as stored afterwards: p with its new
+// version on success, the other writer's values on a conflict.
+UpdateResult updateProductIfUnchanged(const Product &p, Product &current);
+
 // Delete product
 bool deleteProduct(int id);
 
+// Add delta (may be negative) to a product's quantity in one UPDATE.
+// Returns false if the product does not exist or would drop below zero.
+bool adjustQuantity(int id, int delta);
+
+// Per-location stock. Product.quantity stays the total: triggers add every
+// stock row change to it, so the product list and summaries never group
+// stock rows. Units that are not at any location are "unassigned" (total
+// minus the per-location quantities); imports, scans and quantity edits
+// change that part. Undoing a stock change restores the total only, so the
+// difference shows up as unassigned.
+int addLocation(const std::string &name); // new location ID, or -1
+std::vector<Location> getLocations();
+// Receive (delta > 0) or ship stock at a location; the product total
+// follows. Fails if the location would hold less than zero.
+bool adjustStock(int locationId, int productId, int delta);
+// Move units between locations (0 = unassigned); the total does not change
+bool transferStock(int productId, int fromLocation, int toLocation, int quantity);
+// One location's stock in product order, from the stock primary key
+Cursor<LocationStock> openLocationStock(int locationId);
+// Where one product is kept, from the covering idx_stock_product
+std::vector<StockEntry> getProductStock(int productId);
+
+// Category tree. category_paths is its closure table (every ancestor and
+// descendant pair with their distance), so a subtree is one index range at
+// any depth. Each category caches the product count, units and value of its
+// whole subtree; triggers on products keep them current by adjusting only
+// the changed product's ancestors, so reading a total is a primary key
+// lookup.
+int addCategory(const std::string &name, int parentId = 0); // new ID, or -1
+// Finds or creates every level of "Electronics/Cables"; the last one's ID or -1
+int addCategoryPath(const std::string &path);
+// Reattach a category (and its subtree) under another one (0 = top level)
+bool moveCategory(int id, int newParentId);
+// Only categories without subcategories or products can be deleted
+bool deleteCategory(int id);
+Category getCategory(int id); // id -1 if there is none
+// Direct subcategories by name (0 = the top level), for lazy tree views
+std::vector<Category> getCategoryChildren(int parentId);
+// "Electronics/Cables"
+std::string getCategoryPath(int id);
+bool setProductCategory(int productId, int categoryId);
+// Products filed directly under a category, by ID
+Cursor<Product> openCategoryProducts(int categoryId);
+
+// Lots. Like stock rows, every lot change is added to the product total by
+// a trigger; units not in any lot are untracked. Only lots can be allocated
+// (see allocation.hpp). As with stock, undo restores the total only. No
+// change may take the total below zero, so units already shipped by an
+// adjustment cannot be consumed from a lot again.
+// expires must be YYYY-MM-DD or empty; the new lot ID, or -1
+int receiveLot(int productId, const std::string &code, const std::string &expires, int quantity);
+// Take units out of several lots of one product at once: each entry's
+// quantity is what to take from lot id. All or nothing; fails if any lot
+// (of that product) holds fewer.
+bool consumeLots(int productId, const std::vector<Lot> &takes);
+// A product's non-empty lots, first to expire first (lots without a date last)
+Cursor<Lot> openProductLots(int productId);
+
+// Streaming reads: rows are decoded one at a time straight from sqlite3_step.
+// Prefer these over getAllProducts/searchProducts for large catalogues.
+Cursor<Product> openProducts();
+Cursor<Product> openProductSearch(const std::string &keyword);
+
+// Count, units and value of the whole catalogue
+InventorySummary getInventorySummary();
+
+// Every product that has a barcode (served from the SKU index alone)
+Cursor<SkuEntry> openSkus();
+
+// Products whose quantity is below their reorder level (served from a partial index)
+Cursor<Product> openLowStockProducts();
+
+// Install or (with an empty handler) remove the progress handler. Cursors
+// over a cancelled statement simply end, so their results are partial.
+void setQueryProgressHandler(QueryProgressHandler handler, int instructions = 1000);
+// Whether a statement was cancelled since the last call
+bool takeQueryCancelled();
+// Pure VM work on the main connection, under the installed progress handler:
+// counts to rows in a recursive CTE (bench-progress). False if the
+// statement was cancelled or failed.
+bool runSpinQuery(long long rows);
+
+// Observers are called synchronously after every successful add/update/delete.
+// Inside a transaction they are called once it commits, in order, and not
+// at all if it rolls back.
+// Returns a handle for removeProductObserver.
+int addProductObserver(ProductObserver observer);
+void removeProductObserver(int handle);
+
 #endif // DB_HPP
@@ -0,0 +1,45 @@
+#ifndef FACETS_HPP
+#define FACETS_HPP
+
+#include "bitmap.hpp"
+#include <string>
+#include <vector>
+
+// One value of a facet (a quantity or price bucket, a stock status, ...)
+// and the IDs of the products that have it
+struct FacetValue {
+    std::string label;
+    RoaringBitmap products;
+};
+
+struct Facet {
+    std::string name;
+    std::vector<FacetValue> values;
+};
+
+// Bitmap indexes over bucketed product attributes, loaded once and kept
+// current from product change notifications. Each product is in exactly one
+// value of every facet.
+void initFacets();
+void shutdownFacets();
+
+const std::vector<Facet> &getFacets();
+
+// selected[facet][value]. Values selected within one facet are ORed, the
+// facets are ANDed; a facet with nothing selected does not filter.
+using FacetSelection = std::vector<std::vector<bool>>;
+FacetSelection emptyFacetSelection();
+bool isFilteringFacets(const FacetSelection &selection);
+
+// Products matching the whole selection
+RoaringBitmap filterByFacets(const FacetSelection &selection);
+
+// counts[facet][value]: how many products would match if that value were
+// added to the selection (the facet's own selection is ignored, the other
+// facets apply)
+std::vector<std::vector<uint64_t>> countFacets(const FacetSelection &selection);
+
+// Bumped whenever any product moves between values
+unsigned getFacetsRevision();
+
+#endif // FACETS_HPP
@@ -0,0 +1,43 @@
+#ifndef FONTS_HPP
+#define FONTS_HPP
+
+#include <cstddef>
+
+// Font atlas statistics from the most recent build
+struct FontStats {
+    double buildMs;     // time spent rasterizing and packing the atlas
+    int texWidth;
+    int texHeight;
+    size_t texBytes;    // RGBA32 texture uploaded to the GPU
+    int glyphCount;
+    int cachedGlyphs;   // codepoints restored from the glyph cache at startup
+    int builds;         // atlas builds since startup
+    bool atlasCached;   // last atlas was loaded from the atlas cache, not rasterized
+};
+
+// Load the text font plus a color emoji font merged into it. The atlas only
+// holds ASCII/Latin-1, the codepoints in uiText and those seen in earlier
+// sessions, instead of whole Unicode blocks.
+// With useCache the glyph set and the finished atlas (pixels and glyph
+// metrics) are kept in the per-user cache directory (XDG_CACHE_HOME or
+// ~/.cache/inventory-app, ~/Library/Caches on macOS, LOCALAPPDATA on
+// Windows). The atlas is reused while the font files, size, glyph set and
+// ImGui version match, so a normal start rasterizes nothing.
+// Call after ImGui::CreateContext() and before the renderer is initialized.
+void initFonts(float sizePixels, const char *uiText, bool useCache);
+
+// Note text that is about to be displayed (e.g. product names). Unknown
+// codepoints are queued for the next atlas rebuild.
+void requestGlyphs(const char *text);
+
+// Rebuild the atlas if new glyphs were requested. Call between frames; when it
+// returns true the renderer's font texture must be recreated.
+bool updateFonts();
+
+// Write the glyph set and, if it was rebuilt, the atlas to the cache
+// directory. Call before ImGui::DestroyContext().
+void saveFontCache();
+
+const FontStats &getFontStats();
+
+#endif // FONTS_HPP
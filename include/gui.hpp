@@ -1,10 +1,46 @@
 #ifndef GUI_HPP
 #define GUI_HPP
 
-void runGUI();
+#include <string>
+
+struct GUIOptions {
+    std::string recordPath; // write every frame's input here (input_replay.hpp)
+    std::string replayPath; // play a recording back instead of live input
+    std::string reportPath; // per-frame timings of a replay as CSV
+    int seedRows = -1;      // size of the seeded catalogue, stored in recordings
+};
+
+// SDL/OpenGL window and event loop (gui.cpp)
+void runGUI(const GUIOptions &options = {});
+
+// Panels (panels.cpp). They only need a current ImGui context, so any
+// backend can host them, including the headless benchmark.
+
+// Every non-ASCII character used in UI labels. The font atlas is built for
+// exactly these plus whatever product names need, so add new icons here.
+extern const char *const uiGlyphs;
+
+// Start the incremental indexes the panels read (alerts, barcodes, facets)
+// and the change tracking that tells them when to reload
+void initPanels();
+void shutdownPanels();
+
+// Quantity change applied by each scan while scan mode is on
+int getScanDelta();
+
 void renderProductList();
 void renderSearchProduct();
+void setSearchKeyword(const char *text);
 void renderUpdateProduct();
 void renderDeleteProduct();
+void renderAlerts();
+void renderDashboard();
+void renderScanner();
+void renderHistory();
+void renderCharts();
+void renderSlowQueries();
+void renderLocations();
+void renderCategories();
+void renderLots();
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef HTTP_SERVER_HPP
+#define HTTP_SERVER_HPP
+
+#include <string>
+#include <vector>
+
+// Local JSON API over the inventory database (loopback only).
+//
+//   GET    /products[?q=keyword|?ids=1,2,3]   list, search or fetch several
+//   GET    /products/{id}
+//   POST   /products                          {"name":..,"quantity":..,"price":..,"reorder_level":..,"sku":..}
+//   PUT    /products/{id}                     same body, replaces the row; with the
+//                                             "version" from a GET, 409 and the current
+//                                             row if someone changed it in between
+//   DELETE /products/{id}
+//   POST   /products/{id}/adjust              {"delta": -3}
+//   POST   /batch/adjust                      [{"id":1,"delta":-3}, ...] in one transaction
+//   GET    /alerts                            products below their reorder level
+//   GET    /stats
+//
+// Requests with a body must be Content-Type: application/json, and an
+// Origin or Host header, when sent, must name localhost or 127.0.0.1.
+//
+// Connections are HTTP/1.1 keep-alive and may pipeline requests. Between
+// requests they wait in one poll loop, and a worker serves whichever has
+// data, so any number of idle clients can stay connected. Reads go
+// through a pool of read-only SQLite connections; writes are serialized
+// through db.hpp on the main connection.
+struct HttpServerOptions {
+    std::string dbPath = "inventory.db";
+    int port = 8080;
+    int threads = 8;          // worker threads; idle keep-alive connections hold none
+    int readConnections = 4;  // pooled read-only SQLite connections
+    // Switch the file to WAL before serving, so pooled reads never wait for
+    // writes. The journal mode is stored in the file and stays after the
+    // server stops; WAL needs shared memory, so not on network shares.
+    bool wal = false;
+};
+
+// Blocks until SIGINT/SIGTERM. initDB() must already have been called.
+int runHttpServer(const HttpServerOptions &options);
+
+// A statement every pooled read connection prepares; check-plans explains
+// them on the main connection, since the pool's are not traced
+struct PooledStatement {
+    const char *name;
+    std::string sql;
+};
+const std::vector<PooledStatement> &readPoolStatements();
+
+// Request parsing checks that need neither a socket nor a database (JSON
+// nesting, integer fields, ...); prints each case, 0 when all pass
+int runHttpChecks();
+
+struct HttpLoadTestOptions {
+    int port = 8080;
+    int connections = 8;
+    int requests = 10000;     // total across all connections
+    int pipeline = 1;         // requests in flight per connection
+    std::string path = "/products/1";
+};
+
+// Hammer a running server and report requests/s and latency percentiles
+int runHttpLoadTest(const HttpLoadTestOptions &options);
+
+#endif // HTTP_SERVER_HPP
@@ -0,0 +1,37 @@
+#ifndef INPUT_REPLAY_HPP
+#define INPUT_REPLAY_HPP
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+// Recording and replay of GUI sessions. A recording holds, for every frame,
+// the SDL input events runGUI() processed and the frame's delta time, so a
+// replay feeds the same input into the same frames regardless of how long
+// each frame takes now. Only plain input events are kept (keyboard, text,
+// mouse, wheel, window, quit); nothing in them points to external memory.
+
+struct RecordingInfo {
+    int windowWidth;
+    int windowHeight;
+    int seedRows; // catalogue size it was made against (seedCatalogue), -1 if none
+};
+
+bool startRecording(const std::string &path, const RecordingInfo &info);
+void recordFrame(const std::vector<SDL_Event> &events, float deltaTime);
+void stopRecording();
+bool isRecording();
+
+bool openReplay(const std::string &path, RecordingInfo &info);
+// Events and delta time of the next recorded frame; false once the recording is exhausted
+bool nextReplayFrame(std::vector<SDL_Event> &events, float &deltaTime);
+void closeReplay();
+bool isReplaying();
+
+// Per-frame timing collected during a replay
+void addFrameTiming(double ms, int events);
+// Summary (avg/p50/p95/p99/max, slowest frames) on stdout; per-frame CSV to
+// csvPath unless it is empty
+void reportFrameTimings(const std::string &csvPath);
+
+#endif // INPUT_REPLAY_HPP
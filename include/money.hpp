@@ -0,0 +1,117 @@
+#ifndef MONEY_HPP
+#define MONEY_HPP
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+// An amount of money in minor units (cents). Sums and products with
+// quantities are exact integer arithmetic; convert to double only for display.
+struct Money {
+    long long cents = 0;
+
+    // Largest price per unit parsed or converted (ten million). Quantities
+    // are ints, so quantity * price of any row stays below 2^63 cents, and
+    // the catalogue value is summed in two parts that each fit for 2^31 rows
+    // (see inventorySummarySQL).
+    static constexpr long long maxUnits = 10000000LL;
+
+    static constexpr Money fromCents(long long cents) { return Money{cents}; }
+    // Rounds to the nearest cent; for prices that arrive as binary floats
+    // (JSON). False for NaN, infinities, negative amounts and amounts beyond
+    // maxUnits.
+    static bool fromDouble(double amount, Money &out)
+    {
+        if (!std::isfinite(amount) || amount < 0.0 || amount > (double)maxUnits)
+            return false;
+        out.cents = std::llround(amount * 100.0);
+        return true;
+    }
+
+    double toDouble() const { return cents / 100.0; }
+
+    Money &operator+=(Money other) { cents += other.cents; return *this; }
+    Money &operator-=(Money other) { cents -= other.cents; return *this; }
+};
+
+inline Money operator+(Money a, Money b) { return Money{a.cents + b.cents}; }
+inline Money operator-(Money a, Money b) { return Money{a.cents - b.cents}; }
+inline Money operator*(Money a, long long n) { return Money{a.cents * n}; }
+inline Money operator*(long long n, Money a) { return Money{a.cents * n}; }
+inline bool operator==(Money a, Money b) { return a.cents == b.cents; }
+inline bool operator!=(Money a, Money b) { return a.cents != b.cents; }
+inline bool operator<(Money a, Money b) { return a.cents < b.cents; }
+
+// "1234.50", "-0.05"
+inline std::string formatMoney(Money m)
+{
+    unsigned long long magnitude = m.cents < 0 ? 0ULL - (unsigned long long)m.cents : (unsigned long long)m.cents;
+    std::string fraction = std::to_string(magnitude % 100);
+    return (m.cents < 0 ? "-" : "") + std::to_string(magnitude / 100) + "." +
+           (fraction.size() < 2 ? "0" : "") + fraction;
+}
+
+// Parses a price such as "12", "12.5", "+3.99" or "1,234.50" digit by digit,
+// so no binary rounding is involved. Commas are only accepted between
+// groups of three digits, and prices are never negative. Digits beyond the
+// cent are rounded half up. Returns false on anything else.
+inline bool parseMoney(const std::string &text, Money &out)
+{
+    size_t i = 0, n = text.size();
+    while (i < n && text[i] == ' ')
+        ++i;
+    while (n > i && text[n - 1] == ' ')
+        --n;
+
+    if (i < n && text[i] == '+')
+        ++i;
+
+    long long units = 0;
+    int digits = 0;
+    int group = 0;        // digits since the last comma
+    bool grouped = false; // after a comma every group has exactly three digits
+    for (; i < n && text[i] != '.'; ++i)
+    {
+        if (text[i] == ',')
+        {
+            if (group == 0 || group > 3 || (grouped && group != 3))
+                return false;
+            grouped = true;
+            group = 0;
+            continue;
+        }
+        if (text[i] < '0' || text[i] > '9' || units > (Money::maxUnits - (text[i] - '0')) / 10)
+            return false;
+        units = units * 10 + (text[i] - '0');
+        ++digits;
+        ++group;
+    }
+    if (grouped && group != 3)
+        return false;
+
+    long long fraction = 0;
+    int decimals = 0;
+    bool roundUp = false;
+    if (i < n && text[i] == '.')
+    {
+        for (++i; i < n; ++i, ++decimals)
+        {
+            if (text[i] < '0' || text[i] > '9')
+                return false;
+            if (decimals < 2)
+                fraction = fraction * 10 + (text[i] - '0');
+            else if (decimals == 2)
+                roundUp = text[i] >= '5';
+            ++digits;
+        }
+    }
+    if (digits == 0)
+        return false;
+
+    if (decimals == 1)
+        fraction *= 10;
+    out.cents = units * 100 + fraction + (roundUp ? 1 : 0);
+    return true;
+}
+
+#endif // MONEY_HPP
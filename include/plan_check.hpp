@@ -0,0 +1,20 @@
+#ifndef PLAN_CHECK_HPP
+#define PLAN_CHECK_HPP
+
+#include <string>
+
+// Query-plan regression checks for db.cpp. Seeds a scratch database, runs
+// every product operation once with the slow query log catching all of its
+// statements, and fails an operation that is meant to be served by an index
+// when any of its plans walks a whole table (a bare "SCAN products", or an
+// automatic index). Each operation is then timed against a budget.
+struct PlanCheckOptions {
+    std::string dbPath = "plan-check.db"; // recreated, then removed
+    int rows = 200000;
+    int iterations = 1000;                // calls timed per point operation
+};
+
+// 0 when every plan and timing is within its expectation
+int runPlanChecks(const PlanCheckOptions &options);
+
+#endif // PLAN_CHECK_HPP
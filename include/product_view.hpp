@@ -0,0 +1,38 @@
+#ifndef PRODUCT_VIEW_HPP
+#define PRODUCT_VIEW_HPP
+
+#include "db.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sorting and grouping of an in-memory product snapshot. Rows are indices
+// into the snapshot, so the products themselves are never copied or moved.
+
+enum class SortColumn { Id, Name, Quantity, Price, Sku };
+
+// Reorder rows by one column. Every row gets a 64-bit key up front (numbers
+// with their sign bit flipped, strings as the first 8 bytes of their
+// case-folded collation key), the keys are radix sorted in parallel chunks
+// that are then merged, and only rows whose string prefixes tie are
+// compared in full. Stable: equal rows keep their current order.
+void sortRows(const std::vector<Product> &products, std::vector<uint32_t> &rows, SortColumn column, bool descending);
+
+// Case-insensitive ordering used for names and SKUs
+std::string collationKey(const std::string &text);
+
+enum class GroupColumn { FirstWord, Price, ReorderLevel };
+
+struct ProductGroup {
+    std::string label;
+    int products;
+    long long units;
+    Money value;
+};
+
+// Hash aggregation: each thread groups its share of the rows into a local
+// table, the tables are merged and the groups returned in key order
+std::vector<ProductGroup> groupRows(const std::vector<Product> &products, const std::vector<uint32_t> &rows,
+                                   GroupColumn column);
+
+#endif // PRODUCT_VIEW_HPP
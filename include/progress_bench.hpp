@@ -0,0 +1,20 @@
+#ifndef PROGRESS_BENCH_HPP
+#define PROGRESS_BENCH_HPP
+
+// How long input waits while a multi-second statement runs on the thread
+// that handles it. The statement runs on the app's own connection (initDB
+// on an in-memory database) while a second thread delivers an input event
+// every millisecond. It runs once with no handler, where events are only
+// seen after it finishes, and once under the GUI's query pump (see
+// query_pump.hpp) with a pump that drains them instead of drawing the
+// overlay. A third run requests a cancel from the input thread, as the
+// overlay's Cancel button does, and measures how long the statement takes
+// to stop.
+struct ProgressBenchOptions {
+    int instructions = 1000; // same default as setQueryProgressHandler
+    double seconds = 3.0;    // target length of the statement
+};
+
+int runProgressBench(const ProgressBenchOptions &options);
+
+#endif // PROGRESS_BENCH_HPP
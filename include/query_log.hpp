@@ -0,0 +1,49 @@
+#ifndef QUERY_LOG_HPP
+#define QUERY_LOG_HPP
+
+#include <ctime>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+// Slow query log for the main connection. Every statement that takes at
+// least the threshold is kept with its bound values, the work SQLite did
+// for it and its EXPLAIN QUERY PLAN, so a query that scans a table shows up
+// as "SCAN products" next to its timing.
+struct SlowQuery {
+    std::time_t at;
+    std::string sql;       // with parameters expanded
+    double ms;
+    long long rows;        // rows returned
+    int vmSteps;           // virtual machine instructions run
+    int fullScanSteps;     // steps taken walking a table or index from start to end
+    int sorts;             // sorts done without an index
+    int autoIndexRows;     // rows put in automatic (temporary) indexes
+    std::string plan;      // EXPLAIN QUERY PLAN as an indented tree
+};
+
+// Called by initDB/closeDB. Explaining plans needs the connection, so
+// detaching first fills in any plans still missing.
+void attachQueryLog(sqlite3 *db);
+void detachQueryLog();
+
+// Statements faster than this are not kept; a negative threshold turns
+// tracing off entirely (default 10 ms)
+void setSlowQueryThreshold(double ms);
+double getSlowQueryThreshold();
+
+// EXPLAIN QUERY PLAN of any statement on the attached connection, in the
+// same form as SlowQuery::plan, without running it
+std::string explainQueryPlan(const std::string &sql);
+
+// Newest last, at most the last 256 slow statements
+const std::vector<SlowQuery> &getSlowQueries();
+void clearSlowQueries();
+
+// Write the log as plain text (plans included)
+void writeSlowQueries(std::ostream &out);
+bool dumpSlowQueries(const std::string &path);
+
+#endif // QUERY_LOG_HPP
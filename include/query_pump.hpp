@@ -0,0 +1,38 @@
+#ifndef QUERY_PUMP_HPP
+#define QUERY_PUMP_HPP
+
+#include <functional>
+
+// The window-independent half of the busy overlay, installed as the
+// database progress handler. A frame blocked for less than showAfterSeconds
+// is left alone; after that pump is called at most once per redrawSeconds
+// with how long the frame has been blocked. Once a cancel is requested
+// (from the pump or any other thread) the handler returns false, so the
+// statement stops and takeQueryCancelled() reports it. The GUI and
+// bench-progress both run on this, so the bench measures the shipped path.
+using QueryPump = std::function<void(double blockedSeconds)>;
+
+struct QueryPumpTiming {
+    double showAfterSeconds = 0.15;    // shorter is just a slow frame
+    double redrawSeconds = 1.0 / 60.0; // least time between two pumps
+};
+
+void startQueryPump(QueryPump pump, const QueryPumpTiming &timing = QueryPumpTiming(), int instructions = 1000);
+void stopQueryPump();
+
+// Call at the start of every frame: restarts the blocked clock and clears
+// the cancel request
+void beginPumpFrame();
+
+// Safe from any thread
+void requestQueryCancel();
+bool queryCancelRequested();
+
+// Progress handler calls and pumps since startQueryPump
+struct QueryPumpStats {
+    long long calls;
+    long long pumps;
+};
+QueryPumpStats getQueryPumpStats();
+
+#endif // QUERY_PUMP_HPP
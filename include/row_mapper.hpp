@@ -0,0 +1,220 @@
+#ifndef ROW_MAPPER_HPP
+#define ROW_MAPPER_HPP
+
+#include "money.hpp"
+#include <sqlite3.h>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// One column of an entity: its SQL name and the struct member it maps to
+template <typename Entity, typename T>
+struct Field
+{
+    const char *name;
+    T Entity::*member;
+};
+
+template <typename Entity, typename T>
+constexpr Field<Entity, T> field(const char *name, T Entity::*member)
+{
+    return {name, member};
+}
+
+// Specialize for every entity stored in the database (see schema.hpp).
+// A specialization provides:
+//   static constexpr const char *table;
+//   static constexpr auto key;     // field(...) of the INTEGER PRIMARY KEY
+//   static constexpr auto fields;  // std::make_tuple(field(...), ...) of the other columns
+// and optionally
+//   static constexpr auto version; // field(...) of an int row version for optimistic locking
+// A version column is read after the other fields, never bound by
+// bindFields, and incremented by every UPDATE built here.
+template <typename Entity>
+struct EntityTraits;
+
+template <typename Entity, typename = void>
+struct HasVersion : std::false_type
+{
+};
+
+template <typename Entity>
+struct HasVersion<Entity, std::void_t<decltype(EntityTraits<Entity>::version)>> : std::true_type
+{
+};
+
+// Per-type column access. Text is bound SQLITE_STATIC, so the entity must
+// outlive the sqlite3_step() call that uses it.
+inline void bindValue(sqlite3_stmt *stmt, int index, int value) { sqlite3_bind_int(stmt, index, value); }
+inline void bindValue(sqlite3_stmt *stmt, int index, long long value) { sqlite3_bind_int64(stmt, index, value); }
+inline void bindValue(sqlite3_stmt *stmt, int index, double value) { sqlite3_bind_double(stmt, index, value); }
+inline void bindValue(sqlite3_stmt *stmt, int index, Money value) { sqlite3_bind_int64(stmt, index, value.cents); }
+inline void bindValue(sqlite3_stmt *stmt, int index, const std::string &value)
+{
+    sqlite3_bind_text(stmt, index, value.c_str(), (int)value.size(), SQLITE_STATIC);
+}
+
+inline void readValue(sqlite3_stmt *stmt, int column, int &out) { out = sqlite3_column_int(stmt, column); }
+inline void readValue(sqlite3_stmt *stmt, int column, long long &out) { out = sqlite3_column_int64(stmt, column); }
+inline void readValue(sqlite3_stmt *stmt, int column, double &out) { out = sqlite3_column_double(stmt, column); }
+inline void readValue(sqlite3_stmt *stmt, int column, Money &out) { out.cents = sqlite3_column_int64(stmt, column); }
+inline void readValue(sqlite3_stmt *stmt, int column, std::string &out)
+{
+    const unsigned char *text = sqlite3_column_text(stmt, column);
+    if (text)
+        out.assign(reinterpret_cast<const char *>(text), (size_t)sqlite3_column_bytes(stmt, column));
+    else
+        out.clear();
+}
+
+namespace rowmap_detail
+{
+    template <typename Fn, typename Tuple, size_t... I>
+    void forEachField(Fn &&fn, const Tuple &tuple, std::index_sequence<I...>)
+    {
+        (fn(std::get<I>(tuple), (int)I), ...);
+    }
+
+    template <typename Entity, typename Fn>
+    void forEachField(Fn &&fn)
+    {
+        constexpr auto &fields = EntityTraits<Entity>::fields;
+        forEachField(fn, fields, std::make_index_sequence<std::tuple_size<std::decay_t<decltype(fields)>>::value>{});
+    }
+}
+
+// Number of non-key columns
+template <typename Entity>
+constexpr int fieldCount()
+{
+    return (int)std::tuple_size<std::decay_t<decltype(EntityTraits<Entity>::fields)>>::value;
+}
+
+// "id, name, quantity, price" - key first, then fields in declaration order,
+// then the version column if there is one
+template <typename Entity>
+const std::string &selectColumns()
+{
+    static const std::string columns = []
+    {
+        std::string s = EntityTraits<Entity>::key.name;
+        rowmap_detail::forEachField<Entity>([&](const auto &f, int)
+                                            { s += std::string(", ") + f.name; });
+        if constexpr (HasVersion<Entity>::value)
+            s += std::string(", ") + EntityTraits<Entity>::version.name;
+        return s;
+    }();
+    return columns;
+}
+
+// "SELECT <columns> FROM <table> <tail>"
+template <typename Entity>
+std::string selectSQL(const char *tail = "")
+{
+    std::string sql = "SELECT " + selectColumns<Entity>() + " FROM " + EntityTraits<Entity>::table;
+    if (*tail)
+        sql += std::string(" ") + tail;
+    return sql + ";";
+}
+
+// "INSERT INTO <table> (<fields>) VALUES (?, ...)"; the key is assigned by SQLite
+template <typename Entity>
+const std::string &insertSQL()
+{
+    static const std::string sql = []
+    {
+        std::string names, params;
+        rowmap_detail::forEachField<Entity>([&](const auto &f, int i)
+                                            {
+            names += std::string(i ? ", " : "") + f.name;
+            params += i ? ", ?" : "?"; });
+        return std::string("INSERT INTO ") + EntityTraits<Entity>::table + " (" + names + ") VALUES (" + params + ");";
+    }();
+    return sql;
+}
+
+// "INSERT INTO <table> (<key>, <fields>[, <version>]) VALUES (?, ...)"; re-creates a
+// row under its old key. The version, if any, is the last parameter.
+template <typename Entity>
+const std::string &insertWithKeySQL()
+{
+    static const std::string sql = []
+    {
+        std::string params = "?";
+        for (int i = 0; i < fieldCount<Entity>() + (HasVersion<Entity>::value ? 1 : 0); ++i)
+            params += ", ?";
+        return std::string("INSERT INTO ") + EntityTraits<Entity>::table + " (" + selectColumns<Entity>() +
+               ") VALUES (" + params + ");";
+    }();
+    return sql;
+}
+
+namespace rowmap_detail
+{
+    template <typename Entity>
+    std::string updatePrefix()
+    {
+        std::string sets;
+        forEachField<Entity>([&](const auto &f, int i)
+                             { sets += std::string(i ? ", " : "") + f.name + " = ?"; });
+        if constexpr (HasVersion<Entity>::value)
+        {
+            const char *version = EntityTraits<Entity>::version.name;
+            sets += std::string(", ") + version + " = " + version + " + 1";
+        }
+        return std::string("UPDATE ") + EntityTraits<Entity>::table + " SET " + sets +
+               " WHERE " + EntityTraits<Entity>::key.name + " = ?";
+    }
+}
+
+// "UPDATE <table> SET <field> = ?, ... WHERE <key> = ?"; the key is the last parameter
+template <typename Entity>
+const std::string &updateSQL()
+{
+    static const std::string sql = rowmap_detail::updatePrefix<Entity>() + ";";
+    return sql;
+}
+
+// updateSQL() that only matches the row while it still has the version the
+// caller read: "... WHERE <key> = ? AND <version> = ?". Zero changes means
+// someone else updated (or deleted) the row in between.
+template <typename Entity>
+const std::string &compareAndSetSQL()
+{
+    static_assert(HasVersion<Entity>::value, "compare-and-set needs a version column");
+    static const std::string sql = rowmap_detail::updatePrefix<Entity>() + " AND " +
+                                   EntityTraits<Entity>::version.name + " = ?;";
+    return sql;
+}
+
+// Bind every non-key field starting at parameter `first`; returns the next free parameter index
+template <typename Entity>
+int bindFields(sqlite3_stmt *stmt, const Entity &entity, int first = 1)
+{
+    rowmap_detail::forEachField<Entity>([&](const auto &f, int i)
+                                        { bindValue(stmt, first + i, entity.*(f.member)); });
+    return first + fieldCount<Entity>();
+}
+
+// Fill an entity from the current row of a statement prepared with selectSQL<Entity>().
+// Reusing the same entity across rows keeps string buffers allocated.
+template <typename Entity>
+void readRowInto(sqlite3_stmt *stmt, Entity &entity)
+{
+    readValue(stmt, 0, entity.*(EntityTraits<Entity>::key.member));
+    rowmap_detail::forEachField<Entity>([&](const auto &f, int i)
+                                        { readValue(stmt, 1 + i, entity.*(f.member)); });
+    if constexpr (HasVersion<Entity>::value)
+        readValue(stmt, 1 + fieldCount<Entity>(), entity.*(EntityTraits<Entity>::version.member));
+}
+
+template <typename Entity>
+Entity readRow(sqlite3_stmt *stmt)
+{
+    Entity entity{};
+    readRowInto(stmt, entity);
+    return entity;
+}
+
+#endif // ROW_MAPPER_HPP
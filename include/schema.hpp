@@ -0,0 +1,92 @@
+#ifndef SCHEMA_HPP
+#define SCHEMA_HPP
+
+#include "db.hpp"
+#include "row_mapper.hpp"
+
+// Column layout of the products table
+template <>
+struct EntityTraits<Product>
+{
+    static constexpr const char *table = "products";
+    static constexpr auto key = field("id", &Product::id);
+    static constexpr auto fields = std::make_tuple(
+        field("name", &Product::name),
+        field("quantity", &Product::quantity),
+        field("price_cents", &Product::price),
+        field("reorder_level", &Product::reorderLevel),
+        field("sku", &Product::sku),
+        field("category_id", &Product::categoryId));
+    static constexpr auto version = field("version", &Product::version);
+};
+
+// Projection of products onto the SKU index
+template <>
+struct EntityTraits<SkuEntry>
+{
+    static constexpr const char *table = "products";
+    static constexpr auto key = field("id", &SkuEntry::productId);
+    static constexpr auto fields = std::make_tuple(
+        field("sku", &SkuEntry::sku));
+};
+
+template <>
+struct EntityTraits<Location>
+{
+    static constexpr const char *table = "locations";
+    static constexpr auto key = field("id", &Location::id);
+    static constexpr auto fields = std::make_tuple(
+        field("name", &Location::name),
+        field("products", &Location::products),
+        field("units", &Location::units));
+};
+
+template <>
+struct EntityTraits<Category>
+{
+    static constexpr const char *table = "categories";
+    static constexpr auto key = field("id", &Category::id);
+    static constexpr auto fields = std::make_tuple(
+        field("parent_id", &Category::parentId),
+        field("name", &Category::name),
+        field("children", &Category::children),
+        field("products", &Category::products),
+        field("units", &Category::units),
+        field("value_cents", &Category::value));
+};
+
+template <>
+struct EntityTraits<Lot>
+{
+    static constexpr const char *table = "lots";
+    static constexpr auto key = field("id", &Lot::id);
+    static constexpr auto fields = std::make_tuple(
+        field("product_id", &Lot::productId),
+        field("code", &Lot::code),
+        field("expires", &Lot::expires),
+        field("quantity", &Lot::quantity));
+};
+
+// Projection of stock onto idx_stock_product(product_id, location_id, quantity)
+template <>
+struct EntityTraits<StockEntry>
+{
+    static constexpr const char *table = "stock";
+    static constexpr auto key = field("location_id", &StockEntry::locationId);
+    static constexpr auto fields = std::make_tuple(
+        field("quantity", &StockEntry::quantity));
+};
+
+// A location's stock rows joined to their products
+template <>
+struct EntityTraits<LocationStock>
+{
+    static constexpr const char *table = "stock JOIN products ON products.id = stock.product_id";
+    static constexpr auto key = field("stock.product_id", &LocationStock::productId);
+    static constexpr auto fields = std::make_tuple(
+        field("products.name", &LocationStock::name),
+        field("stock.quantity", &LocationStock::quantity),
+        field("products.quantity", &LocationStock::total));
+};
+
+#endif // SCHEMA_HPP
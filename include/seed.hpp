@@ -0,0 +1,14 @@
+#ifndef SEED_HPP
+#define SEED_HPP
+
+#include <string>
+
+// Deterministic catalogue for benchmarks and replays: the same row count
+// always produces the same products. Adds to the open database in one
+// transaction.
+bool seedCatalogue(int rows);
+
+// Delete a database together with its WAL, journal and sidecar files
+void removeDatabaseFiles(const std::string &path);
+
+#endif // SEED_HPP
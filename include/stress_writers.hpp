@@ -0,0 +1,41 @@
+#ifndef STRESS_WRITERS_HPP
+#define STRESS_WRITERS_HPP
+
+#include <string>
+
+// Several processes hammering one database file, as terminals sharing
+// inventory.db do. Each process adjusts random quantities (and reads some
+// products back) through db.hpp with the current busy policy, then the
+// totals are checked against the changes every process reports committed.
+// How each process changes quantities
+enum class WriteMode {
+    Adjust,      // quantity = quantity + delta in one UPDATE
+    Blind,       // read the product, save it back (concurrent edits get lost)
+    Optimistic,  // read, then compare-and-set on the row version, retrying conflicts
+    Pessimistic  // BEGIN IMMEDIATE, read, save, COMMIT: the lock is held while editing
+};
+
+struct WriterStressOptions {
+    std::string dbPath = "stress.db"; // recreated and seeded, then removed
+    int processes = 4;
+    double seconds = 5.0;
+    int writesPerTransaction = 1;     // 1 = every change commits on its own
+    int rows = 1000;
+    double pauseMs = 0.0;             // think time before each change
+    WriteMode mode = WriteMode::Adjust;
+    double editMs = 2.0;              // read-to-save time of one edit (not Adjust)
+    double minShare = 0.1;            // stress-writers: least a process may commit, as a share of the mean
+};
+
+// Prints throughput, failure rate, lock waits, write latency and the spread
+// between processes; non-zero if a process died or starved (committed less
+// than minShare of the average), or the committed changes do not add up
+int runWriterStress(const WriterStressOptions &options);
+
+// The same processes editing products read-modify-write, once per mode
+// (blind, pessimistic, optimistic), compared by throughput, conflicts, lock
+// waits and lost updates. A small `rows` makes the edits collide. Non-zero
+// if a locking mode lost an update.
+int runEditBench(const WriterStressOptions &options);
+
+#endif // STRESS_WRITERS_HPP
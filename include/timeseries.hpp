@@ -0,0 +1,47 @@
+#ifndef TIMESERIES_HPP
+#define TIMESERIES_HPP
+
+#include "money.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+// One snapshot of a product after a change. Series 0 is the whole
+// catalogue: quantity is the total number of units and price the total
+// stock value.
+struct SeriesPoint {
+    long long time; // Unix time in milliseconds
+    long long quantity;
+    Money price;
+};
+
+// The product ID of the catalogue-wide series
+const int catalogueSeries = 0;
+
+// Quantity/price history recorded from product change notifications and
+// stored in <dbPath>.series. Points are compressed Gorilla-style in blocks
+// of up to 128: timestamps as delta-of-delta, values as the XOR with the
+// previous value. Full blocks are written as they fill; the open ones are
+// written by flushSeries()/shutdownSeries().
+bool initSeries(const std::string &dbPath);
+void shutdownSeries();
+void flushSeries();
+
+// Points of one series with from <= time <= to, oldest first
+std::vector<SeriesPoint> querySeries(int productId, long long from, long long to);
+
+// Largest-Triangle-Three-Buckets: reduce (x, y) points to at most
+// `threshold` while keeping the visual shape (peaks, dips) of the line
+std::vector<std::pair<double, double>> downsampleLTTB(const std::vector<std::pair<double, double>> &points,
+                                                      size_t threshold);
+
+struct SeriesStats {
+    long long points;   // recorded since start-up
+    long long blocks;   // written to disk since start-up
+    long long bytes;    // compressed bytes in those blocks
+    long long blockPoints;
+    int openBlocks;
+};
+SeriesStats getSeriesStats();
+
+#endif // TIMESERIES_HPP
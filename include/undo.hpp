@@ -0,0 +1,46 @@
+#ifndef UNDO_HPP
+#define UNDO_HPP
+
+#include "db.hpp"
+#include <string>
+
+// Undo/redo journal of product mutations, recorded from change notifications
+// as before/after images. Each command is one user action; changes made
+// between beginUndoGroup() and endUndoGroup() form a single command.
+//
+// The most recent commands are kept in memory. Older ones are spilled to a
+// file and read back when undo reaches them (a command larger than the
+// whole memory budget goes straight there), so memory stays bounded and
+// the journal survives restarts (shutdownUndo() spills the rest). The GUI
+// and CLI runs on one database share the file: it is locked while read or
+// written, and commands sit in it in the order they were committed.
+void initUndo(const std::string &spillPath);
+void shutdownUndo();
+
+// Groups may nest; the outermost label names the command
+void beginUndoGroup(const std::string &label);
+void endUndoGroup();
+// Close the group without recording it (its transaction was rolled back)
+void cancelUndoGroup();
+
+bool canUndo();
+bool canRedo();
+std::string undoLabel();
+std::string redoLabel();
+
+// Revert / re-apply the latest command in one transaction. On failure the
+// transaction is rolled back and the journal is left unchanged. A product
+// someone else changed or deleted since the command is a conflict: nothing
+// is overwritten and the reason is printed to stderr.
+bool undo();
+bool redo();
+
+struct UndoStats {
+    int memoryCommands;   // undoable commands held in memory
+    int spilledCommands;  // undoable commands in the spill file
+    int redoCommands;
+    long memoryChanges;   // row images held in memory (undo + redo)
+};
+UndoStats getUndoStats();
+
+#endif // UNDO_HPP
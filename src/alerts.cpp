@@ -0,0 +1,63 @@
+#include "alerts.hpp"
+
+static std::map<int, StockAlert> alerts;
+static unsigned revision = 0;
+static int observerHandle = 0;
+
+static bool isLowStock(const Product &p)
+{
+    return p.id >= 0 && p.quantity < p.reorderLevel;
+}
+
+// Apply the new state of one product; cost is independent of catalogue size
+static void applyProduct(int id, const Product &p)
+{
+    if (isLowStock(p))
+    {
+        alerts[id] = {p.id, p.name, p.quantity, p.reorderLevel};
+        ++revision;
+    }
+    else if (alerts.erase(id) > 0)
+    {
+        ++revision;
+    }
+}
+
+static void onProductChange(const ProductChange &change)
+{
+    int id = change.kind == ProductChange::Deleted ? change.before.id : change.after.id;
+    applyProduct(id, change.after);
+}
+
+void initAlerts()
+{
+    if (observerHandle)
+        return;
+
+    alerts.clear();
+    for (const Product &p : openLowStockProducts())
+        alerts[p.id] = {p.id, p.name, p.quantity, p.reorderLevel};
+    ++revision;
+
+    observerHandle = addProductObserver(onProductChange);
+}
+
+void shutdownAlerts()
+{
+    if (observerHandle)
+    {
+        removeProductObserver(observerHandle);
+        observerHandle = 0;
+    }
+    alerts.clear();
+}
+
+const std::map<int, StockAlert> &getStockAlerts()
+{
+    return alerts;
+}
+
+unsigned getAlertsRevision()
+{
+    return revision;
+}
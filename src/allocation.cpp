@@ -0,0 +1,267 @@
+#include "allocation.hpp"
+#include "db.hpp"
+#include "seed.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+struct QueuedLot
+{
+    std::string expires;
+    int id;
+    int remaining;
+    std::string code;
+};
+
+// The heap of one product and what it was built from. version is the
+// product's row version at that point plus one per lot this module has
+// decremented since (the lot_changed trigger bumps it once per lot); any
+// other change to the product or its lots makes the two differ.
+struct LotQueue
+{
+    int version = -1;
+    std::string today;
+    long long available = 0;
+    std::vector<QueuedLot> heap;
+};
+
+static std::unordered_map<int, LotQueue> queues;
+
+// std::*_heap keep the greatest element on top, so a lot is "less" than
+// another when it expires later. Lots without a date come after every
+// dated one; equal dates go by receipt (lot ID).
+static bool expiresLater(const QueuedLot &a, const QueuedLot &b)
+{
+    if (a.expires.empty() != b.expires.empty())
+        return a.expires.empty();
+    if (a.expires != b.expires)
+        return a.expires > b.expires;
+    return a.id > b.id;
+}
+
+static LotQueue *queueFor(int productId, const std::string &today)
+{
+    Product product = getProductById(productId);
+    if (product.id < 0)
+    {
+        queues.erase(productId);
+        return nullptr;
+    }
+
+    LotQueue &queue = queues[productId];
+    if (queue.version == product.version && queue.today == today)
+        return &queue;
+
+    queue.version = product.version;
+    queue.today = today;
+    queue.available = 0;
+    queue.heap.clear();
+    for (const Lot &lot : openProductLots(productId))
+    {
+        if (!lot.expires.empty() && lot.expires < today)
+            continue;
+        queue.heap.push_back({lot.expires, lot.id, lot.quantity, lot.code});
+        queue.available += lot.quantity;
+    }
+    std::make_heap(queue.heap.begin(), queue.heap.end(), expiresLater);
+    return &queue;
+}
+
+bool allocateFefo(int productId, int quantity, const std::string &today, std::vector<LotPick> &picks)
+{
+    LotQueue *queue = quantity > 0 ? queueFor(productId, today) : nullptr;
+    if (!queue || queue->available < quantity)
+        return false;
+
+    // Take from the top until the line is covered. An emptied lot is popped;
+    // the last one usually keeps some units and stays on top, since its key
+    // did not change.
+    std::vector<Lot> takes;
+    size_t firstPick = picks.size();
+    for (int needed = quantity; needed > 0;)
+    {
+        QueuedLot &top = queue->heap.front();
+        int take = std::min(top.remaining, needed);
+        takes.push_back({top.id, productId, "", "", take});
+        picks.push_back({top.id, top.code, top.expires, take});
+        needed -= take;
+        top.remaining -= take;
+        if (top.remaining == 0)
+        {
+            std::pop_heap(queue->heap.begin(), queue->heap.end(), expiresLater);
+            queue->heap.pop_back();
+        }
+    }
+
+    if (!consumeLots(productId, takes))
+    {
+        // The heap no longer matches the database; rebuild it next time
+        picks.resize(firstPick);
+        queues.erase(productId);
+        return false;
+    }
+    queue->available -= quantity;
+    queue->version += (int)takes.size();
+    return true;
+}
+
+long long availableUnits(int productId, const std::string &today)
+{
+    LotQueue *queue = queueFor(productId, today);
+    return queue ? queue->available : 0;
+}
+
+void clearLotQueues()
+{
+    queues.clear();
+}
+
+static std::string dateInDays(int days)
+{
+    time_t when = time(nullptr) + (time_t)days * 86400;
+    char text[16];
+    strftime(text, sizeof(text), "%Y-%m-%d", localtime(&when));
+    return text;
+}
+
+std::string todayDate()
+{
+    return dateInDays(0);
+}
+
+// The per-line query the heap replaces: read the product's lots in expiry
+// order and take from them until the line is covered
+static bool allocateByQuery(int productId, int quantity, const std::string &today, std::vector<LotPick> &picks)
+{
+    std::vector<Lot> takes;
+    int needed = quantity;
+    for (const Lot &lot : openProductLots(productId))
+    {
+        if (needed == 0)
+            break;
+        if (!lot.expires.empty() && lot.expires < today)
+            continue;
+        int take = std::min(lot.quantity, needed);
+        takes.push_back({lot.id, productId, "", "", take});
+        picks.push_back({lot.id, lot.code, lot.expires, take});
+        needed -= take;
+    }
+    if (needed > 0 || !consumeLots(productId, takes))
+    {
+        picks.resize(picks.size() - takes.size());
+        return false;
+    }
+    return true;
+}
+
+// Fresh scratch catalogue with the same lots every time; some expired already
+static bool seedLots(const AllocationBenchOptions &options)
+{
+    removeDatabaseFiles(options.dbPath);
+    if (!initDB(options.dbPath) || !seedCatalogue(options.rows) || !beginTransaction())
+        return false;
+
+    std::mt19937 rng(11);
+    for (int id = 1; id <= options.rows; ++id)
+        for (int l = 0; l < options.lots; ++l)
+        {
+            std::string expires = dateInDays((int)(rng() % 400) - 30);
+            if (receiveLot(id, "L" + std::to_string(l), expires, 20 + (int)(rng() % 180)) < 0)
+            {
+                rollbackTransaction();
+                return false;
+            }
+        }
+    return commitTransaction();
+}
+
+struct BenchRun
+{
+    double seconds = 0.0;
+    long long allocated = 0;  // units
+    long long unitsTaken = 0; // how much the stored totals dropped
+    long long shortLines = 0;
+    unsigned long long pickHash = 0;
+};
+
+using Allocator = bool (*)(int, int, const std::string &, std::vector<LotPick> &);
+
+static bool runAllocator(const AllocationBenchOptions &options, Allocator allocate, BenchRun &run)
+{
+    if (!seedLots(options))
+    {
+        std::cerr << "Failed to seed " << options.dbPath << std::endl;
+        return false;
+    }
+    clearLotQueues();
+    long long unitsBefore = getInventorySummary().totalUnits;
+    std::string today = todayDate();
+
+    std::mt19937 rng(23);
+    std::vector<LotPick> picks;
+    bool ok = true;
+    Clock::time_point start = Clock::now();
+    for (int line = 0; ok && line < options.lines; ++line)
+    {
+        if (line % options.batch == 0)
+            ok = (line == 0 || commitTransaction()) && beginTransaction();
+
+        int productId = (int)(rng() % options.rows) + 1;
+        int quantity = 1 + (int)(rng() % 10);
+        picks.clear();
+        if (!allocate(productId, quantity, today, picks))
+        {
+            ++run.shortLines;
+            continue;
+        }
+        run.allocated += quantity;
+        for (const LotPick &p : picks)
+            run.pickHash = run.pickHash * 1000003 + (unsigned long long)p.lotId * 31 + p.quantity;
+    }
+    ok = ok && commitTransaction();
+    run.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    run.unitsTaken = unitsBefore - getInventorySummary().totalUnits;
+    closeDB();
+    removeDatabaseFiles(options.dbPath);
+    return ok;
+}
+
+int runAllocationBench(const AllocationBenchOptions &options)
+{
+    std::printf("%d products x %d lots, %d order lines, %d lines per transaction\n\n", options.rows, options.lots,
+                options.lines, options.batch);
+    std::printf("%-14s %12s %10s %12s %8s  %s\n", "", "lines/s", "us/line", "units", "short", "units check");
+
+    const struct
+    {
+        const char *label;
+        Allocator allocate;
+    } methods[] = {{"query per line", allocateByQuery}, {"fefo heaps", allocateFefo}};
+
+    int status = 0;
+    BenchRun runs[2];
+    for (int m = 0; m < 2; ++m)
+    {
+        BenchRun &run = runs[m];
+        if (!runAllocator(options, methods[m].allocate, run))
+            status = 1;
+
+        bool consistent = run.unitsTaken == run.allocated;
+        std::printf("%-14s %12.0f %10.2f %12lld %8lld  %s\n", methods[m].label, options.lines / run.seconds,
+                    1e6 * run.seconds / options.lines, run.allocated, run.shortLines, consistent ? "ok" : "MISMATCH");
+        if (!consistent)
+            status = 1;
+    }
+
+    // Both must pick the very same lots in the same order
+    bool same = runs[0].pickHash == runs[1].pickHash && runs[0].allocated == runs[1].allocated;
+    std::printf("\npicks %s\n", same ? "identical" : "DIFFER");
+    return same ? status : 1;
+}
@@ -0,0 +1,370 @@
+#include "audit.hpp"
+#include "db.hpp"
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// Upper bound on records per transaction, and how often the writer wakes
+// up on its own when the queue has not filled a batch
+static const size_t maxBatch = 512;
+static const std::chrono::milliseconds writerInterval(50);
+// A batch that cannot be committed (disk full, file locked past the busy
+// timeout) stays queued and is retried on the writer's next wake-ups; only
+// after this many attempts are its records given up as lost
+static const int maxAttempts = 5;
+
+// Multi-producer, single-consumer queue (Vyukov). push() is one atomic
+// exchange and never blocks; only the writer thread pops.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head(&stub), tail(&stub) {}
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value))
+        {
+        }
+        if (tail != &stub)
+            delete tail;
+    }
+
+    void push(T value)
+    {
+        Node *node = new Node;
+        node->value = std::move(value);
+        Node *prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer only. The node that held the popped value becomes the new dummy.
+    bool pop(T &out)
+    {
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+
+        out = std::move(next->value);
+        if (tail != &stub)
+            delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};
+        T value;
+    };
+
+    Node stub;
+    std::atomic<Node *> head;
+    Node *tail;
+};
+
+static MpscQueue<AuditEntry> queue;
+static std::atomic<long long> queuedCount{0};
+static std::atomic<long long> writtenCount{0}; // committed
+static std::atomic<long long> lostCount{0};
+static std::atomic<int> batchCount{0};
+static std::atomic<double> lastBatchMs{0.0};
+
+static std::thread writer;
+static std::mutex wakeMutex;
+static std::condition_variable wakeWriter;
+static std::condition_variable batchWritten;
+static bool wakeRequested = false;
+static bool stopRequested = false;
+
+static sqlite3 *writeDB = nullptr; // writer thread only
+static sqlite3 *readDB = nullptr;  // caller's thread (history queries)
+static std::string user;
+static std::string source;
+static int observerHandle = 0;
+
+static long long nowMs()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static void requestWrite()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeRequested = true;
+    }
+    wakeWriter.notify_one();
+}
+
+static void onProductChange(const ProductChange &change)
+{
+    AuditEntry entry;
+    entry.changedAt = nowMs();
+    entry.productId = change.kind == ProductChange::Deleted ? change.before.id : change.after.id;
+    entry.action = change.kind == ProductChange::Added ? "add" : change.kind == ProductChange::Deleted ? "delete" : "update";
+    entry.name = change.kind == ProductChange::Deleted ? change.before.name : change.after.name;
+    entry.oldQuantity = change.before.id >= 0 ? change.before.quantity : 0;
+    entry.newQuantity = change.after.id >= 0 ? change.after.quantity : 0;
+    entry.oldPrice = change.before.id >= 0 ? change.before.price : Money{};
+    entry.newPrice = change.after.id >= 0 ? change.after.price : Money{};
+
+    queue.push(std::move(entry));
+
+    // Only a full batch is worth waking the writer early for
+    if (++queuedCount % (long long)maxBatch == 0)
+        requestWrite();
+}
+
+static bool openAuditDB(const std::string &path, sqlite3 **out)
+{
+    if (sqlite3_open(path.c_str(), out) != SQLITE_OK)
+    {
+        std::cerr << "Failed to open audit log: " << sqlite3_errmsg(*out) << std::endl;
+        sqlite3_close(*out);
+        *out = nullptr;
+        return false;
+    }
+    // Readers and the writer never block each other in WAL mode
+    sqlite3_busy_timeout(*out, 5000);
+    sqlite3_exec(*out, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+    return true;
+}
+
+// All or nothing: false leaves no record of the batch in the file
+static bool writeBatch(const std::vector<AuditEntry> &batch)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    sqlite3_stmt *stmt = nullptr;
+    const char *sql = "INSERT INTO audit_log (changed_at, user, source, product_id, action, name,"
+                      " old_quantity, new_quantity, old_price_cents, new_price_cents) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+    if (sqlite3_exec(writeDB, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(writeDB, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Audit log write failed: " << sqlite3_errmsg(writeDB) << std::endl;
+        sqlite3_exec(writeDB, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    for (const AuditEntry &e : batch)
+    {
+        sqlite3_bind_int64(stmt, 1, e.changedAt);
+        sqlite3_bind_text(stmt, 2, user.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, source.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, e.productId);
+        sqlite3_bind_text(stmt, 5, e.action.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, e.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 7, e.oldQuantity);
+        sqlite3_bind_int(stmt, 8, e.newQuantity);
+        sqlite3_bind_int64(stmt, 9, e.oldPrice.cents);
+        sqlite3_bind_int64(stmt, 10, e.newPrice.cents);
+        bool inserted = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+        if (!inserted)
+        {
+            std::cerr << "Audit log insert failed: " << sqlite3_errmsg(writeDB) << std::endl;
+            sqlite3_finalize(stmt);
+            sqlite3_exec(writeDB, "ROLLBACK;", nullptr, nullptr, nullptr);
+            return false;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    if (sqlite3_exec(writeDB, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Audit log commit failed: " << sqlite3_errmsg(writeDB) << std::endl;
+        sqlite3_exec(writeDB, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    batchCount++;
+    lastBatchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+static void writerLoop()
+{
+    std::vector<AuditEntry> batch;
+    batch.reserve(maxBatch);
+    int attempts = 0;
+
+    for (;;)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeWriter.wait_for(lock, writerInterval, []
+                                { return wakeRequested || stopRequested; });
+            wakeRequested = false;
+            stopping = stopRequested;
+        }
+
+        // Drain everything queued so far, one transaction per batch
+        AuditEntry entry;
+        for (;;)
+        {
+            while (batch.size() < maxBatch && queue.pop(entry))
+                batch.push_back(std::move(entry));
+            if (batch.empty())
+                break;
+
+            bool written = writeBatch(batch);
+            if (!written && ++attempts < maxAttempts)
+            {
+                // Retry after the next wait; when stopping there is none
+                if (!stopping)
+                    break;
+                std::this_thread::sleep_for(writerInterval);
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                (written ? writtenCount : lostCount) += (long long)batch.size();
+            }
+            if (!written)
+                std::cerr << "Audit log: gave up on " << batch.size() << " records after " << maxAttempts
+                          << " attempts" << std::endl;
+            attempts = 0;
+            batchWritten.notify_all();
+            batch.clear();
+        }
+
+        if (stopping)
+            return;
+    }
+}
+
+bool initAudit(const std::string &dbPath, const std::string &auditSource)
+{
+    if (observerHandle)
+        return true;
+
+    std::string path = dbPath + ".audit";
+    if (!openAuditDB(path, &writeDB))
+        return false;
+
+    const char *schema = R"(
+        CREATE TABLE IF NOT EXISTS audit_log (
+            id INTEGER PRIMARY KEY,
+            changed_at INTEGER NOT NULL,
+            user TEXT NOT NULL,
+            source TEXT NOT NULL,
+            product_id INTEGER NOT NULL,
+            action TEXT NOT NULL,
+            name TEXT NOT NULL,
+            old_quantity INTEGER NOT NULL,
+            new_quantity INTEGER NOT NULL,
+            old_price_cents INTEGER NOT NULL,
+            new_price_cents INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_audit_product ON audit_log(product_id, id);
+    )";
+    if (sqlite3_exec(writeDB, schema, nullptr, nullptr, nullptr) != SQLITE_OK || !openAuditDB(path, &readDB))
+    {
+        std::cerr << "Failed to set up audit log: " << sqlite3_errmsg(writeDB) << std::endl;
+        sqlite3_close(writeDB);
+        writeDB = nullptr;
+        return false;
+    }
+
+    const char *login = std::getenv("USER");
+    if (!login)
+        login = std::getenv("USERNAME");
+    user = login ? login : "unknown";
+    source = auditSource;
+
+    stopRequested = false;
+    writer = std::thread(writerLoop);
+    observerHandle = addProductObserver(onProductChange);
+    return true;
+}
+
+void shutdownAudit()
+{
+    if (!observerHandle)
+        return;
+
+    removeProductObserver(observerHandle);
+    observerHandle = 0;
+
+    // The writer drains the queue completely before it exits
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopRequested = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+
+    if (lostCount > 0)
+        std::cerr << "Audit log: " << lostCount << " of " << queuedCount << " records could not be written and are lost"
+                  << std::endl;
+
+    sqlite3_close(writeDB);
+    sqlite3_close(readDB);
+    writeDB = nullptr;
+    readDB = nullptr;
+}
+
+void flushAudit()
+{
+    if (!observerHandle)
+        return;
+
+    long long target = queuedCount.load();
+    requestWrite();
+
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    batchWritten.wait(lock, [target]
+                      { return writtenCount.load() + lostCount.load() >= target; });
+}
+
+std::vector<AuditEntry> getProductHistory(int productId, int limit)
+{
+    std::vector<AuditEntry> history;
+    if (!readDB)
+        return history;
+
+    flushAudit();
+
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT changed_at, user, source, product_id, action, name, old_quantity, new_quantity,"
+                      " old_price_cents, new_price_cents FROM audit_log WHERE product_id = ? ORDER BY id DESC LIMIT ?;";
+    if (sqlite3_prepare_v2(readDB, sql, -1, &stmt, nullptr) != SQLITE_OK)
+        return history;
+
+    sqlite3_bind_int(stmt, 1, productId);
+    sqlite3_bind_int(stmt, 2, limit);
+
+    auto text = [stmt](int column)
+    {
+        const unsigned char *value = sqlite3_column_text(stmt, column);
+        return std::string(value ? reinterpret_cast<const char *>(value) : "");
+    };
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        history.push_back({sqlite3_column_int64(stmt, 0), text(1), text(2), sqlite3_column_int(stmt, 3),
+                           text(4), text(5), sqlite3_column_int(stmt, 6), sqlite3_column_int(stmt, 7),
+                           Money::fromCents(sqlite3_column_int64(stmt, 8)),
+                           Money::fromCents(sqlite3_column_int64(stmt, 9))});
+    }
+
+    sqlite3_finalize(stmt);
+    return history;
+}
+
+AuditStats getAuditStats()
+{
+    return {queuedCount.load(), writtenCount.load(), lostCount.load(), batchCount.load(), lastBatchMs.load()};
+}
@@ -0,0 +1,120 @@
+#include "barcode.hpp"
+#include "db.hpp"
+#include "undo.hpp"
+#include <unordered_map>
+#include <vector>
+
+// How many scans the panel keeps for display
+static const size_t maxRecentScans = 50;
+
+static std::unordered_map<std::string, int> codeToProduct;
+static int observerHandle = 0;
+
+static bool scanMode = false;
+static std::string scanBuffer;
+static std::vector<std::string> pendingScans;
+static std::deque<ScanResult> recentScans;
+
+static void onProductChange(const ProductChange &change)
+{
+    // Only the codes of the changed row are touched
+    if (!change.before.sku.empty() && change.before.sku != change.after.sku)
+        codeToProduct.erase(change.before.sku);
+    if (change.after.id >= 0 && !change.after.sku.empty())
+        codeToProduct[change.after.sku] = change.after.id;
+}
+
+void initBarcodeIndex()
+{
+    if (observerHandle)
+        return;
+
+    codeToProduct.clear();
+    for (const SkuEntry &entry : openSkus())
+        codeToProduct[entry.sku] = entry.productId;
+
+    observerHandle = addProductObserver(onProductChange);
+}
+
+void shutdownBarcodeIndex()
+{
+    if (observerHandle)
+    {
+        removeProductObserver(observerHandle);
+        observerHandle = 0;
+    }
+    codeToProduct.clear();
+}
+
+int findProductByCode(const std::string &code)
+{
+    auto it = codeToProduct.find(code);
+    return it == codeToProduct.end() ? -1 : it->second;
+}
+
+void setScanMode(bool enabled)
+{
+    scanMode = enabled;
+    scanBuffer.clear();
+}
+
+bool isScanMode()
+{
+    return scanMode;
+}
+
+void feedScanText(const char *text)
+{
+    scanBuffer += text;
+}
+
+void completeScan()
+{
+    if (!scanBuffer.empty())
+        pendingScans.push_back(std::move(scanBuffer));
+    scanBuffer.clear();
+}
+
+int applyPendingScans(int delta)
+{
+    if (pendingScans.empty())
+        return 0;
+
+    // A burst of scans from one frame costs a single commit
+    bool batched = pendingScans.size() > 1 && beginTransaction();
+    beginUndoGroup(pendingScans.size() > 1 ? std::to_string(pendingScans.size()) + " scans" : "Scan " + pendingScans[0]);
+    int applied = 0;
+
+    for (const std::string &code : pendingScans)
+    {
+        ScanResult result = {code, findProductByCode(code), delta, 0, false};
+        if (result.productId >= 0 && adjustQuantity(result.productId, delta))
+        {
+            result.applied = true;
+            result.newQuantity = getProductById(result.productId).quantity;
+            ++applied;
+        }
+
+        recentScans.push_front(result);
+        if (recentScans.size() > maxRecentScans)
+            recentScans.pop_back();
+    }
+
+    if (batched && !commitTransaction())
+    {
+        cancelUndoGroup();
+        rollbackTransaction();
+        applied = 0;
+        for (size_t i = 0; i < pendingScans.size() && i < recentScans.size(); ++i)
+            recentScans[i].applied = false;
+    }
+
+    endUndoGroup();
+    pendingScans.clear();
+    return applied;
+}
+
+const std::deque<ScanResult> &getRecentScans()
+{
+    return recentScans;
+}
@@ -0,0 +1,342 @@
+#include "bitmap.hpp"
+#include <algorithm>
+#include <iterator>
+
+// Groups with more values than this switch from a sorted array (2 bytes per
+// value) to a bitset (8 KB), the point where the bitset becomes smaller
+static const uint32_t arrayLimit = 4096;
+static const size_t bitsetWords = 65536 / 64;
+
+static int popcount(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int n = 0;
+    for (; word; word &= word - 1)
+        ++n;
+    return n;
+#endif
+}
+
+static int ctz(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int n = 0;
+    while (!(word & 1))
+    {
+        word >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+int RoaringBitmap::countTrailingZeros(uint64_t word)
+{
+    return ctz(word);
+}
+
+static bool testBit(const std::vector<uint64_t> &bits, uint16_t low)
+{
+    return (bits[low >> 6] >> (low & 63)) & 1;
+}
+
+static uint32_t countBits(const std::vector<uint64_t> &bits)
+{
+    uint32_t n = 0;
+    for (uint64_t word : bits)
+        n += popcount(word);
+    return n;
+}
+
+template <typename Container>
+static void toBitset(Container &c)
+{
+    c.bits.assign(bitsetWords, 0);
+    for (uint16_t low : c.array)
+        c.bits[low >> 6] |= 1ULL << (low & 63);
+    std::vector<uint16_t>().swap(c.array);
+}
+
+template <typename Container>
+static void toArray(Container &c)
+{
+    c.array.clear();
+    c.array.reserve(c.cardinality);
+    for (size_t w = 0; w < c.bits.size(); ++w)
+        for (uint64_t word = c.bits[w]; word; word &= word - 1)
+            c.array.push_back((uint16_t)(w * 64 + ctz(word)));
+    std::vector<uint64_t>().swap(c.bits);
+}
+
+RoaringBitmap::Container *RoaringBitmap::find(uint16_t key)
+{
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container &c, uint16_t k) { return c.key < k; });
+    return it != containers.end() && it->key == key ? &*it : nullptr;
+}
+
+const RoaringBitmap::Container *RoaringBitmap::find(uint16_t key) const
+{
+    return const_cast<RoaringBitmap *>(this)->find(key);
+}
+
+void RoaringBitmap::add(uint32_t value)
+{
+    uint16_t key = (uint16_t)(value >> 16), low = (uint16_t)value;
+
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container &c, uint16_t k) { return c.key < k; });
+    if (it == containers.end() || it->key != key)
+    {
+        it = containers.insert(it, Container());
+        it->key = key;
+    }
+
+    if (it->isBitset())
+    {
+        uint64_t &word = it->bits[low >> 6];
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(word & mask))
+        {
+            word |= mask;
+            ++it->cardinality;
+        }
+        return;
+    }
+
+    auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+    if (pos != it->array.end() && *pos == low)
+        return;
+    it->array.insert(pos, low);
+    if (++it->cardinality > arrayLimit)
+        toBitset(*it);
+}
+
+void RoaringBitmap::remove(uint32_t value)
+{
+    uint16_t key = (uint16_t)(value >> 16), low = (uint16_t)value;
+    Container *c = find(key);
+    if (!c)
+        return;
+
+    if (c->isBitset())
+    {
+        uint64_t &word = c->bits[low >> 6];
+        uint64_t mask = 1ULL << (low & 63);
+        if (!(word & mask))
+            return;
+        word &= ~mask;
+        if (--c->cardinality <= arrayLimit)
+            toArray(*c);
+    }
+    else
+    {
+        auto pos = std::lower_bound(c->array.begin(), c->array.end(), low);
+        if (pos == c->array.end() || *pos != low)
+            return;
+        c->array.erase(pos);
+        --c->cardinality;
+    }
+
+    if (c->cardinality == 0)
+        containers.erase(containers.begin() + (c - containers.data()));
+}
+
+bool RoaringBitmap::contains(uint32_t value) const
+{
+    const Container *c = find((uint16_t)(value >> 16));
+    if (!c)
+        return false;
+    uint16_t low = (uint16_t)value;
+    return c->isBitset() ? testBit(c->bits, low) : std::binary_search(c->array.begin(), c->array.end(), low);
+}
+
+uint64_t RoaringBitmap::cardinality() const
+{
+    uint64_t n = 0;
+    for (const Container &c : containers)
+        n += c.cardinality;
+    return n;
+}
+
+RoaringBitmap &RoaringBitmap::operator&=(const RoaringBitmap &other)
+{
+    std::vector<Container> result;
+    auto a = containers.begin();
+    auto b = other.containers.begin();
+
+    while (a != containers.end() && b != other.containers.end())
+    {
+        if (a->key < b->key)
+        {
+            ++a;
+            continue;
+        }
+        if (b->key < a->key)
+        {
+            ++b;
+            continue;
+        }
+
+        Container c;
+        c.key = a->key;
+        if (a->isBitset() && b->isBitset())
+        {
+            c.bits = std::move(a->bits);
+            for (size_t w = 0; w < bitsetWords; ++w)
+                c.bits[w] &= b->bits[w];
+            c.cardinality = countBits(c.bits);
+            if (c.cardinality <= arrayLimit)
+                toArray(c);
+        }
+        else if (a->isBitset() || b->isBitset())
+        {
+            const Container &array = a->isBitset() ? *b : *a;
+            const Container &bitset = a->isBitset() ? *a : *b;
+            for (uint16_t low : array.array)
+                if (testBit(bitset.bits, low))
+                    c.array.push_back(low);
+            c.cardinality = (uint32_t)c.array.size();
+        }
+        else
+        {
+            std::set_intersection(a->array.begin(), a->array.end(), b->array.begin(), b->array.end(),
+                                  std::back_inserter(c.array));
+            c.cardinality = (uint32_t)c.array.size();
+        }
+
+        if (c.cardinality)
+            result.push_back(std::move(c));
+        ++a;
+        ++b;
+    }
+
+    containers = std::move(result);
+    return *this;
+}
+
+RoaringBitmap &RoaringBitmap::operator|=(const RoaringBitmap &other)
+{
+    std::vector<Container> result;
+    result.reserve(containers.size() + other.containers.size());
+    auto a = containers.begin();
+    auto b = other.containers.begin();
+
+    while (a != containers.end() || b != other.containers.end())
+    {
+        if (b == other.containers.end() || (a != containers.end() && a->key < b->key))
+        {
+            result.push_back(std::move(*a++));
+            continue;
+        }
+        if (a == containers.end() || b->key < a->key)
+        {
+            result.push_back(*b++);
+            continue;
+        }
+
+        Container c;
+        c.key = a->key;
+        if (a->isBitset() || b->isBitset())
+        {
+            bool ownBits = a->isBitset();
+            const Container &rest = ownBits ? *b : *a;
+            if (ownBits)
+                c.bits = std::move(a->bits);
+            else
+                c.bits = b->bits;
+            if (rest.isBitset())
+            {
+                for (size_t w = 0; w < bitsetWords; ++w)
+                    c.bits[w] |= rest.bits[w];
+            }
+            else
+            {
+                for (uint16_t low : rest.array)
+                    c.bits[low >> 6] |= 1ULL << (low & 63);
+            }
+            c.cardinality = countBits(c.bits);
+        }
+        else
+        {
+            std::set_union(a->array.begin(), a->array.end(), b->array.begin(), b->array.end(),
+                           std::back_inserter(c.array));
+            c.cardinality = (uint32_t)c.array.size();
+            if (c.cardinality > arrayLimit)
+                toBitset(c);
+        }
+
+        result.push_back(std::move(c));
+        ++a;
+        ++b;
+    }
+
+    containers = std::move(result);
+    return *this;
+}
+
+uint64_t RoaringBitmap::andCardinality(const RoaringBitmap &x, const RoaringBitmap &y)
+{
+    uint64_t n = 0;
+    auto a = x.containers.begin();
+    auto b = y.containers.begin();
+
+    while (a != x.containers.end() && b != y.containers.end())
+    {
+        if (a->key < b->key)
+        {
+            ++a;
+            continue;
+        }
+        if (b->key < a->key)
+        {
+            ++b;
+            continue;
+        }
+
+        if (a->isBitset() && b->isBitset())
+        {
+            for (size_t w = 0; w < bitsetWords; ++w)
+                n += popcount(a->bits[w] & b->bits[w]);
+        }
+        else if (a->isBitset() || b->isBitset())
+        {
+            const Container &array = a->isBitset() ? *b : *a;
+            const Container &bitset = a->isBitset() ? *a : *b;
+            for (uint16_t low : array.array)
+                n += testBit(bitset.bits, low);
+        }
+        else
+        {
+            auto i = a->array.begin(), j = b->array.begin();
+            while (i != a->array.end() && j != b->array.end())
+            {
+                if (*i < *j)
+                    ++i;
+                else if (*j < *i)
+                    ++j;
+                else
+                {
+                    ++n;
+                    ++i;
+                    ++j;
+                }
+            }
+        }
+        ++a;
+        ++b;
+    }
+    return n;
+}
+
+size_t RoaringBitmap::bytes() const
+{
+    size_t n = containers.capacity() * sizeof(Container);
+    for (const Container &c : containers)
+        n += c.array.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+    return n;
+}
@@ -0,0 +1,171 @@
+#include "busy_overlay.hpp"
+#include "query_pump.hpp"
+#include "imgui.h"
+#include "imgui_impl_opengl3.h"
+#ifdef __APPLE__
+#include <OpenGL/gl3.h>
+#else
+#include <SDL2/SDL_opengl.h>
+#endif
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+
+static SDL_Window *overlayWindow = nullptr;
+static ImVec2 mouse(-1.0f, -1.0f);
+static std::deque<SDL_Event> deferred;
+
+struct OverlayLayout
+{
+    ImVec2 size; // window, in the same coordinates as mouse events
+    ImVec2 panelMin, panelMax;
+    ImVec2 barMin, barMax;
+    ImVec2 buttonMin, buttonMax;
+};
+
+static OverlayLayout layoutOverlay()
+{
+    int w, h;
+    SDL_GetWindowSize(overlayWindow, &w, &h);
+
+    OverlayLayout l;
+    l.size = ImVec2((float)w, (float)h);
+    ImVec2 center(w * 0.5f, h * 0.5f);
+    l.panelMin = ImVec2(center.x - 180, center.y - 70);
+    l.panelMax = ImVec2(center.x + 180, center.y + 70);
+    l.barMin = ImVec2(l.panelMin.x + 20, center.y - 8);
+    l.barMax = ImVec2(l.panelMax.x - 20, center.y + 8);
+    l.buttonMin = ImVec2(center.x - 70, l.panelMax.y - 50);
+    l.buttonMax = ImVec2(center.x + 70, l.panelMax.y - 14);
+    return l;
+}
+
+static bool contains(ImVec2 min, ImVec2 max, ImVec2 p)
+{
+    return p.x >= min.x && p.y >= min.y && p.x < max.x && p.y < max.y;
+}
+
+// Only the overlay's own controls are acted on here; everything else waits
+// for the next frame
+static void pumpEvents(const OverlayLayout &layout)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)
+        {
+            requestQueryCancel();
+            continue;
+        }
+        if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT &&
+            contains(layout.buttonMin, layout.buttonMax, ImVec2((float)event.button.x, (float)event.button.y)))
+        {
+            requestQueryCancel();
+            continue;
+        }
+
+        if (event.type == SDL_QUIT)
+            requestQueryCancel();
+        else if (event.type == SDL_MOUSEMOTION)
+            mouse = ImVec2((float)event.motion.x, (float)event.motion.y);
+        deferred.push_back(event);
+    }
+}
+
+static void drawText(ImDrawList &list, ImFont *font, ImVec2 center, ImU32 color, const char *text)
+{
+    ImVec2 size = font->CalcTextSizeA(font->FontSize, FLT_MAX, 0.0f, text);
+    list.AddText(font, font->FontSize, ImVec2(center.x - size.x * 0.5f, center.y - size.y * 0.5f), color, text);
+}
+
+// Drawn straight into a draw list: the ImGui frame that issued the query is
+// still open, so no second frame can be started
+static void drawOverlay(const OverlayLayout &l, double seconds)
+{
+    ImGuiIO &io = ImGui::GetIO();
+    ImFont *font = io.Fonts->Fonts[0];
+
+    ImDrawList list(ImGui::GetDrawListSharedData());
+    list._ResetForNewFrame();
+    list.PushTextureID(io.Fonts->TexID);
+    list.PushClipRectFullScreen();
+
+    list.AddRectFilled(l.panelMin, l.panelMax, IM_COL32(40, 40, 50, 255), 8.0f);
+    list.AddRect(l.panelMin, l.panelMax, IM_COL32(90, 90, 110, 255), 8.0f);
+
+    char title[64];
+    std::snprintf(title, sizeof(title), "Working... %.1f s", seconds);
+    drawText(list, font, ImVec2((l.panelMin.x + l.panelMax.x) * 0.5f, l.panelMin.y + 24), IM_COL32(230, 230, 230, 255),
+             title);
+
+    // No way to know how far a statement has got, so the bar just sweeps
+    float width = l.barMax.x - l.barMin.x;
+    float phase = (float)std::fmod(seconds, 1.2) / 1.2f;
+    float start = l.barMin.x + (width * 1.25f) * phase - width * 0.25f;
+    list.AddRectFilled(l.barMin, l.barMax, IM_COL32(25, 25, 30, 255), 4.0f);
+    list.AddRectFilled(ImVec2(std::max(start, l.barMin.x), l.barMin.y),
+                       ImVec2(std::min(start + width * 0.25f, l.barMax.x), l.barMax.y), IM_COL32(80, 170, 255, 255),
+                       4.0f);
+
+    bool hovered = contains(l.buttonMin, l.buttonMax, mouse);
+    list.AddRectFilled(l.buttonMin, l.buttonMax, hovered ? IM_COL32(200, 70, 70, 255) : IM_COL32(150, 50, 50, 255), 6.0f);
+    drawText(list, font, ImVec2((l.buttonMin.x + l.buttonMax.x) * 0.5f, (l.buttonMin.y + l.buttonMax.y) * 0.5f),
+             IM_COL32(255, 255, 255, 255), queryCancelRequested() ? "Cancelling..." : "Cancel (Esc)");
+
+    int fbWidth, fbHeight;
+    SDL_GL_GetDrawableSize(overlayWindow, &fbWidth, &fbHeight);
+
+    ImDrawData drawData;
+    drawData.Valid = true;
+    drawData.DisplayPos = ImVec2(0, 0);
+    drawData.DisplaySize = l.size;
+    drawData.FramebufferScale = ImVec2(fbWidth / std::max(l.size.x, 1.0f), fbHeight / std::max(l.size.y, 1.0f));
+    drawData.AddDrawList(&list);
+
+    glViewport(0, 0, fbWidth, fbHeight);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    ImGui_ImplOpenGL3_RenderDrawData(&drawData);
+    SDL_GL_SwapWindow(overlayWindow);
+}
+
+// Runs once a frame has been blocked for a while (see query_pump.hpp)
+static void pumpOverlay(double blockedSeconds)
+{
+    // Before the first frame the draw list data is not set up yet
+    if (ImGui::GetFrameCount() == 0)
+        return;
+
+    OverlayLayout layout = layoutOverlay();
+    pumpEvents(layout);
+    drawOverlay(layout, blockedSeconds);
+}
+
+void initBusyOverlay(SDL_Window *window)
+{
+    overlayWindow = window;
+    startQueryPump(pumpOverlay);
+}
+
+void shutdownBusyOverlay()
+{
+    stopQueryPump();
+    overlayWindow = nullptr;
+    deferred.clear();
+}
+
+void beginBusyFrame()
+{
+    beginPumpFrame();
+}
+
+bool takeDeferredEvent(SDL_Event &event)
+{
+    if (deferred.empty())
+        return false;
+    event = deferred.front();
+    deferred.pop_front();
+    return true;
+}
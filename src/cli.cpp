@@ -0,0 +1,1031 @@
+#include "cli.hpp"
+#include "allocation.hpp"
+#include "audit.hpp"
+#include "barcode.hpp"
+#include "db.hpp"
+#include "facets.hpp"
+#include "http_server.hpp"
+#include "plan_check.hpp"
+#include "product_view.hpp"
+#include "progress_bench.hpp"
+#include "query_log.hpp"
+#include "stress_writers.hpp"
+#include "timeseries.hpp"
+#include "undo.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct CLIOptions
+{
+    std::string dbPath = "inventory.db";
+    std::string command;
+    std::string file = "-";
+    int batchSize = 1000;
+    int scanDelta = 1;
+    int backupPages = 64;
+    int seriesPoints = 0;
+    double slowQueryMs = -1.0;
+    std::string slowQueryLog;
+    std::string today;              // allocate: expiry cut-off, default the local date
+    bool quiet = false;
+    bool descending = false;
+    HttpServerOptions server;
+    HttpLoadTestOptions loadTest;
+    PlanCheckOptions planCheck;
+    ProgressBenchOptions progressBench;
+    WriterStressOptions writerStress;
+    AllocationBenchOptions allocationBench;
+    BusyPolicy busy;
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: inventory-app [--db FILE] <command> [options] [FILE|-]\n"
+                 "\n"
+                 "Commands:\n"
+                 "  import            add products from CSV: name,quantity,price[,reorder_level[,sku]]\n"
+                 "  set-prices        update prices from CSV: id,price\n"
+                 "  export-valuation  write id,name,quantity,price,value as CSV\n"
+                 "  stats             print product count, units and stock value\n"
+                 "  scan              apply one barcode per line (quantity += --delta)\n"
+                 "  backup            copy the database to FILE while it stays in use\n"
+                 "  undo              revert the last change (import, scan, GUI edit, ...)\n"
+                 "  history ID        print the audit trail of one product\n"
+                 "  series ID         print the quantity/price history of a product (0 = catalogue)\n"
+                 "  sort COLUMN       print products ordered by id, name, quantity, price or sku\n"
+                 "  group COLUMN      units and value per first word of name, price or reorder level\n"
+                 "  facets [FILTER]   product counts per facet value; FILTER like 'Quantity=1-9,Price=Under 1.00'\n"
+                 "  locations         list locations with their product count and units\n"
+                 "  add-location NAME add a warehouse or other stock location\n"
+                 "  stock ID          stock at one location: id,name,quantity,total\n"
+                 "  stock-adjust      receive/ship stock from CSV: location_id,product_id,delta\n"
+                 "  move              move stock from CSV: product_id,from,to,quantity (0 = unassigned)\n"
+                 "  categories [ID]   subcategories of ID (default: top level) with subtree totals\n"
+                 "  add-category PATH add a category, creating missing parents (\"Tools/Hand tools\")\n"
+                 "  categorize        file products from CSV: product_id,category_id (0 = none)\n"
+                 "  move-category     reparent categories from CSV: category_id,new_parent_id (0 = top)\n"
+                 "  receive-lots      add lots from CSV: product_id,code,expires (YYYY-MM-DD or empty),quantity\n"
+                 "  lots ID           a product's lots, first to expire first: id,code,expires,quantity\n"
+                 "  allocate          pick order lines from CSV: order,product_id,quantity; prints\n"
+                 "                    order,product_id,lot_id,code,expires,quantity per pick (FEFO)\n"
+                 "  serve             run the local JSON API on 127.0.0.1\n"
+                 "  bench-http        load-test a running server (req/s, p50/p99 latency)\n"
+                 "  bench-progress    input latency during a multi-second query, with and without\n"
+                 "                    a progress handler, and how fast a cancel takes effect\n"
+                 "  check-http        request parsing checks for serve (JSON nesting, ...)\n"
+                 "  check-plans [FILE] seed FILE (default plan-check.db) and fail if an indexed\n"
+                 "                    product query scans the table or misses its time budget\n"
+                 "  stress-writers [FILE] several processes writing FILE (default stress.db) at once:\n"
+                 "                    throughput, failures, lock waits, and a consistency check\n"
+                 "  bench-occ [FILE]  concurrent product edits: blind overwrite vs pessimistic\n"
+                 "                    locking vs optimistic row versions (use a small --rows)\n"
+                 "  bench-fefo [FILE] batch FEFO allocation on FILE (default fefo-bench.db): lines/s\n"
+                 "                    with per-product lot heaps vs a lot query per order line\n"
+                 "\n"
+                 "Options:\n"
+                 "  --db FILE         database file (default inventory.db)\n"
+                 "  --batch N         rows per transaction for imports/updates (default 1000)\n"
+                 "  --quiet           no progress output\n"
+                 "  --delta N         scan quantity change per code (default 1)\n"
+                 "  --pages N         backup pages copied per step (default 64)\n"
+                 "  --desc            sort: descending order\n"
+                 "  --points N        series: downsample to N points (default all)\n"
+                 "  --slow-ms N       log statements taking at least N ms with their query plans\n"
+                 "  --slow-log FILE   write that log to FILE instead of stderr\n"
+                 "  --port N          serve / bench-http port (default 8080)\n"
+                 "  --threads N       serve worker threads (default 8)\n"
+                 "  --readers N       serve pooled read connections (default 4)\n"
+                 "  --wal             serve: switch the database to WAL first so reads never wait\n"
+                 "                    for writes (permanent; local disks only, not network shares)\n"
+                 "  --connections N   bench-http client connections (default 8)\n"
+                 "  --requests N      bench-http total requests (default 10000)\n"
+                 "  --pipeline N      bench-http requests in flight per connection (default 1)\n"
+                 "  --path PATH       bench-http request path (default /products/1)\n"
+                 "  --rows N          check-plans / stress-writers / bench-occ catalogue size (default 200000 / 1000)\n"
+                 "  --steps N         bench-progress VM instructions between handler calls (default 1000)\n"
+                 "  --seconds S       bench-progress query length / stress-writers, bench-occ run time (default 3 / 5)\n"
+                 "  --processes N     stress-writers / bench-occ writer processes (default 4)\n"
+                 "  --txn N           stress-writers changes per transaction (default 1)\n"
+                 "  --pause-ms MS     stress-writers / bench-occ think time before each change (default 0)\n"
+                 "  --min-share F     stress-writers: fail if a process commits less than F of the mean (default 0.1)\n"
+                 "  --edit-ms MS      bench-occ time between reading and saving a product (default 2)\n"
+                 "  --today DATE      allocate: lots that expired before DATE are skipped (default today)\n"
+                 "  --lots N          bench-fefo lots per product (default 20)\n"
+                 "  --lines N         bench-fefo order lines (default 100000)\n"
+                 "  --busy-timeout MS give up on a locked database after MS (default 3000)\n"
+                 "  --busy-retries N  also give up after N waits (default: no limit)\n"
+                 "\n"
+                 "FILE defaults to '-' (stdin for input commands, stdout for exports).\n";
+}
+
+static bool parseOptions(int argc, char **argv, CLIOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--db" && i + 1 < argc)
+            options.dbPath = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc)
+            options.batchSize = options.allocationBench.batch = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--desc")
+            options.descending = true;
+        else if (arg == "--quiet")
+            options.quiet = true;
+        else if (arg == "--delta" && i + 1 < argc)
+            options.scanDelta = std::atoi(argv[++i]);
+        else if (arg == "--pages" && i + 1 < argc)
+            options.backupPages = std::atoi(argv[++i]);
+        else if (arg == "--points" && i + 1 < argc)
+            options.seriesPoints = std::atoi(argv[++i]);
+        else if (arg == "--slow-ms" && i + 1 < argc)
+            options.slowQueryMs = std::atof(argv[++i]);
+        else if (arg == "--slow-log" && i + 1 < argc)
+            options.slowQueryLog = argv[++i];
+        else if (arg == "--port" && i + 1 < argc)
+            options.server.port = options.loadTest.port = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            options.server.threads = std::atoi(argv[++i]);
+        else if (arg == "--readers" && i + 1 < argc)
+            options.server.readConnections = std::atoi(argv[++i]);
+        else if (arg == "--wal")
+            options.server.wal = true;
+        else if (arg == "--connections" && i + 1 < argc)
+            options.loadTest.connections = std::atoi(argv[++i]);
+        else if (arg == "--requests" && i + 1 < argc)
+            options.loadTest.requests = std::atoi(argv[++i]);
+        else if (arg == "--pipeline" && i + 1 < argc)
+            options.loadTest.pipeline = std::atoi(argv[++i]);
+        else if (arg == "--path" && i + 1 < argc)
+            options.loadTest.path = argv[++i];
+        else if (arg == "--rows" && i + 1 < argc)
+            options.planCheck.rows = options.writerStress.rows = options.allocationBench.rows =
+                std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--lots" && i + 1 < argc)
+            options.allocationBench.lots = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--lines" && i + 1 < argc)
+            options.allocationBench.lines = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--today" && i + 1 < argc)
+            options.today = argv[++i];
+        else if (arg == "--steps" && i + 1 < argc)
+            options.progressBench.instructions = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seconds" && i + 1 < argc)
+            options.progressBench.seconds = options.writerStress.seconds = std::atof(argv[++i]);
+        else if (arg == "--processes" && i + 1 < argc)
+            options.writerStress.processes = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--pause-ms" && i + 1 < argc)
+            options.writerStress.pauseMs = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--min-share" && i + 1 < argc)
+            options.writerStress.minShare = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--edit-ms" && i + 1 < argc)
+            options.writerStress.editMs = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--txn" && i + 1 < argc)
+            options.writerStress.writesPerTransaction = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--busy-timeout" && i + 1 < argc)
+            options.busy.timeoutMs = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--busy-retries" && i + 1 < argc)
+            options.busy.maxRetries = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--help" || arg == "-h")
+            return false;
+        else if (options.command.empty())
+            options.command = arg;
+        else
+            options.file = arg;
+    }
+
+    return !options.command.empty();
+}
+
+// Split one CSV record; supports "quoted, fields" with "" as an escaped quote
+static std::vector<std::string> splitCSV(const std::string &line)
+{
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+
+    for (size_t i = 0; i < line.size(); ++i)
+    {
+        char c = line[i];
+        if (quoted)
+        {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                fields.back() += line[++i];
+            else if (c == '"')
+                quoted = false;
+            else
+                fields.back() += c;
+        }
+        else if (c == '"')
+            quoted = true;
+        else if (c == ',')
+            fields.emplace_back();
+        else if (c != '\r')
+            fields.back() += c;
+    }
+
+    return fields;
+}
+
+static std::string quoteCSV(const std::string &value)
+{
+    if (value.find_first_of(",\"\n") == std::string::npos)
+        return value;
+
+    std::string quoted = "\"";
+    for (char c : value)
+        quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return quoted + "\"";
+}
+
+// Whole field, within int range: "3000000000" is an error, not a wrapped value
+static bool parseInt(const std::string &text, int &out)
+{
+    char *end;
+    errno = 0;
+    long long value = std::strtoll(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno == ERANGE || value < std::numeric_limits<int>::min() ||
+        value > std::numeric_limits<int>::max())
+        return false;
+    out = (int)value;
+    return true;
+}
+
+// Periodic progress/throughput lines on stderr (one per second, cron-log friendly)
+class Progress
+{
+public:
+    Progress(const char *verb, bool quiet) : verb(verb), quiet(quiet), start(Clock::now()), lastReport(start) {}
+
+    void tick(long rows)
+    {
+        if (quiet)
+            return;
+
+        Clock::time_point now = Clock::now();
+        if (now - lastReport >= std::chrono::seconds(1))
+        {
+            report(rows, now, false);
+            lastReport = now;
+        }
+    }
+
+    void finish(long rows, long failed)
+    {
+        if (!quiet)
+            report(rows, Clock::now(), true);
+        if (failed > 0)
+            std::cerr << failed << " line(s) rejected" << std::endl;
+    }
+
+private:
+    void report(long rows, Clock::time_point now, bool done)
+    {
+        double seconds = std::chrono::duration<double>(now - start).count();
+        std::cerr << (done ? "done: " : "") << verb << " " << rows << " rows in "
+                  << std::fixed << std::setprecision(1) << seconds << " s ("
+                  << std::setprecision(0) << (seconds > 0 ? rows / seconds : 0.0) << " rows/s)" << std::endl;
+    }
+
+    const char *verb;
+    bool quiet;
+    Clock::time_point start;
+    Clock::time_point lastReport;
+};
+
+// Stream lines from the input, applying each inside batched transactions.
+// apply() returns false to reject a line; returns the process exit code.
+static int runBatch(const CLIOptions &options, const char *verb,
+                    const std::function<bool(const std::vector<std::string> &)> &apply)
+{
+    std::ifstream file;
+    if (options.file != "-")
+    {
+        file.open(options.file);
+        if (!file)
+        {
+            std::cerr << "Cannot open " << options.file << std::endl;
+            return 1;
+        }
+    }
+    std::istream &in = options.file == "-" ? std::cin : file;
+
+    Progress progress(verb, options.quiet);
+    long applied = 0, failed = 0, lineNumber = 0, inBatch = 0;
+    std::string line;
+
+    if (!beginTransaction())
+    {
+        std::cerr << "Cannot start transaction" << std::endl;
+        return 1;
+    }
+
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        if (apply(splitCSV(line)))
+        {
+            ++applied;
+        }
+        else
+        {
+            ++failed;
+            std::cerr << "line " << lineNumber << ": rejected: " << line << std::endl;
+        }
+
+        if (++inBatch >= options.batchSize)
+        {
+            if (!commitTransaction() || !beginTransaction())
+            {
+                std::cerr << "Commit failed at line " << lineNumber << std::endl;
+                rollbackTransaction();
+                return 1;
+            }
+            inBatch = 0;
+        }
+
+        progress.tick(applied);
+    }
+
+    if (!commitTransaction())
+    {
+        std::cerr << "Final commit failed" << std::endl;
+        rollbackTransaction();
+        return 1;
+    }
+
+    progress.finish(applied, failed);
+    return failed > 0 ? 2 : 0;
+}
+
+static int importProducts(const CLIOptions &options)
+{
+    return runBatch(options, "imported", [](const std::vector<std::string> &fields)
+                    {
+        Product p = noProduct;
+        if (fields.size() < 3 || fields[0].empty() ||
+            !parseInt(fields[1], p.quantity) || !parseMoney(fields[2], p.price))
+            return false;
+        if (fields.size() > 3 && !parseInt(fields[3], p.reorderLevel))
+            return false;
+        if (fields.size() > 4)
+            p.sku = fields[4];
+        p.name = fields[0];
+        return addProduct(p); });
+}
+
+static int setPrices(const CLIOptions &options)
+{
+    return runBatch(options, "updated", [](const std::vector<std::string> &fields)
+                    {
+        int id;
+        Money price;
+        if (fields.size() < 2 || !parseInt(fields[0], id) || !parseMoney(fields[1], price))
+            return false;
+
+        Product p = getProductById(id);
+        if (p.id < 0)
+            return false;
+        p.price = price;
+        return updateProduct(p); });
+}
+
+static int exportValuation(const CLIOptions &options)
+{
+    std::ofstream file;
+    if (options.file != "-")
+    {
+        file.open(options.file, std::ios::trunc);
+        if (!file)
+        {
+            std::cerr << "Cannot write " << options.file << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = options.file == "-" ? std::cout : file;
+
+    Progress progress("exported", options.quiet);
+    long rows = 0;
+    Money total;
+
+    out << "id,name,quantity,price,value\n";
+
+    // Streamed straight from the cursor; memory use does not grow with the catalogue
+    for (const Product &p : openProducts())
+    {
+        Money value = p.price * p.quantity;
+        total += value;
+        out << p.id << ',' << quoteCSV(p.name) << ',' << p.quantity << ',' << formatMoney(p.price) << ','
+            << formatMoney(value) << '\n';
+        progress.tick(++rows);
+    }
+
+    out << ",TOTAL,,," << formatMoney(total) << '\n';
+    progress.finish(rows, 0);
+    return out.good() ? 0 : 1;
+}
+
+// Same path as the GUI scan mode: codes are resolved through the in-memory
+// index and whatever arrived together is applied in one transaction
+static int scanCodes(const CLIOptions &options)
+{
+    std::ifstream file;
+    if (options.file != "-")
+    {
+        file.open(options.file);
+        if (!file)
+        {
+            std::cerr << "Cannot open " << options.file << std::endl;
+            return 1;
+        }
+    }
+    std::istream &in = options.file == "-" ? std::cin : file;
+
+    initBarcodeIndex();
+
+    Progress progress("scanned", options.quiet);
+    long applied = 0, rejected = 0, queued = 0;
+    std::string line;
+
+    auto flush = [&]
+    {
+        int done = applyPendingScans(options.scanDelta);
+        applied += done;
+        rejected += queued - done;
+        queued = 0;
+    };
+
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        feedScanText(line.c_str());
+        completeScan();
+
+        // A live scanner delivers one code at a time; a file delivers a burst
+        if (++queued >= options.batchSize || in.rdbuf()->in_avail() <= 0)
+            flush();
+        progress.tick(applied);
+    }
+    flush();
+
+    shutdownBarcodeIndex();
+    progress.finish(applied, rejected);
+    return rejected > 0 ? 2 : 0;
+}
+
+// Runs the same stepwise backup the GUI does in idle frames and reports how
+// long each step held the connection, i.e. the worst stall a frame would see
+static int backupDatabase(const CLIOptions &options)
+{
+    if (options.file == "-")
+    {
+        std::cerr << "backup needs a destination FILE" << std::endl;
+        return 1;
+    }
+    if (!startBackup(options.file, options.backupPages))
+        return 1;
+
+    Clock::time_point start = Clock::now(), lastReport = start;
+    while (stepBackup())
+    {
+        const BackupProgress &p = getBackupProgress();
+        if (!options.quiet && Clock::now() - lastReport >= std::chrono::seconds(1))
+        {
+            std::cerr << (p.totalPages - p.remainingPages) << " / " << p.totalPages << " pages" << std::endl;
+            lastReport = Clock::now();
+        }
+    }
+
+    const BackupProgress &p = getBackupProgress();
+    if (!p.succeeded)
+        return 1;
+
+    if (!options.quiet)
+    {
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cerr << "done: " << p.totalPages << " pages in " << p.steps << " steps, "
+                  << std::fixed << std::setprecision(1) << seconds * 1000.0 << " ms\n"
+                  << "step time: avg " << std::setprecision(3) << p.totalStepMs / std::max(1, p.steps)
+                  << " ms, max " << p.maxStepMs << " ms (" << p.busySteps << " retried while locked)" << std::endl;
+    }
+    return 0;
+}
+
+static int undoLast()
+{
+    if (!canUndo())
+    {
+        std::cerr << "Nothing to undo" << std::endl;
+        return 1;
+    }
+
+    std::string label = undoLabel();
+    if (!undo())
+        return 1;
+    std::cout << "Undone: " << label << std::endl;
+    return 0;
+}
+
+static int printHistory(const CLIOptions &options)
+{
+    int id;
+    if (!parseInt(options.file, id))
+    {
+        std::cerr << "history needs a product ID" << std::endl;
+        return 1;
+    }
+
+    std::cout << "time,user,source,action,name,old_quantity,new_quantity,old_price,new_price\n";
+    for (const AuditEntry &e : getProductHistory(id, 1000000))
+    {
+        std::time_t seconds = (std::time_t)(e.changedAt / 1000);
+        char when[32];
+        std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+        std::cout << when << ',' << quoteCSV(e.user) << ',' << e.source << ',' << e.action << ','
+                  << quoteCSV(e.name) << ',' << e.oldQuantity << ',' << e.newQuantity << ','
+                  << formatMoney(e.oldPrice) << ',' << formatMoney(e.newPrice) << '\n';
+    }
+    return 0;
+}
+
+static int printSeries(const CLIOptions &options)
+{
+    int id;
+    if (!parseInt(options.file, id) || id < 0)
+    {
+        std::cerr << "series needs a product ID (0 for the whole catalogue)" << std::endl;
+        return 1;
+    }
+
+    std::vector<SeriesPoint> points = querySeries(id, 0, std::numeric_limits<long long>::max());
+
+    std::cout << (id == catalogueSeries ? "time,units,value\n" : "time,quantity,price\n");
+    if (options.seriesPoints > 0)
+    {
+        // Quantity drives the shape; the price shown is the one recorded at that point
+        std::vector<std::pair<double, double>> line;
+        line.reserve(points.size());
+        for (size_t i = 0; i < points.size(); ++i)
+            line.emplace_back((double)i, (double)points[i].quantity);
+        for (const auto &p : downsampleLTTB(line, (size_t)options.seriesPoints))
+        {
+            const SeriesPoint &point = points[(size_t)p.first];
+            std::cout << point.time << ',' << point.quantity << ',' << formatMoney(point.price) << '\n';
+        }
+    }
+    else
+    {
+        for (const SeriesPoint &point : points)
+            std::cout << point.time << ',' << point.quantity << ',' << formatMoney(point.price) << '\n';
+    }
+
+    flushSeries();
+    SeriesStats stats = getSeriesStats();
+    if (!options.quiet && stats.blockPoints)
+        std::cerr << points.size() << " points; " << stats.blocks << " blocks written this run, "
+                  << std::fixed << std::setprecision(2) << (double)stats.bytes / stats.blockPoints
+                  << " bytes/point" << std::endl;
+    return 0;
+}
+
+// Builds the facet bitmaps, applies FILTER (values of one facet are ORed,
+// different facets ANDed) and prints the counts the GUI would show
+static int printFacets(const CLIOptions &options)
+{
+    Clock::time_point start = Clock::now();
+    initFacets();
+    double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    const std::vector<Facet> &facets = getFacets();
+    FacetSelection selection = emptyFacetSelection();
+    if (options.file != "-")
+    {
+        std::stringstream filter(options.file);
+        std::string term;
+        while (std::getline(filter, term, ','))
+        {
+            size_t eq = term.find('=');
+            bool found = false;
+            for (size_t f = 0; f < facets.size() && eq != std::string::npos; ++f)
+                for (size_t v = 0; v < facets[f].values.size(); ++v)
+                    if (facets[f].name == term.substr(0, eq) && facets[f].values[v].label == term.substr(eq + 1))
+                        selection[f][v] = found = true;
+            if (!found)
+            {
+                std::cerr << "Unknown facet value: " << term << std::endl;
+                shutdownFacets();
+                return 1;
+            }
+        }
+    }
+
+    start = Clock::now();
+    std::vector<std::vector<uint64_t>> counts = countFacets(selection);
+    uint64_t matches = filterByFacets(selection).cardinality();
+    double queryMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    size_t bytes = 0;
+    for (size_t f = 0; f < facets.size(); ++f)
+    {
+        std::cout << facets[f].name << ":\n";
+        for (size_t v = 0; v < facets[f].values.size(); ++v)
+        {
+            std::cout << "  " << (selection[f][v] ? "[x] " : "[ ] ") << facets[f].values[v].label << ": "
+                      << counts[f][v] << "\n";
+            bytes += facets[f].values[v].products.bytes();
+        }
+    }
+    std::cout << "matching products: " << matches << std::endl;
+
+    if (!options.quiet)
+        std::cerr << std::fixed << std::setprecision(2) << "index built in " << buildMs << " ms ("
+                  << bytes / 1024 << " KB), filter and counts in " << queryMs << " ms" << std::endl;
+
+    shutdownFacets();
+    return 0;
+}
+
+// Sorting and grouping run on a snapshot the way the product table does;
+// the time reported excludes loading and printing
+static int printSorted(const CLIOptions &options)
+{
+    static const char *const names[] = {"id", "name", "quantity", "price", "sku"};
+    auto column = std::find(std::begin(names), std::end(names), options.file);
+    if (column == std::end(names))
+    {
+        std::cerr << "sort needs a column: id, name, quantity, price or sku" << std::endl;
+        return 1;
+    }
+
+    std::vector<Product> products = getAllProducts();
+    std::vector<uint32_t> rows(products.size());
+    for (size_t i = 0; i < rows.size(); ++i)
+        rows[i] = (uint32_t)i;
+
+    Clock::time_point start = Clock::now();
+    sortRows(products, rows, (SortColumn)(column - std::begin(names)), options.descending);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << "id,name,quantity,price,sku\n";
+    for (uint32_t row : rows)
+    {
+        const Product &p = products[row];
+        std::cout << p.id << ',' << quoteCSV(p.name) << ',' << p.quantity << ',' << formatMoney(p.price) << ','
+                  << quoteCSV(p.sku) << '\n';
+    }
+
+    if (!options.quiet)
+        std::cerr << "sorted " << rows.size() << " rows in " << std::fixed << std::setprecision(1) << ms << " ms"
+                  << std::endl;
+    return 0;
+}
+
+static int printGroups(const CLIOptions &options)
+{
+    static const char *const names[] = {"word", "price", "reorder"};
+    auto column = std::find(std::begin(names), std::end(names), options.file);
+    if (column == std::end(names))
+    {
+        std::cerr << "group needs a column: word, price or reorder" << std::endl;
+        return 1;
+    }
+
+    std::vector<Product> products = getAllProducts();
+    std::vector<uint32_t> rows(products.size());
+    for (size_t i = 0; i < rows.size(); ++i)
+        rows[i] = (uint32_t)i;
+
+    Clock::time_point start = Clock::now();
+    std::vector<ProductGroup> groups = groupRows(products, rows, (GroupColumn)(column - std::begin(names)));
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << "group,products,units,value\n";
+    for (const ProductGroup &g : groups)
+        std::cout << quoteCSV(g.label) << ',' << g.products << ',' << g.units << ',' << formatMoney(g.value) << '\n';
+
+    if (!options.quiet)
+        std::cerr << groups.size() << " groups from " << rows.size() << " rows in " << std::fixed
+                  << std::setprecision(1) << ms << " ms" << std::endl;
+    return 0;
+}
+
+static int adjustStockLines(const CLIOptions &options)
+{
+    return runBatch(options, "applied", [](const std::vector<std::string> &fields)
+                    {
+        int location, id, delta;
+        return fields.size() >= 3 && parseInt(fields[0], location) && parseInt(fields[1], id) &&
+               parseInt(fields[2], delta) && adjustStock(location, id, delta); });
+}
+
+static int moveStock(const CLIOptions &options)
+{
+    return runBatch(options, "moved", [](const std::vector<std::string> &fields)
+                    {
+        int id, from, to, quantity;
+        return fields.size() >= 4 && parseInt(fields[0], id) && parseInt(fields[1], from) &&
+               parseInt(fields[2], to) && parseInt(fields[3], quantity) && transferStock(id, from, to, quantity); });
+}
+
+static int addLocationNamed(const CLIOptions &options)
+{
+    if (options.file == "-")
+    {
+        std::cerr << "add-location needs a name" << std::endl;
+        return 1;
+    }
+    int id = addLocation(options.file);
+    if (id < 0)
+    {
+        std::cerr << "Cannot add location '" << options.file << "' (names must be unique)" << std::endl;
+        return 1;
+    }
+    std::cout << id << std::endl;
+    return 0;
+}
+
+static int printLocations()
+{
+    std::cout << "id,name,products,units\n";
+    for (const Location &l : getLocations())
+        std::cout << l.id << ',' << quoteCSV(l.name) << ',' << l.products << ',' << l.units << '\n';
+    return 0;
+}
+
+static int printLocationStock(const CLIOptions &options)
+{
+    int location;
+    if (!parseInt(options.file, location))
+    {
+        std::cerr << "stock needs a location ID" << std::endl;
+        return 1;
+    }
+
+    std::cout << "id,name,quantity,total\n";
+    for (const LocationStock &s : openLocationStock(location))
+        std::cout << s.productId << ',' << quoteCSV(s.name) << ',' << s.quantity << ',' << s.total << '\n';
+    return 0;
+}
+
+static int addCategoryNamed(const CLIOptions &options)
+{
+    if (options.file == "-")
+    {
+        std::cerr << "add-category needs a path" << std::endl;
+        return 1;
+    }
+    int id = addCategoryPath(options.file);
+    if (id < 0)
+    {
+        std::cerr << "Cannot add category '" << options.file << "'" << std::endl;
+        return 1;
+    }
+    std::cout << id << std::endl;
+    return 0;
+}
+
+static int printCategories(const CLIOptions &options)
+{
+    int parent = 0;
+    if (options.file != "-" && !parseInt(options.file, parent))
+    {
+        std::cerr << "categories takes a category ID" << std::endl;
+        return 1;
+    }
+
+    std::cout << "id,path,subcategories,products,units,value\n";
+    std::string prefix = parent ? getCategoryPath(parent) + "/" : "";
+    for (const Category &c : getCategoryChildren(parent))
+        std::cout << c.id << ',' << quoteCSV(prefix + c.name) << ',' << c.children << ',' << c.products << ','
+                  << c.units << ',' << formatMoney(c.value) << '\n';
+    return 0;
+}
+
+static int categorizeProducts(const CLIOptions &options)
+{
+    return runBatch(options, "filed", [](const std::vector<std::string> &fields)
+                    {
+        int id, category;
+        return fields.size() >= 2 && parseInt(fields[0], id) && parseInt(fields[1], category) &&
+               setProductCategory(id, category); });
+}
+
+static int moveCategories(const CLIOptions &options)
+{
+    return runBatch(options, "moved", [](const std::vector<std::string> &fields)
+                    {
+        int id, parent;
+        return fields.size() >= 2 && parseInt(fields[0], id) && parseInt(fields[1], parent) &&
+               moveCategory(id, parent); });
+}
+
+static int receiveLots(const CLIOptions &options)
+{
+    return runBatch(options, "received", [](const std::vector<std::string> &fields)
+                    {
+        int id, quantity;
+        return fields.size() >= 4 && parseInt(fields[0], id) && parseInt(fields[3], quantity) &&
+               receiveLot(id, fields[1], fields[2], quantity) > 0; });
+}
+
+static int printLots(const CLIOptions &options)
+{
+    int productId;
+    if (!parseInt(options.file, productId))
+    {
+        std::cerr << "lots needs a product ID" << std::endl;
+        return 1;
+    }
+
+    std::cout << "id,code,expires,quantity\n";
+    for (const Lot &lot : openProductLots(productId))
+        std::cout << lot.id << ',' << quoteCSV(lot.code) << ',' << lot.expires << ',' << lot.quantity << '\n';
+    return 0;
+}
+
+// Lines that the unexpired lots cannot cover are rejected whole and reported
+static int allocateLines(const CLIOptions &options)
+{
+    std::string today = options.today.empty() ? todayDate() : options.today;
+    std::cout << "order,product_id,lot_id,code,expires,quantity\n";
+    std::vector<LotPick> picks;
+    return runBatch(options, "allocated", [&](const std::vector<std::string> &fields)
+                    {
+        int id, quantity;
+        picks.clear();
+        if (fields.size() < 3 || !parseInt(fields[1], id) || !parseInt(fields[2], quantity) ||
+            !allocateFefo(id, quantity, today, picks))
+            return false;
+        for (const LotPick &p : picks)
+            std::cout << quoteCSV(fields[0]) << ',' << id << ',' << p.lotId << ',' << quoteCSV(p.code) << ','
+                      << p.expires << ',' << p.quantity << '\n';
+        return true; });
+}
+
+static int printStats()
+{
+    InventorySummary summary = getInventorySummary();
+    std::cout << "products: " << summary.productCount << "\n"
+              << "units:    " << summary.totalUnits << "\n"
+              << "value:    " << formatMoney(summary.totalValue) << std::endl;
+    return 0;
+}
+
+int runCLI(int argc, char **argv)
+{
+    CLIOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    // The load tester is a pure client and never touches the database
+    if (options.command == "bench-http")
+        return runHttpLoadTest(options.loadTest);
+    if (options.command == "bench-progress")
+        return runProgressBench(options.progressBench);
+
+    if (options.command == "check-http")
+        return runHttpChecks();
+
+    // Plan checks work on their own scratch database, never on --db
+    if (options.command == "check-plans")
+    {
+        if (options.file != "-")
+            options.planCheck.dbPath = options.file;
+        return runPlanChecks(options.planCheck);
+    }
+
+    setBusyPolicy(options.busy);
+    if (options.command == "stress-writers")
+    {
+        if (options.file != "-")
+            options.writerStress.dbPath = options.file;
+        return runWriterStress(options.writerStress);
+    }
+    if (options.command == "bench-occ")
+    {
+        if (options.file != "-")
+            options.writerStress.dbPath = options.file;
+        return runEditBench(options.writerStress);
+    }
+    if (options.command == "bench-fefo")
+    {
+        if (options.file != "-")
+            options.allocationBench.dbPath = options.file;
+        return runAllocationBench(options.allocationBench);
+    }
+
+    // Batch runs pay for tracing only when asked to
+    setSlowQueryThreshold(options.slowQueryMs);
+    if (!initDB(options.dbPath))
+    {
+        std::cerr << "Failed to open database." << std::endl;
+        return 1;
+    }
+
+    // Journal next to the database, shared with the GUI. Everything a batch
+    // command changes is undone as one command; the server records per request.
+    initUndo(options.dbPath + ".undo");
+    initAudit(options.dbPath, options.command == "serve" ? "api" : "cli");
+    initSeries(options.dbPath);
+    bool grouped = options.command != "serve" && options.command != "undo";
+    if (grouped)
+        beginUndoGroup(options.command + " " + options.file);
+
+    int status;
+    if (options.command == "import")
+        status = importProducts(options);
+    else if (options.command == "set-prices")
+        status = setPrices(options);
+    else if (options.command == "export-valuation")
+        status = exportValuation(options);
+    else if (options.command == "stats")
+        status = printStats();
+    else if (options.command == "scan")
+        status = scanCodes(options);
+    else if (options.command == "backup")
+        status = backupDatabase(options);
+    else if (options.command == "undo")
+        status = undoLast();
+    else if (options.command == "history")
+        status = printHistory(options);
+    else if (options.command == "series")
+        status = printSeries(options);
+    else if (options.command == "sort")
+        status = printSorted(options);
+    else if (options.command == "group")
+        status = printGroups(options);
+    else if (options.command == "facets")
+        status = printFacets(options);
+    else if (options.command == "locations")
+        status = printLocations();
+    else if (options.command == "add-location")
+        status = addLocationNamed(options);
+    else if (options.command == "stock")
+        status = printLocationStock(options);
+    else if (options.command == "stock-adjust")
+        status = adjustStockLines(options);
+    else if (options.command == "move")
+        status = moveStock(options);
+    else if (options.command == "categories")
+        status = printCategories(options);
+    else if (options.command == "add-category")
+        status = addCategoryNamed(options);
+    else if (options.command == "categorize")
+        status = categorizeProducts(options);
+    else if (options.command == "move-category")
+        status = moveCategories(options);
+    else if (options.command == "receive-lots")
+        status = receiveLots(options);
+    else if (options.command == "lots")
+        status = printLots(options);
+    else if (options.command == "allocate")
+        status = allocateLines(options);
+    else if (options.command == "serve")
+    {
+        options.server.dbPath = options.dbPath;
+        status = runHttpServer(options.server);
+    }
+    else
+    {
+        std::cerr << "Unknown command: " << options.command << "\n\n";
+        printUsage();
+        status = 1;
+    }
+
+    if (grouped)
+        endUndoGroup();
+    if (options.slowQueryMs >= 0)
+    {
+        if (options.slowQueryLog.empty())
+            writeSlowQueries(std::cerr);
+        else if (!dumpSlowQueries(options.slowQueryLog))
+            status = 1;
+    }
+    shutdownSeries();
+    shutdownAudit();
+    shutdownUndo();
+    closeDB();
+    return status;
+}
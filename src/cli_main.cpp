@@ -0,0 +1,7 @@
+#include "cli.hpp"
+
+// Stand-alone headless build: no SDL/OpenGL dependencies
+int main(int argc, char **argv)
+{
+    return runCLI(argc, argv);
+}
@@ -1,49 +1,715 @@
 #include "db.hpp"
+#include "query_log.hpp"
+#include "schema.hpp"
 #include <sqlite3.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fcntl.h>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
 
 static sqlite3* db;
 
-bool initDB(const std::string& dbName) {
-    int result = sqlite3_open(dbName.c_str(), &db);
-    if (result != SQLITE_OK) {
-        std::cerr << "Failed to open DB: " << sqlite3_errmsg(db) << std::endl;
-        return false;
-    }
+const Product noProduct = {-1, "", 0, {}, 0, "", 0, 0};
+
+// Hot single-row statements are prepared once and reset after each use
+static std::unordered_map<std::string, sqlite3_stmt *> statementCache;
+
+static std::vector<std::pair<int, ProductObserver>> observers;
+static int nextObserverHandle = 1;
 
-    const char* createTableSQL = R"(
-        CREATE TABLE IF NOT EXISTS products (
+// Changes made inside a transaction are held back until it commits, so
+// observers never record a change that is then rolled back
+static std::vector<ProductChange> pendingChanges;
+
+static BusyPolicy busyPolicy;
+static ContentionStats contention = {};
+static double currentWaitMs = 0.0;
+static bool lastBusy = false;
+static long long lastCommitNs = 0;
+
+// Writer turnstile: a lock on byte 0 of "<db>-turnstile". A writer that
+// finds the database locked holds it while it retries, and every writer
+// passes through it before starting, so new writes queue up behind one
+// that is already waiting instead of overtaking it on every retry.
+static int turnstileFd = -1;
+static bool writing = false;
+static bool holdingTurnstile = false;
+
+static QueryProgressHandler progressHandler;
+static int progressInstructions = 1000;
+static bool queryCancelled = false;
+
+// Online backup in progress, if any
+static sqlite3 *backupDB = nullptr;
+static sqlite3_backup *backupHandle = nullptr;
+static int backupPagesPerStep = 64;
+static BackupProgress backupProgress = {};
+
+// The first release's table. Creating it is part of the first migration
+// step, under the same write lock.
+static const char *const baseSchema = R"(
+    CREATE TABLE IF NOT EXISTS products (
+        id INTEGER PRIMARY KEY AUTOINCREMENT,
+        name TEXT NOT NULL,
+        quantity INTEGER NOT NULL,
+        price REAL NOT NULL
+    );
+)";
+
+// Schema changes made after the first release, applied in order on top of the
+// base products table. PRAGMA user_version records how many have been applied.
+static const char *const schemaMigrations[] = {
+    // 1: reorder thresholds; the partial index keeps low-stock lookups O(alerts)
+    R"(
+        ALTER TABLE products ADD COLUMN reorder_level INTEGER NOT NULL DEFAULT 0;
+        CREATE INDEX IF NOT EXISTS idx_products_low_stock ON products(id) WHERE quantity < reorder_level;
+    )",
+    // 2: barcodes; empty means "none", so uniqueness only applies to real codes
+    R"(
+        ALTER TABLE products ADD COLUMN sku TEXT NOT NULL DEFAULT '';
+        CREATE UNIQUE INDEX IF NOT EXISTS idx_products_sku ON products(sku) WHERE sku <> '';
+    )",
+    // 3: exact prices; REAL price becomes integer cents. SQLite cannot change a
+    // column's type in place, so the table is rebuilt (keeping the AUTOINCREMENT
+    // high-water mark so deleted IDs are still never reused)
+    R"(
+        CREATE TABLE products_new (
             id INTEGER PRIMARY KEY AUTOINCREMENT,
             name TEXT NOT NULL,
             quantity INTEGER NOT NULL,
-            price REAL NOT NULL
+            price_cents INTEGER NOT NULL,
+            reorder_level INTEGER NOT NULL DEFAULT 0,
+            sku TEXT NOT NULL DEFAULT ''
+        );
+        INSERT INTO products_new (id, name, quantity, price_cents, reorder_level, sku)
+            SELECT id, name, quantity, CAST(ROUND(price * 100) AS INTEGER), reorder_level, sku FROM products;
+        INSERT INTO sqlite_sequence (name, seq)
+            SELECT 'products_new', 0 WHERE NOT EXISTS (SELECT 1 FROM sqlite_sequence WHERE name = 'products_new');
+        UPDATE sqlite_sequence SET seq = (SELECT MAX(seq) FROM sqlite_sequence WHERE name IN ('products', 'products_new'))
+            WHERE name = 'products_new';
+        DROP TABLE products;
+        ALTER TABLE products_new RENAME TO products;
+        CREATE INDEX idx_products_low_stock ON products(id) WHERE quantity < reorder_level;
+        CREATE UNIQUE INDEX idx_products_sku ON products(sku) WHERE sku <> '';
+    )",
+    // 4: row versions for optimistic updates from several terminals
+    R"(
+        ALTER TABLE products ADD COLUMN version INTEGER NOT NULL DEFAULT 0;
+    )",
+    // 5: warehouses. Stock rows are clustered by location, so a location's
+    // list is one range of the primary key; idx_stock_product covers "where
+    // is this product". The triggers keep products.quantity the total and
+    // the per-location rollups current, one row update per change.
+    R"(
+        CREATE TABLE locations (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            name TEXT NOT NULL UNIQUE,
+            products INTEGER NOT NULL DEFAULT 0,
+            units INTEGER NOT NULL DEFAULT 0
+        );
+        CREATE TABLE stock (
+            location_id INTEGER NOT NULL,
+            product_id INTEGER NOT NULL,
+            quantity INTEGER NOT NULL CHECK (quantity >= 0),
+            PRIMARY KEY (location_id, product_id)
+        ) WITHOUT ROWID;
+        CREATE INDEX idx_stock_product ON stock(product_id, location_id, quantity);
+
+        CREATE TRIGGER stock_check BEFORE INSERT ON stock
+        WHEN NOT EXISTS (SELECT 1 FROM locations WHERE id = NEW.location_id)
+          OR NOT EXISTS (SELECT 1 FROM products WHERE id = NEW.product_id)
+        BEGIN
+            SELECT RAISE(ABORT, 'unknown location or product');
+        END;
+        CREATE TRIGGER stock_added AFTER INSERT ON stock BEGIN
+            UPDATE products SET quantity = quantity + NEW.quantity, version = version + 1 WHERE id = NEW.product_id;
+            UPDATE locations SET products = products + 1, units = units + NEW.quantity WHERE id = NEW.location_id;
+        END;
+        CREATE TRIGGER stock_changed AFTER UPDATE OF quantity ON stock BEGIN
+            UPDATE products SET quantity = quantity + NEW.quantity - OLD.quantity, version = version + 1
+                WHERE id = NEW.product_id;
+            UPDATE locations SET units = units + NEW.quantity - OLD.quantity WHERE id = NEW.location_id;
+        END;
+        CREATE TRIGGER stock_removed AFTER DELETE ON stock BEGIN
+            UPDATE products SET quantity = quantity - OLD.quantity, version = version + 1 WHERE id = OLD.product_id;
+            UPDATE locations SET products = products - 1, units = units - OLD.quantity WHERE id = OLD.location_id;
+        END;
+        -- A deleted product takes its stock rows along (restoring it brings
+        -- the total back as unassigned)
+        CREATE TRIGGER product_removed AFTER DELETE ON products BEGIN
+            DELETE FROM stock WHERE product_id = OLD.id;
+        END;
+    )",
+    // 6: category tree. category_paths holds every (ancestor, descendant)
+    // pair including each node with itself, so "all ancestors of X" and
+    // "the whole subtree of X" are both single index ranges. The product
+    // triggers push each change into the cached totals of the product's
+    // category and its ancestors only; rows that stay uncategorized (0)
+    // skip them entirely.
+    R"(
+        CREATE TABLE categories (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            parent_id INTEGER NOT NULL DEFAULT 0,
+            name TEXT NOT NULL CHECK (name <> '' AND instr(name, '/') = 0),
+            children INTEGER NOT NULL DEFAULT 0,
+            products INTEGER NOT NULL DEFAULT 0,
+            units INTEGER NOT NULL DEFAULT 0,
+            value_cents INTEGER NOT NULL DEFAULT 0,
+            UNIQUE (parent_id, name)
         );
-    )";
+        CREATE TABLE category_paths (
+            ancestor INTEGER NOT NULL,
+            descendant INTEGER NOT NULL,
+            depth INTEGER NOT NULL,
+            PRIMARY KEY (descendant, ancestor)
+        ) WITHOUT ROWID;
+        CREATE INDEX idx_category_paths_ancestor ON category_paths(ancestor, descendant);
+
+        ALTER TABLE products ADD COLUMN category_id INTEGER NOT NULL DEFAULT 0;
+        CREATE INDEX idx_products_category ON products(category_id);
+
+        CREATE TRIGGER category_added AFTER INSERT ON categories BEGIN
+            INSERT INTO category_paths (ancestor, descendant, depth)
+                SELECT ancestor, NEW.id, depth + 1 FROM category_paths WHERE descendant = NEW.parent_id
+                UNION ALL SELECT NEW.id, NEW.id, 0;
+            UPDATE categories SET children = children + 1 WHERE id = NEW.parent_id;
+        END;
+        CREATE TRIGGER category_removed AFTER DELETE ON categories BEGIN
+            DELETE FROM category_paths WHERE descendant = OLD.id;
+            UPDATE categories SET children = children - 1 WHERE id = OLD.parent_id;
+        END;
+
+        CREATE TRIGGER category_product_added AFTER INSERT ON products WHEN NEW.category_id <> 0 BEGIN
+            UPDATE categories SET products = products + 1, units = units + NEW.quantity,
+                                  value_cents = value_cents + NEW.quantity * NEW.price_cents
+                WHERE id IN (SELECT ancestor FROM category_paths WHERE descendant = NEW.category_id);
+        END;
+        CREATE TRIGGER category_product_removed AFTER DELETE ON products WHEN OLD.category_id <> 0 BEGIN
+            UPDATE categories SET products = products - 1, units = units - OLD.quantity,
+                                  value_cents = value_cents - OLD.quantity * OLD.price_cents
+                WHERE id IN (SELECT ancestor FROM category_paths WHERE descendant = OLD.category_id);
+        END;
+        CREATE TRIGGER category_product_changed AFTER UPDATE OF quantity, price_cents ON products
+        WHEN NEW.category_id = OLD.category_id AND NEW.category_id <> 0
+         AND (NEW.quantity <> OLD.quantity OR NEW.price_cents <> OLD.price_cents)
+        BEGIN
+            UPDATE categories SET units = units + NEW.quantity - OLD.quantity,
+                                  value_cents = value_cents + NEW.quantity * NEW.price_cents - OLD.quantity * OLD.price_cents
+                WHERE id IN (SELECT ancestor FROM category_paths WHERE descendant = NEW.category_id);
+        END;
+        CREATE TRIGGER category_product_moved AFTER UPDATE OF category_id ON products
+        WHEN NEW.category_id <> OLD.category_id
+        BEGIN
+            UPDATE categories SET products = products - 1, units = units - OLD.quantity,
+                                  value_cents = value_cents - OLD.quantity * OLD.price_cents
+                WHERE id IN (SELECT ancestor FROM category_paths WHERE descendant = OLD.category_id);
+            UPDATE categories SET products = products + 1, units = units + NEW.quantity,
+                                  value_cents = value_cents + NEW.quantity * NEW.price_cents
+                WHERE id IN (SELECT ancestor FROM category_paths WHERE descendant = NEW.category_id);
+        END;
+    )",
+    // 7: lots with expiry dates. Empty lots stay for traceability but drop
+    // out of the partial index, which is all allocation ever reads.
+    R"(
+        CREATE TABLE lots (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            product_id INTEGER NOT NULL,
+            code TEXT NOT NULL DEFAULT '',
+            expires TEXT NOT NULL DEFAULT '',
+            quantity INTEGER NOT NULL CHECK (quantity >= 0)
+        );
+        CREATE INDEX idx_lots_available ON lots(product_id, expires, id) WHERE quantity > 0;
+
+        CREATE TRIGGER lot_check BEFORE INSERT ON lots
+        WHEN NOT EXISTS (SELECT 1 FROM products WHERE id = NEW.product_id)
+        BEGIN
+            SELECT RAISE(ABORT, 'unknown product');
+        END;
+        CREATE TRIGGER lot_added AFTER INSERT ON lots BEGIN
+            UPDATE products SET quantity = quantity + NEW.quantity, version = version + 1 WHERE id = NEW.product_id;
+        END;
+        CREATE TRIGGER lot_changed AFTER UPDATE OF quantity ON lots BEGIN
+            UPDATE products SET quantity = quantity + NEW.quantity - OLD.quantity, version = version + 1
+                WHERE id = NEW.product_id;
+        END;
+        CREATE TRIGGER lot_product_removed AFTER DELETE ON products BEGIN
+            DELETE FROM lots WHERE product_id = OLD.id;
+        END;
+    )",
+    // 8: a product's total never drops below zero. Lots and stock rows are
+    // checked on their own, but both change the same total as plain
+    // adjustments do, so units taken out twice could leave it negative. A
+    // CHECK would mean rebuilding products and all its triggers, and would
+    // fail on a file that already holds a negative total; these refuse the
+    // change instead and still let such a total be raised.
+    R"(
+        CREATE TRIGGER product_quantity_check BEFORE INSERT ON products WHEN NEW.quantity < 0
+        BEGIN
+            SELECT RAISE(ABORT, 'quantity below zero');
+        END;
+        CREATE TRIGGER product_quantity_changed_check BEFORE UPDATE OF quantity ON products
+        WHEN NEW.quantity < 0 AND NEW.quantity < OLD.quantity
+        BEGIN
+            SELECT RAISE(ABORT, 'quantity below zero');
+        END;
+    )",
+};
+
+static int schemaVersion()
+{
+    int version = 0;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            version = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+// One step per transaction. Other processes may open the same file at the
+// same moment, so the version that decides the next step is read only once
+// the write lock is held; a step someone else applied meanwhile is skipped.
+static bool migrateSchema()
+{
+    const int latest = (int)(sizeof(schemaMigrations) / sizeof(schemaMigrations[0]));
+
+    // The version never goes down, so an up-to-date file needs no lock
+    if (schemaVersion() >= latest)
+        return true;
+
+    for (;;)
+    {
+        char *errMsg = nullptr;
+        if (sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, &errMsg) != SQLITE_OK)
+        {
+            std::cerr << "Failed to lock database for schema migration: " << errMsg << std::endl;
+            sqlite3_free(errMsg);
+            return false;
+        }
+
+        int version = schemaVersion();
+        if (version >= latest)
+            return sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+
+        std::string sql = std::string(version == 0 ? baseSchema : "") + schemaMigrations[version] +
+                          "PRAGMA user_version = " + std::to_string(version + 1) + ";COMMIT;";
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK)
+        {
+            std::cerr << "Failed to migrate schema to version " << version + 1 << ": " << errMsg << std::endl;
+            sqlite3_free(errMsg);
+            sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            return false;
+        }
+    }
+}
+
+static void deliverChange(const ProductChange &change)
+{
+    for (const auto &entry : observers)
+        entry.second(change);
+}
+
+static void notifyObservers(ProductChange::Kind kind, const Product &before, const Product &after)
+{
+    if (observers.empty())
+        return;
+
+    ProductChange change = {kind, before, after};
+    if (!sqlite3_get_autocommit(db))
+        pendingChanges.push_back(change);
+    else
+        deliverChange(change);
+}
+
+static void deliverPendingChanges()
+{
+    // An observer may write again; what it changes queues up anew
+    std::vector<ProductChange> changes;
+    changes.swap(pendingChanges);
+    for (const ProductChange &change : changes)
+        deliverChange(change);
+}
+
+static sqlite3_stmt *cachedStatement(const std::string &sql)
+{
+    auto it = statementCache.find(sql);
+    if (it != statementCache.end())
+        return it->second;
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+        return nullptr;
+
+    statementCache.emplace(sql, stmt);
+    return stmt;
+}
+
+static void releaseStatement(sqlite3_stmt *stmt)
+{
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+static bool lockTurnstile(short type)
+{
+    struct flock lock = {};
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = 1;
+    return fcntl(turnstileFd, F_SETLK, &lock) == 0;
+}
+
+static void releaseTurnstile()
+{
+    if (holdingTurnstile)
+        lockTurnstile(F_UNLCK);
+    holdingTurnstile = false;
+}
+
+// Wait (at most the busy timeout) until no other writer is queued, unless
+// this connection is inside a transaction and may be the one they wait for
+static void passTurnstile()
+{
+    if (turnstileFd < 0 || !sqlite3_get_autocommit(db))
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    while (!lockTurnstile(F_WRLCK))
+    {
+        double waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (waited >= busyPolicy.timeoutMs)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(busyPolicy.initialDelayMs));
+    }
+    lockTurnstile(F_UNLCK);
+}
+
+// Bracket every statement that takes the write lock
+static void startWrite(bool queue)
+{
+    if (queue)
+        passTurnstile();
+    writing = true;
+}
+
+static void finishWrite()
+{
+    writing = false;
+    releaseTurnstile();
+}
+
+// attempt counts the waits for the current lock, starting at 0
+static int busyCallback(void *, int attempt)
+{
+    static std::minstd_rand jitter(std::random_device{}());
+
+    if (attempt == 0)
+    {
+        ++contention.busyEvents;
+        currentWaitMs = 0.0;
+    }
+    if ((busyPolicy.maxRetries > 0 && attempt >= busyPolicy.maxRetries) || currentWaitMs >= busyPolicy.timeoutMs)
+    {
+        ++contention.gaveUp;
+        releaseTurnstile();
+        return 0;
+    }
+
+    // A queued writer is next in line, so it polls at the shortest delay;
+    // a reader, or a writer behind another queued one, backs off
+    if (writing && !holdingTurnstile && turnstileFd >= 0)
+        holdingTurnstile = lockTurnstile(F_WRLCK);
+
+    int delay = busyPolicy.initialDelayMs;
+    if (!holdingTurnstile)
+    {
+        delay = std::min(busyPolicy.maxDelayMs, busyPolicy.initialDelayMs << std::min(attempt, 16));
+        delay = std::max(1, delay / 2 + (int)(jitter() % (unsigned)(delay / 2 + 1)));
+    }
+    delay = std::min(delay, std::max(1, busyPolicy.timeoutMs - (int)currentWaitMs));
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    double waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    ++contention.retries;
+    contention.waitedMs += waited;
+    currentWaitMs += waited;
+    contention.maxWaitMs = std::max(contention.maxWaitMs, currentWaitMs);
+    return 1;
+}
+
+void setBusyPolicy(const BusyPolicy &policy)
+{
+    busyPolicy = policy;
+}
+
+const BusyPolicy &getBusyPolicy()
+{
+    return busyPolicy;
+}
+
+const ContentionStats &getContentionStats()
+{
+    return contention;
+}
+
+bool lastWriteWasBusy()
+{
+    return lastBusy;
+}
+
+// Runs inside the commit, while the write lock is still held
+static int commitHook(void *)
+{
+    lastCommitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    return 0;
+}
 
-    char* errMsg;
-    result = sqlite3_exec(db, createTableSQL, nullptr, nullptr, &errMsg);
+long long lastCommitTime()
+{
+    return lastCommitNs;
+}
+
+// Step a write statement, keeping the contention counters
+static bool stepWrite(sqlite3_stmt *stmt)
+{
+    startWrite(true);
+    int result = sqlite3_step(stmt);
+    finishWrite();
+    ++contention.writes;
+    lastBusy = result == SQLITE_BUSY;
+    contention.failedWrites += lastBusy;
+    return result == SQLITE_DONE;
+}
+
+static int progressCallback(void *)
+{
+    if (progressHandler())
+        return 0;
+    queryCancelled = true;
+    return 1;
+}
+
+static void installProgressHandler()
+{
+    if (!db)
+        return;
+    if (progressHandler)
+        sqlite3_progress_handler(db, progressInstructions, progressCallback, nullptr);
+    else
+        sqlite3_progress_handler(db, 0, nullptr, nullptr);
+}
+
+void setQueryProgressHandler(QueryProgressHandler handler, int instructions)
+{
+    progressHandler = std::move(handler);
+    progressInstructions = std::max(1, instructions);
+    installProgressHandler();
+}
+
+bool takeQueryCancelled()
+{
+    bool cancelled = queryCancelled;
+    queryCancelled = false;
+    return cancelled;
+}
+
+bool runSpinQuery(long long rows)
+{
+    sqlite3_stmt *stmt = cachedStatement(
+        "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < ?) SELECT SUM(x % 7) FROM n;");
+    if (!stmt)
+        return false;
+    sqlite3_bind_int64(stmt, 1, rows);
+    bool ok = sqlite3_step(stmt) == SQLITE_ROW;
+    releaseStatement(stmt);
+    return ok;
+}
+
+int addProductObserver(ProductObserver observer)
+{
+    int handle = nextObserverHandle++;
+    observers.emplace_back(handle, std::move(observer));
+    return handle;
+}
+
+void removeProductObserver(int handle)
+{
+    observers.erase(std::remove_if(observers.begin(), observers.end(),
+                                   [handle](const auto &entry)
+                                   { return entry.first == handle; }),
+                    observers.end());
+}
+
+bool initDB(const std::string& dbName) {
+    int result = sqlite3_open(dbName.c_str(), &db);
     if (result != SQLITE_OK) {
-        std::cerr << "Failed to create table: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
+        std::cerr << "Failed to open DB: " << sqlite3_errmsg(db) << std::endl;
         return false;
     }
+    attachQueryLog(db);
+    installProgressHandler();
+    sqlite3_busy_handler(db, busyCallback, nullptr);
+    sqlite3_commit_hook(db, commitHook, nullptr);
+    if (dbName != ":memory:" && !dbName.empty())
+        turnstileFd = open((dbName + "-turnstile").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
 
-    return true;
+    return migrateSchema();
+}
+
+void closeDB()
+{
+    cancelBackup();
+    detachQueryLog();
+
+    for (auto &entry : statementCache)
+        sqlite3_finalize(entry.second);
+    statementCache.clear();
+    pendingChanges.clear();
+
+    sqlite3_close(db);
+    db = nullptr;
+
+    releaseTurnstile();
+    if (turnstileFd >= 0)
+        close(turnstileFd);
+    turnstileFd = -1;
+}
+
+bool beginTransaction()
+{
+    if (!db)
+        return false;
+
+    // Left over from a transaction SQLite rolled back on its own
+    pendingChanges.clear();
+
+    startWrite(true);
+    int result = sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr);
+    finishWrite();
+    ++contention.writes;
+    lastBusy = result == SQLITE_BUSY;
+    contention.failedWrites += lastBusy;
+    return result == SQLITE_OK;
+}
+
+bool commitTransaction()
+{
+    if (!db)
+        return false;
+
+    // Readers in other processes can still hold the file; a failed COMMIT
+    // leaves the transaction open, so the caller may retry or roll back
+    startWrite(false);
+    int result = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    finishWrite();
+    lastBusy = result == SQLITE_BUSY;
+    contention.failedWrites += lastBusy;
+    if (result == SQLITE_OK)
+        deliverPendingChanges();
+    else if (sqlite3_get_autocommit(db))
+        pendingChanges.clear(); // the error rolled the transaction back
+    return result == SQLITE_OK;
+}
+
+void rollbackTransaction()
+{
+    pendingChanges.clear();
+    if (db)
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
 }
 
+// Observers get before and after images, and the before image is read ahead
+// of the write. Between the two another process could commit, leaving images
+// (and versions) that never existed, so while anyone observes, a write made
+// outside a transaction takes the write lock before it reads.
+class ObservedWrite
+{
+public:
+    ObservedWrite() : own(!observers.empty() && sqlite3_get_autocommit(db) && beginTransaction()) {}
+    ~ObservedWrite()
+    {
+        if (own)
+            rollbackTransaction();
+    }
+
+    // Commits when the write succeeded; the result is whether it stuck
+    bool finish(bool success)
+    {
+        if (!own)
+            return success;
+        own = false;
+        if (success && commitTransaction())
+            return true;
+        rollbackTransaction();
+        return false;
+    }
+
+private:
+    bool own;
+};
+
 bool addProduct(const Product& product) {
-    const char* sql = "INSERT INTO products (name, quantity, price) VALUES (?, ?, ?);";
-    sqlite3_stmt* stmt;
+    if (!db)
+        return false;
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    sqlite3_stmt* stmt = cachedStatement(insertSQL<Product>());
+    if (!stmt)
         return false;
 
-    sqlite3_bind_text(stmt, 1, product.name.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_int(stmt, 2, product.quantity);
-    sqlite3_bind_double(stmt, 3, product.price);
+    bindFields(stmt, product);
 
-    bool success = (sqlite3_step(stmt) == SQLITE_DONE);
-    sqlite3_finalize(stmt);
+    bool success = stepWrite(stmt);
+    releaseStatement(stmt);
+
+    if (success)
+    {
+        Product added = product;
+        added.id = (int)sqlite3_last_insert_rowid(db);
+        added.version = 0; // the column default; insertSQL does not bind it
+        notifyObservers(ProductChange::Added, noProduct, added);
+    }
+    return success;
+}
+
+int lastInsertedProductId()
+{
+    return db ? (int)sqlite3_last_insert_rowid(db) : -1;
+}
+
+bool restoreProduct(const Product &product)
+{
+    if (!db)
+        return false;
+
+    sqlite3_stmt *stmt = cachedStatement(insertWithKeySQL<Product>());
+    if (!stmt)
+        return false;
+
+    // Re-creating the row is a change too, so an editor still holding the
+    // deleted version sees a conflict
+    Product restored = product;
+    ++restored.version;
+    sqlite3_bind_int(stmt, 1, restored.id);
+    sqlite3_bind_int(stmt, bindFields(stmt, restored, 2), restored.version);
+
+    bool success = stepWrite(stmt);
+    releaseStatement(stmt);
+
+    if (success)
+        notifyObservers(ProductChange::Added, noProduct, restored);
     return success;
 }
 
@@ -78,24 +744,51 @@ bool addProduct(const Product& product) {
 //     return success;
 // }
 
-std::vector<Product> getAllProducts() {
-    const char* sql = "SELECT * FROM products;";
-    sqlite3_stmt* stmt;
-    std::vector<Product> products;
+bool stepRow(sqlite3_stmt *stmt)
+{
+    return sqlite3_step(stmt) == SQLITE_ROW;
+}
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return products;
+void finalizeStatement(sqlite3_stmt *stmt)
+{
+    sqlite3_finalize(stmt);
+}
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Product p;
-        p.id = sqlite3_column_int(stmt, 0);
-        p.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        p.quantity = sqlite3_column_int(stmt, 2);
-        p.price = sqlite3_column_double(stmt, 3);
-        products.push_back(p);
-    }
+static Cursor<Product> openProductQuery(const std::string &sql)
+{
+    sqlite3_stmt *stmt;
 
-    sqlite3_finalize(stmt);
+    if (!db || sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return {};
+
+    return Cursor<Product>(stmt, &readRowInto<Product>);
+}
+
+Cursor<SkuEntry> openSkus()
+{
+    sqlite3_stmt *stmt;
+    std::string sql = selectSQL<SkuEntry>("WHERE sku <> ''");
+
+    if (!db || sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return {};
+
+    return Cursor<SkuEntry>(stmt, &readRowInto<SkuEntry>);
+}
+
+Cursor<Product> openLowStockProducts()
+{
+    return openProductQuery(selectSQL<Product>("WHERE quantity < reorder_level"));
+}
+
+Cursor<Product> openProducts()
+{
+    return openProductQuery(selectSQL<Product>());
+}
+
+std::vector<Product> getAllProducts() {
+    std::vector<Product> products;
+    for (const Product &p : openProducts())
+        products.push_back(p);
     return products;
 }
 
@@ -125,65 +818,100 @@ std::vector<Product> getAllProducts() {
 
 
 // date: 03.06.2025
+Cursor<Product> openProductSearch(const std::string &keyword)
+{
+    if (!db)
+        return {};
+
+    bool isNumber = !keyword.empty() && keyword.size() < 10 && std::all_of(keyword.begin(), keyword.end(), ::isdigit);
+
+    // "id = ?1 OR name LIKE ?2" would walk the table for the ID as well; as a
+    // primary key lookup followed by the other name matches, the exact ID
+    // also comes first
+    static const std::string byName = selectSQL<Product>("WHERE name LIKE ?2");
+    static const std::string byIdThenName = []
+    {
+        std::string byId = selectSQL<Product>("WHERE id = ?1");
+        byId.pop_back(); // ';'
+        return byId + " UNION ALL " + selectSQL<Product>("WHERE name LIKE ?2 AND id <> ?1");
+    }();
+    const std::string &sql = isNumber ? byIdThenName : byName;
+    std::string pattern = "%" + keyword + "%";
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return {};
+
+    if (isNumber)
+        sqlite3_bind_int64(stmt, 1, std::stoll(keyword));
+    sqlite3_bind_text(stmt, 2, pattern.c_str(), -1, SQLITE_TRANSIENT);
+
+    return Cursor<Product>(stmt, &readRowInto<Product>);
+}
+
 std::vector<Product> searchProducts(const std::string &keyword)
 {
     std::vector<Product> results;
+    for (const Product &p : openProductSearch(keyword))
+        results.push_back(p);
+    return results;
+}
 
-    if (!db)
-        return results;
+const char *const inventorySummarySQL =
+    "SELECT COUNT(*), SUM(quantity), SUM(quantity * price_cents / 1000000000),"
+    " SUM(quantity * price_cents % 1000000000) FROM products;";
 
-    std::string sql;
-    bool isNumber = std::all_of(keyword.begin(), keyword.end(), ::isdigit);
+Money inventoryValue(long long billions, long long rest)
+{
+    const long long scale = 1000000000LL;
+    const long long limit = (std::numeric_limits<long long>::max() - scale) / scale;
+    if (billions > limit)
+        return Money::fromCents(std::numeric_limits<long long>::max());
+    if (billions < -limit)
+        return Money::fromCents(std::numeric_limits<long long>::min());
+    return Money::fromCents(billions * scale + rest);
+}
 
-    if (isNumber)
-    {
-        sql = "SELECT * FROM products WHERE id = " + keyword + " OR name LIKE '%" + keyword + "%';";
-    }
-    else
-    {
-        sql = "SELECT * FROM products WHERE name LIKE '%" + keyword + "%';";
-    }
+InventorySummary getInventorySummary()
+{
+    InventorySummary summary = {0, 0, {}};
+    if (!db)
+        return summary;
 
+    // Integer SUM is exact (TOTAL would go through floating point)
     sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+
+    if (sqlite3_prepare_v2(db, inventorySummarySQL, -1, &stmt, nullptr) == SQLITE_OK)
     {
-        while (sqlite3_step(stmt) == SQLITE_ROW)
+        if (sqlite3_step(stmt) == SQLITE_ROW)
         {
-            Product p;
-            p.id = sqlite3_column_int(stmt, 0);
-            p.name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
-            p.quantity = sqlite3_column_int(stmt, 2);
-            p.price = sqlite3_column_double(stmt, 3);
-            results.push_back(p);
+            summary.productCount = sqlite3_column_int(stmt, 0);
+            summary.totalUnits = sqlite3_column_int64(stmt, 1);
+            summary.totalValue = inventoryValue(sqlite3_column_int64(stmt, 2), sqlite3_column_int64(stmt, 3));
         }
         sqlite3_finalize(stmt);
     }
 
-    return results;
+    return summary;
 }
 
 Product getProductById(int id)
 {
-    Product p = {-1, "", 0, 0.0};
+    Product p = noProduct;
     if (!db)
         return p;
 
-    std::string sql = "SELECT * FROM products WHERE id = ?;";
-    sqlite3_stmt *stmt;
+    static const std::string sql = selectSQL<Product>("WHERE id = ?");
+    sqlite3_stmt *stmt = cachedStatement(sql);
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    if (stmt)
     {
         sqlite3_bind_int(stmt, 1, id);
 
         if (sqlite3_step(stmt) == SQLITE_ROW)
-        {
-            p.id = sqlite3_column_int(stmt, 0);
-            p.name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
-            p.quantity = sqlite3_column_int(stmt, 2);
-            p.price = sqlite3_column_double(stmt, 3);
-        }
+            p = readRow<Product>(stmt);
 
-        sqlite3_finalize(stmt);
+        releaseStatement(stmt);
     }
 
     return p;
@@ -194,48 +922,677 @@ bool updateProduct(const Product &p)
     if (!db)
         return false;
 
-    std::string sql = "UPDATE products SET name = ?, quantity = ?, price = ? WHERE id = ?;";
-    sqlite3_stmt *stmt;
+    ObservedWrite write;
+    Product before = observers.empty() ? noProduct : getProductById(p.id);
+    sqlite3_stmt *stmt = cachedStatement(updateSQL<Product>());
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    if (stmt)
     {
-        sqlite3_bind_text(stmt, 1, p.name.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_int(stmt, 2, p.quantity);
-        sqlite3_bind_double(stmt, 3, p.price);
-        sqlite3_bind_int(stmt, 4, p.id);
+        int keyIndex = bindFields(stmt, p);
+        sqlite3_bind_int(stmt, keyIndex, p.id);
 
-        if (sqlite3_step(stmt) == SQLITE_DONE)
+        if (stepWrite(stmt))
         {
-            sqlite3_finalize(stmt);
-            return true;
+            releaseStatement(stmt);
+            if (sqlite3_changes(db) > 0)
+            {
+                Product after = p;
+                after.version = before.version + 1;
+                notifyObservers(ProductChange::Updated, before, after);
+            }
+            return write.finish(true);
         }
 
-        sqlite3_finalize(stmt);
+        releaseStatement(stmt);
     }
 
     return false;
 }
 
+UpdateResult updateProductIfUnchanged(const Product &p, Product &current)
+{
+    if (!db)
+        return UpdateResult::Failed;
+
+    // Observers need the old values, which are gone after the UPDATE. If the
+    // row already moved on, there is no need to try the write at all.
+    Product before = noProduct;
+    if (!observers.empty())
+    {
+        before = getProductById(p.id);
+        if (before.id < 0 || before.version != p.version)
+        {
+            current = before;
+            return before.id < 0 ? UpdateResult::NotFound : UpdateResult::Conflict;
+        }
+    }
+
+    sqlite3_stmt *stmt = cachedStatement(compareAndSetSQL<Product>());
+    if (!stmt)
+        return UpdateResult::Failed;
+
+    int keyIndex = bindFields(stmt, p);
+    sqlite3_bind_int(stmt, keyIndex, p.id);
+    sqlite3_bind_int(stmt, keyIndex + 1, p.version);
+
+    bool stepped = stepWrite(stmt);
+    releaseStatement(stmt);
+    if (!stepped)
+        return UpdateResult::Failed;
+
+    // No row matched: another terminal changed or deleted it since p was read
+    if (sqlite3_changes(db) == 0)
+    {
+        current = getProductById(p.id);
+        return current.id < 0 ? UpdateResult::NotFound : UpdateResult::Conflict;
+    }
+
+    current = p;
+    ++current.version;
+    notifyObservers(ProductChange::Updated, before, current);
+    return UpdateResult::Updated;
+}
+
 bool deleteProduct(int id)
 {
     if (!db)
         return false;
 
-    std::string sql = "DELETE FROM products WHERE id = ?;";
-    sqlite3_stmt *stmt;
+    ObservedWrite write;
+    Product before = observers.empty() ? noProduct : getProductById(id);
+    sqlite3_stmt *stmt = cachedStatement("DELETE FROM products WHERE id = ?;");
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    if (stmt)
     {
         sqlite3_bind_int(stmt, 1, id);
 
-        if (sqlite3_step(stmt) == SQLITE_DONE)
+        if (stepWrite(stmt))
         {
-            sqlite3_finalize(stmt);
-            return true;
+            releaseStatement(stmt);
+            if (sqlite3_changes(db) > 0)
+                notifyObservers(ProductChange::Deleted, before, noProduct);
+            return write.finish(true);
         }
 
-        sqlite3_finalize(stmt);
+        releaseStatement(stmt);
     }
 
     return false;
 }
+
+bool adjustQuantity(int id, int delta)
+{
+    if (!db)
+        return false;
+
+    ObservedWrite write;
+    Product before = observers.empty() ? noProduct : getProductById(id);
+    sqlite3_stmt *stmt = cachedStatement("UPDATE products SET quantity = quantity + ?, version = version + 1 WHERE id = ?;");
+    if (!stmt)
+        return false;
+
+    sqlite3_bind_int(stmt, 1, delta);
+    sqlite3_bind_int(stmt, 2, id);
+
+    bool success = stepWrite(stmt) && sqlite3_changes(db) > 0;
+    releaseStatement(stmt);
+
+    if (success && !observers.empty())
+    {
+        Product after = before;
+        after.quantity += delta;
+        ++after.version;
+        notifyObservers(ProductChange::Updated, before, after);
+    }
+    return write.finish(success);
+}
+
+int addLocation(const std::string &name)
+{
+    if (!db || name.empty())
+        return -1;
+
+    sqlite3_stmt *stmt = cachedStatement("INSERT INTO locations (name) VALUES (?);");
+    if (!stmt)
+        return -1;
+
+    sqlite3_bind_text(stmt, 1, name.c_str(), (int)name.size(), SQLITE_STATIC);
+    bool success = stepWrite(stmt);
+    releaseStatement(stmt);
+    return success ? (int)sqlite3_last_insert_rowid(db) : -1;
+}
+
+std::vector<Location> getLocations()
+{
+    std::vector<Location> locations;
+    static const std::string sql = selectSQL<Location>("ORDER BY name");
+    sqlite3_stmt *stmt = db ? cachedStatement(sql) : nullptr;
+    if (!stmt)
+        return locations;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        locations.push_back(readRow<Location>(stmt));
+    releaseStatement(stmt);
+    return locations;
+}
+
+// Add delta to one stock row, creating it on first receipt. Taking stock
+// out needs an existing row, and the CHECK on quantity rejects taking more
+// than the location holds.
+static bool changeStock(int locationId, int productId, int delta)
+{
+    sqlite3_stmt *stmt = cachedStatement(
+        delta > 0 ? "INSERT INTO stock (location_id, product_id, quantity) VALUES (?1, ?2, ?3) "
+                    "ON CONFLICT (location_id, product_id) DO UPDATE SET quantity = quantity + excluded.quantity;"
+                  : "UPDATE stock SET quantity = quantity + ?3 WHERE location_id = ?1 AND product_id = ?2;");
+    if (!stmt)
+        return false;
+
+    sqlite3_bind_int(stmt, 1, locationId);
+    sqlite3_bind_int(stmt, 2, productId);
+    sqlite3_bind_int(stmt, 3, delta);
+    bool success = stepWrite(stmt) && sqlite3_changes(db) > 0;
+    releaseStatement(stmt);
+    return success;
+}
+
+bool adjustStock(int locationId, int productId, int delta)
+{
+    if (!db || delta == 0)
+        return false;
+
+    ObservedWrite write;
+    Product before = observers.empty() ? noProduct : getProductById(productId);
+    if (!changeStock(locationId, productId, delta))
+        return false;
+
+    if (!observers.empty())
+    {
+        Product after = before;
+        after.quantity += delta;
+        ++after.version;
+        notifyObservers(ProductChange::Updated, before, after);
+    }
+    return write.finish(true);
+}
+
+std::vector<StockEntry> getProductStock(int productId)
+{
+    std::vector<StockEntry> entries;
+    static const std::string sql = selectSQL<StockEntry>("WHERE product_id = ? ORDER BY location_id");
+    sqlite3_stmt *stmt = db ? cachedStatement(sql) : nullptr;
+    if (!stmt)
+        return entries;
+
+    sqlite3_bind_int(stmt, 1, productId);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        entries.push_back(readRow<StockEntry>(stmt));
+    releaseStatement(stmt);
+    return entries;
+}
+
+bool transferStock(int productId, int fromLocation, int toLocation, int quantity)
+{
+    if (!db || quantity <= 0 || fromLocation == toLocation)
+        return false;
+
+    // A savepoint nests inside batch transactions and starts one otherwise.
+    // Stock rows move the total through the triggers; the unassigned side
+    // has no row, so the total is corrected directly to stay unchanged.
+    passTurnstile();
+    if (sqlite3_exec(db, "SAVEPOINT transfer_stock;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return false;
+
+    // Unassigned units are only what the locations do not account for. The
+    // check is part of the UPDATE, so it runs under the write lock that
+    // statement takes and no other writer can spend the same units.
+    sqlite3_stmt *unassigned = cachedStatement(
+        "UPDATE products SET quantity = quantity + ?1 WHERE id = ?2 AND "
+        "(?1 > 0 OR quantity + ?1 >= (SELECT COALESCE(SUM(quantity), 0) FROM stock WHERE product_id = ?2));");
+    auto correctTotal = [&](int delta)
+    {
+        if (!unassigned)
+            return false;
+        sqlite3_bind_int(unassigned, 1, delta);
+        sqlite3_bind_int(unassigned, 2, productId);
+        bool success = stepWrite(unassigned) && sqlite3_changes(db) > 0;
+        releaseStatement(unassigned);
+        return success;
+    };
+
+    bool success = (fromLocation ? changeStock(fromLocation, productId, -quantity) : correctTotal(-quantity)) &&
+                   (toLocation ? changeStock(toLocation, productId, quantity) : correctTotal(quantity));
+
+    if (!success)
+        sqlite3_exec(db, "ROLLBACK TO transfer_stock;", nullptr, nullptr, nullptr);
+    startWrite(false);
+    sqlite3_exec(db, "RELEASE transfer_stock;", nullptr, nullptr, nullptr);
+    finishWrite();
+    return success;
+}
+
+Cursor<LocationStock> openLocationStock(int locationId)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = selectSQL<LocationStock>("WHERE stock.location_id = ? ORDER BY stock.product_id");
+
+    if (!db || sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return {};
+
+    sqlite3_bind_int(stmt, 1, locationId);
+    return Cursor<LocationStock>(stmt, &readRowInto<LocationStock>);
+}
+
+int addCategory(const std::string &name, int parentId)
+{
+    if (!db || name.empty() || name.find('/') != std::string::npos)
+        return -1;
+    if (parentId != 0 && getCategory(parentId).id < 0)
+        return -1;
+
+    sqlite3_stmt *stmt = cachedStatement("INSERT INTO categories (parent_id, name) VALUES (?, ?);");
+    if (!stmt)
+        return -1;
+
+    sqlite3_bind_int(stmt, 1, parentId);
+    sqlite3_bind_text(stmt, 2, name.c_str(), (int)name.size(), SQLITE_STATIC);
+    bool success = stepWrite(stmt);
+    releaseStatement(stmt);
+    return success ? (int)sqlite3_last_insert_rowid(db) : -1;
+}
+
+int addCategoryPath(const std::string &path)
+{
+    int parent = 0;
+    size_t start = 0;
+    while (start <= path.size())
+    {
+        size_t end = std::min(path.find('/', start), path.size());
+        std::string name = path.substr(start, end - start);
+        start = end + 1;
+
+        // Surrounding spaces are not part of a name ("Electronics / Cables")
+        size_t first = name.find_first_not_of(' ');
+        if (first == std::string::npos)
+            return -1;
+        name = name.substr(first, name.find_last_not_of(' ') - first + 1);
+
+        int id = -1;
+        for (const Category &c : getCategoryChildren(parent))
+            if (c.name == name)
+                id = c.id;
+        parent = id > 0 ? id : addCategory(name, parent);
+        if (parent < 0)
+            return -1;
+    }
+    return parent;
+}
+
+Category getCategory(int id)
+{
+    Category c = {-1, 0, "", 0, 0, 0, {}};
+    static const std::string sql = selectSQL<Category>("WHERE id = ?");
+    sqlite3_stmt *stmt = db ? cachedStatement(sql) : nullptr;
+    if (!stmt)
+        return c;
+
+    sqlite3_bind_int(stmt, 1, id);
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        c = readRow<Category>(stmt);
+    releaseStatement(stmt);
+    return c;
+}
+
+std::vector<Category> getCategoryChildren(int parentId)
+{
+    std::vector<Category> children;
+    static const std::string sql = selectSQL<Category>("WHERE parent_id = ? ORDER BY name");
+    sqlite3_stmt *stmt = db ? cachedStatement(sql) : nullptr;
+    if (!stmt)
+        return children;
+
+    sqlite3_bind_int(stmt, 1, parentId);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        children.push_back(readRow<Category>(stmt));
+    releaseStatement(stmt);
+    return children;
+}
+
+std::string getCategoryPath(int id)
+{
+    std::string path;
+    sqlite3_stmt *stmt = db ? cachedStatement("SELECT c.name FROM category_paths p JOIN categories c ON c.id = p.ancestor "
+                                              "WHERE p.descendant = ? ORDER BY p.depth DESC;")
+                            : nullptr;
+    if (!stmt)
+        return path;
+
+    sqlite3_bind_int(stmt, 1, id);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        if (!path.empty())
+            path += '/';
+        path += reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+    }
+    releaseStatement(stmt);
+    return path;
+}
+
+// Run one statement of a multi-step change with up to three integer parameters
+static bool execWith(const char *sql, int a, int b = 0, int c = 0)
+{
+    sqlite3_stmt *stmt = cachedStatement(sql);
+    if (!stmt)
+        return false;
+
+    sqlite3_bind_int(stmt, 1, a);
+    sqlite3_bind_int(stmt, 2, b);
+    sqlite3_bind_int(stmt, 3, c);
+    bool success = stepWrite(stmt);
+    releaseStatement(stmt);
+    return success;
+}
+
+bool moveCategory(int id, int newParentId)
+{
+    Category category = getCategory(id);
+    if (category.id < 0 || category.parentId == newParentId)
+        return category.id >= 0;
+    if (newParentId != 0 && getCategory(newParentId).id < 0)
+        return false;
+
+    // A category cannot go below itself
+    sqlite3_stmt *inside = cachedStatement("SELECT 1 FROM category_paths WHERE ancestor = ? AND descendant = ?;");
+    if (!inside)
+        return false;
+    sqlite3_bind_int(inside, 1, id);
+    sqlite3_bind_int(inside, 2, newParentId);
+    bool cycle = sqlite3_step(inside) == SQLITE_ROW;
+    releaseStatement(inside);
+    if (cycle)
+        return false;
+
+    passTurnstile();
+    if (sqlite3_exec(db, "SAVEPOINT move_category;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return false;
+
+    // The subtree's totals leave the old ancestors and join the new ones;
+    // paths from the old ancestors into the subtree are replaced by the
+    // cross product of the new parent's ancestors and the subtree
+    auto shiftTotals = [&](int sign)
+    {
+        sqlite3_stmt *stmt = cachedStatement(
+            "UPDATE categories SET products = products + ?1 * ?2, units = units + ?1 * ?3, "
+            "value_cents = value_cents + ?1 * ?4 "
+            "WHERE id IN (SELECT ancestor FROM category_paths WHERE descendant = ?5 AND depth > 0);");
+        if (!stmt)
+            return false;
+        sqlite3_bind_int(stmt, 1, sign);
+        sqlite3_bind_int(stmt, 2, category.products);
+        sqlite3_bind_int64(stmt, 3, category.units);
+        sqlite3_bind_int64(stmt, 4, category.value.cents);
+        sqlite3_bind_int(stmt, 5, id);
+        bool success = stepWrite(stmt);
+        releaseStatement(stmt);
+        return success;
+    };
+
+    bool success =
+        shiftTotals(-1) &&
+        execWith("UPDATE categories SET children = children - 1 WHERE id = ?1;", category.parentId) &&
+        execWith("DELETE FROM category_paths "
+                 "WHERE descendant IN (SELECT descendant FROM category_paths WHERE ancestor = ?1) "
+                 "AND ancestor IN (SELECT ancestor FROM category_paths WHERE descendant = ?1 AND depth > 0);",
+                 id) &&
+        execWith("INSERT INTO category_paths (ancestor, descendant, depth) "
+                 "SELECT a.ancestor, d.descendant, a.depth + d.depth + 1 "
+                 "FROM category_paths a JOIN category_paths d ON d.ancestor = ?1 WHERE a.descendant = ?2;",
+                 id, newParentId) &&
+        execWith("UPDATE categories SET parent_id = ?2 WHERE id = ?1;", id, newParentId) &&
+        execWith("UPDATE categories SET children = children + 1 WHERE id = ?1;", newParentId) &&
+        shiftTotals(1);
+
+    if (!success)
+        sqlite3_exec(db, "ROLLBACK TO move_category;", nullptr, nullptr, nullptr);
+    startWrite(false);
+    sqlite3_exec(db, "RELEASE move_category;", nullptr, nullptr, nullptr);
+    finishWrite();
+    return success;
+}
+
+bool deleteCategory(int id)
+{
+    Category category = getCategory(id);
+    if (category.id < 0 || category.children > 0 || category.products > 0)
+        return false;
+    return execWith("DELETE FROM categories WHERE id = ?1;", id) && sqlite3_changes(db) > 0;
+}
+
+bool setProductCategory(int productId, int categoryId)
+{
+    if (!db || (categoryId != 0 && getCategory(categoryId).id < 0))
+        return false;
+
+    ObservedWrite write;
+    Product before = getProductById(productId);
+    if (before.id < 0)
+        return false;
+    if (!execWith("UPDATE products SET category_id = ?2, version = version + 1 WHERE id = ?1;", productId,
+                  categoryId))
+        return false;
+
+    Product after = before;
+    after.categoryId = categoryId;
+    ++after.version;
+    notifyObservers(ProductChange::Updated, before, after);
+    return write.finish(true);
+}
+
+Cursor<Product> openCategoryProducts(int categoryId)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = selectSQL<Product>("WHERE category_id = ? ORDER BY id");
+
+    if (!db || sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return {};
+
+    sqlite3_bind_int(stmt, 1, categoryId);
+    return Cursor<Product>(stmt, &readRowInto<Product>);
+}
+
+static bool isDate(const std::string &text)
+{
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-')
+        return false;
+    for (int i : {0, 1, 2, 3, 5, 6, 8, 9})
+        if (text[i] < '0' || text[i] > '9')
+            return false;
+    static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int year = std::stoi(text.substr(0, 4)), month = std::stoi(text.substr(5, 2)), day = std::stoi(text.substr(8, 2));
+    if (month < 1 || month > 12 || day < 1)
+        return false;
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return day <= monthDays[month - 1] + (month == 2 && leap);
+}
+
+int receiveLot(int productId, const std::string &code, const std::string &expires, int quantity)
+{
+    if (!db || quantity <= 0 || (!expires.empty() && !isDate(expires)))
+        return -1;
+
+    ObservedWrite write;
+    Product before = observers.empty() ? noProduct : getProductById(productId);
+    static const std::string sql = insertSQL<Lot>();
+    sqlite3_stmt *stmt = cachedStatement(sql);
+    if (!stmt)
+        return -1;
+
+    Lot lot = {0, productId, code, expires, quantity};
+    bindFields(stmt, lot);
+    bool success = stepWrite(stmt);
+    releaseStatement(stmt);
+    if (!success)
+        return -1;
+
+    if (!observers.empty())
+    {
+        Product after = before;
+        after.quantity += quantity;
+        ++after.version;
+        notifyObservers(ProductChange::Updated, before, after);
+    }
+    int lotId = (int)sqlite3_last_insert_rowid(db);
+    return write.finish(true) ? lotId : -1;
+}
+
+bool consumeLots(int productId, const std::vector<Lot> &takes)
+{
+    if (!db || takes.empty())
+        return false;
+
+    Product before = observers.empty() ? noProduct : getProductById(productId);
+    passTurnstile();
+    if (sqlite3_exec(db, "SAVEPOINT consume_lots;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return false;
+
+    int units = 0;
+    bool success = true;
+    for (size_t i = 0; success && i < takes.size(); ++i)
+    {
+        sqlite3_stmt *stmt = cachedStatement(
+            "UPDATE lots SET quantity = quantity - ?3 WHERE id = ?2 AND product_id = ?1 AND quantity >= ?3;");
+        if (!stmt)
+        {
+            success = false;
+            break;
+        }
+        sqlite3_bind_int(stmt, 1, productId);
+        sqlite3_bind_int(stmt, 2, takes[i].id);
+        sqlite3_bind_int(stmt, 3, takes[i].quantity);
+        success = takes[i].quantity > 0 && stepWrite(stmt) && sqlite3_changes(db) > 0;
+        releaseStatement(stmt);
+        units += takes[i].quantity;
+    }
+
+    if (!success)
+        sqlite3_exec(db, "ROLLBACK TO consume_lots;", nullptr, nullptr, nullptr);
+    startWrite(false);
+    sqlite3_exec(db, "RELEASE consume_lots;", nullptr, nullptr, nullptr);
+    finishWrite();
+
+    // lot_changed bumps the version once per lot
+    if (success && !observers.empty())
+    {
+        Product after = before;
+        after.quantity -= units;
+        after.version += (int)takes.size();
+        notifyObservers(ProductChange::Updated, before, after);
+    }
+    return success;
+}
+
+Cursor<Lot> openProductLots(int productId)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = selectSQL<Lot>("WHERE product_id = ? AND quantity > 0 ORDER BY expires = '', expires, id");
+
+    if (!db || sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return {};
+
+    sqlite3_bind_int(stmt, 1, productId);
+    return Cursor<Lot>(stmt, &readRowInto<Lot>);
+}
+
+static void finishBackup(bool succeeded, const std::string &error)
+{
+    if (backupHandle)
+        sqlite3_backup_finish(backupHandle);
+    if (backupDB)
+        sqlite3_close(backupDB);
+    backupHandle = nullptr;
+    backupDB = nullptr;
+
+    backupProgress.active = false;
+    backupProgress.succeeded = succeeded;
+    backupProgress.error = error;
+}
+
+bool startBackup(const std::string &path, int pagesPerStep)
+{
+    if (!db || backupHandle)
+        return false;
+
+    backupProgress = {};
+    backupProgress.path = path;
+    backupPagesPerStep = std::max(1, pagesPerStep);
+
+    if (sqlite3_open_v2(path.c_str(), &backupDB, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK)
+    {
+        std::string error = sqlite3_errmsg(backupDB);
+        std::cerr << "Backup failed: " << error << std::endl;
+        finishBackup(false, error);
+        return false;
+    }
+
+    backupHandle = sqlite3_backup_init(backupDB, "main", db, "main");
+    if (!backupHandle)
+    {
+        std::string error = sqlite3_errmsg(backupDB);
+        std::cerr << "Backup failed: " << error << std::endl;
+        finishBackup(false, error);
+        return false;
+    }
+
+    backupProgress.active = true;
+    return true;
+}
+
+bool stepBackup()
+{
+    if (!backupHandle)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    int rc = sqlite3_backup_step(backupHandle, backupPagesPerStep);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    BackupProgress &p = backupProgress;
+    p.steps++;
+    p.lastStepMs = ms;
+    p.maxStepMs = std::max(p.maxStepMs, ms);
+    p.totalStepMs += ms;
+    p.totalPages = sqlite3_backup_pagecount(backupHandle);
+    p.remainingPages = sqlite3_backup_remaining(backupHandle);
+
+    switch (rc)
+    {
+    case SQLITE_OK:
+        return true;
+    case SQLITE_BUSY:
+    case SQLITE_LOCKED:
+        // Another connection holds a lock; try again on the next step
+        p.busySteps++;
+        return true;
+    case SQLITE_DONE:
+        finishBackup(true, "");
+        return false;
+    default:
+    {
+        std::string error = sqlite3_errstr(rc);
+        std::cerr << "Backup failed: " << error << std::endl;
+        finishBackup(false, error);
+        return false;
+    }
+    }
+}
+
+void cancelBackup()
+{
+    if (backupHandle)
+        finishBackup(false, "cancelled");
+}
+
+const BackupProgress &getBackupProgress()
+{
+    return backupProgress;
+}
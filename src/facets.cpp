@@ -0,0 +1,183 @@
+#include "facets.hpp"
+#include "db.hpp"
+#include <cstdint>
+
+// How a facet sorts a product into one of its values
+struct FacetDefinition {
+    const char *name;
+    std::vector<const char *> labels;
+    size_t (*bucket)(const Product &);
+};
+
+static size_t decadeBucket(long long value, long long first, size_t buckets)
+{
+    // < first, < 10 * first, < 100 * first, ... (last bucket open-ended)
+    size_t i = 0;
+    for (long long limit = first; i + 1 < buckets && value >= limit; limit *= 10)
+        ++i;
+    return i;
+}
+
+static const std::vector<FacetDefinition> definitions = {
+    {"Quantity",
+     {"Out of stock", "1-9", "10-99", "100-999", "1000+"},
+     [](const Product &p) { return decadeBucket(p.quantity, 1, 5); }},
+    {"Price",
+     {"Under 1.00", "1.00-9.99", "10.00-99.99", "100.00-999.99", "1000.00+"},
+     [](const Product &p) { return decadeBucket(p.price.cents, 100, 5); }},
+    {"Stock level",
+     {"Below reorder level", "OK", "No reorder level"},
+     [](const Product &p) -> size_t { return p.reorderLevel <= 0 ? 2 : p.quantity < p.reorderLevel ? 0 : 1; }},
+    {"Barcode",
+     {"With SKU", "Without SKU"},
+     [](const Product &p) -> size_t { return p.sku.empty() ? 1 : 0; }},
+};
+
+static std::vector<Facet> facets;
+static RoaringBitmap allProducts;
+static unsigned revision = 0;
+static int observerHandle = 0;
+
+static void onProductChange(const ProductChange &change)
+{
+    bool moved = false;
+    for (size_t f = 0; f < definitions.size(); ++f)
+    {
+        size_t from = change.before.id >= 0 ? definitions[f].bucket(change.before) : SIZE_MAX;
+        size_t to = change.after.id >= 0 ? definitions[f].bucket(change.after) : SIZE_MAX;
+        if (from == to)
+            continue;
+
+        if (from != SIZE_MAX)
+            facets[f].values[from].products.remove((uint32_t)change.before.id);
+        if (to != SIZE_MAX)
+            facets[f].values[to].products.add((uint32_t)change.after.id);
+        moved = true;
+    }
+
+    if (change.kind == ProductChange::Added)
+        allProducts.add((uint32_t)change.after.id);
+    else if (change.kind == ProductChange::Deleted)
+        allProducts.remove((uint32_t)change.before.id);
+
+    if (moved || change.kind != ProductChange::Updated)
+        ++revision;
+}
+
+void initFacets()
+{
+    if (observerHandle)
+        return;
+
+    facets.clear();
+    for (const FacetDefinition &d : definitions)
+    {
+        Facet facet;
+        facet.name = d.name;
+        for (const char *label : d.labels)
+            facet.values.push_back({label, RoaringBitmap()});
+        facets.push_back(std::move(facet));
+    }
+    allProducts.clear();
+
+    // IDs arrive in ascending order, so every add() appends
+    for (const Product &p : openProducts())
+    {
+        allProducts.add((uint32_t)p.id);
+        for (size_t f = 0; f < definitions.size(); ++f)
+            facets[f].values[definitions[f].bucket(p)].products.add((uint32_t)p.id);
+    }
+
+    ++revision;
+    observerHandle = addProductObserver(onProductChange);
+}
+
+void shutdownFacets()
+{
+    if (observerHandle)
+    {
+        removeProductObserver(observerHandle);
+        observerHandle = 0;
+    }
+    facets.clear();
+    allProducts.clear();
+}
+
+const std::vector<Facet> &getFacets()
+{
+    return facets;
+}
+
+FacetSelection emptyFacetSelection()
+{
+    FacetSelection selection;
+    for (const FacetDefinition &d : definitions)
+        selection.push_back(std::vector<bool>(d.labels.size(), false));
+    return selection;
+}
+
+static bool anySelected(const std::vector<bool> &values)
+{
+    for (bool selected : values)
+        if (selected)
+            return true;
+    return false;
+}
+
+bool isFilteringFacets(const FacetSelection &selection)
+{
+    for (const auto &values : selection)
+        if (anySelected(values))
+            return true;
+    return false;
+}
+
+// AND of every filtering facet except `skip`; false if none of them filters
+static bool filterExcept(const FacetSelection &selection, size_t skip, RoaringBitmap &out)
+{
+    bool filtered = false;
+    for (size_t f = 0; f < facets.size() && f < selection.size(); ++f)
+    {
+        if (f == skip || !anySelected(selection[f]))
+            continue;
+
+        RoaringBitmap either;
+        for (size_t v = 0; v < facets[f].values.size() && v < selection[f].size(); ++v)
+            if (selection[f][v])
+                either |= facets[f].values[v].products;
+
+        if (filtered)
+            out &= either;
+        else
+            out = std::move(either);
+        filtered = true;
+    }
+    return filtered;
+}
+
+RoaringBitmap filterByFacets(const FacetSelection &selection)
+{
+    RoaringBitmap result;
+    if (!filterExcept(selection, SIZE_MAX, result))
+        result = allProducts;
+    return result;
+}
+
+std::vector<std::vector<uint64_t>> countFacets(const FacetSelection &selection)
+{
+    std::vector<std::vector<uint64_t>> counts(facets.size());
+    for (size_t f = 0; f < facets.size(); ++f)
+    {
+        RoaringBitmap others;
+        bool filtered = filterExcept(selection, f, others);
+        for (const FacetValue &value : facets[f].values)
+            counts[f].push_back(filtered ? RoaringBitmap::andCardinality(others, value.products)
+                                         : value.products.cardinality());
+    }
+    return counts;
+}
+
+unsigned getFacetsRevision()
+{
+    return revision;
+}
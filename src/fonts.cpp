@@ -0,0 +1,435 @@
+#include "fonts.hpp"
+#include "imgui.h"
+#include "imgui_internal.h"
+#ifdef IMGUI_ENABLE_FREETYPE
+#include "imgui_freetype.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#else
+#include <unistd.h>
+#endif
+
+// Color emoji fonts shipped with the OS, first match wins
+static const char *const emojiFontCandidates[] = {
+    "/System/Library/Fonts/Apple Color Emoji.ttc",
+    "/usr/share/fonts/truetype/noto/NotoColorEmoji.ttf",
+    "/usr/share/fonts/noto/NotoColorEmoji.ttf",
+    "/usr/share/fonts/google-noto-emoji/NotoColorEmoji.ttf",
+    "C:\\Windows\\Fonts\\seguiemj.ttf",
+};
+
+// Emoji presentation selector (the invisible half of "✏️")
+static const unsigned int variationSelector16 = 0xFE0F;
+
+// Don't rebuild more often than this while new names keep streaming in
+static const double minRebuildInterval = 0.5;
+
+// Largest atlas side accepted from the cache file
+static const int maxCachedTexSize = 16384;
+
+static float fontSize = 16.0f;
+static std::string cacheDir;               // per-user cache directory, "" when caching is off
+static std::unordered_set<ImWchar> glyphs; // non-ASCII codepoints the atlas must contain
+static ImVector<ImWchar> glyphRanges;      // referenced by the atlas until the next build
+static bool pendingGlyphs = false;
+static bool cacheDirty = false;
+static std::string atlasKey;               // fonts, size and glyph set the current atlas was built from
+static bool atlasDirty = false;            // atlas was rasterized this session and not saved yet
+static double lastBuildTime = -1.0e9;
+static FontStats stats = {};
+
+static bool fileExists(const char *path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return file.good();
+}
+
+// Directory of the running executable with a trailing separator, or "" (the
+// working directory) if the platform will not say. The build copies the
+// text font to fonts/ in there.
+static std::string executableDir()
+{
+    char path[4096];
+#if defined(_WIN32)
+    DWORD length = GetModuleFileNameA(nullptr, path, sizeof(path));
+    if (length == 0 || length == sizeof(path))
+        return "";
+#elif defined(__APPLE__)
+    uint32_t size = sizeof(path);
+    if (_NSGetExecutablePath(path, &size) != 0)
+        return "";
+    size_t length = std::char_traits<char>::length(path);
+#else
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+    if (length <= 0 || length == (ssize_t)sizeof(path))
+        return "";
+#endif
+    std::string dir(path, length);
+    size_t slash = dir.find_last_of("/\\");
+    return slash == std::string::npos ? "" : dir.substr(0, slash + 1);
+}
+
+// Per-user cache directory for the app (created if needed), or "" if the
+// platform gives no place for one
+static std::string userCacheDir()
+{
+    std::string base;
+#if defined(_WIN32)
+    if (const char *local = std::getenv("LOCALAPPDATA"))
+        base = local;
+#elif defined(__APPLE__)
+    if (const char *home = std::getenv("HOME"))
+        base = std::string(home) + "/Library/Caches";
+#else
+    const char *xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg)
+        base = xdg;
+    else if (const char *home = std::getenv("HOME"))
+        base = std::string(home) + "/.cache";
+#endif
+    if (base.empty())
+        return "";
+
+    std::error_code error;
+    std::filesystem::path dir = std::filesystem::path(base) / "inventory-app";
+    std::filesystem::create_directories(dir, error);
+    return error ? "" : dir.string();
+}
+
+// Path, size and modification time, so a replaced font file misses the cache
+static std::string describeFontFile(const std::string &path)
+{
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    auto modified = std::filesystem::last_write_time(path, error);
+    return path + " " + std::to_string(size) + " " +
+           std::to_string((long long)modified.time_since_epoch().count()) + "\n";
+}
+
+template <typename T>
+static void writeRaw(std::ofstream &file, const T &value)
+{
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool readRaw(std::ifstream &file, T &value)
+{
+    return (bool)file.read(reinterpret_cast<char *>(&value), sizeof(value));
+}
+
+// Atlas cache layout: key, texture size and UVs, font metrics, glyphs, then
+// the RGBA32 pixels. Raw structs are fine since the key pins the ImGui
+// version and glyph layout.
+static void saveAtlas()
+{
+    ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+    if (!atlasDirty || cacheDir.empty() || !atlas->TexPixelsRGBA32 || atlas->Fonts.Size != 1)
+        return;
+
+    const ImFont *font = atlas->Fonts[0];
+    std::string path = cacheDir + "/atlas.cache";
+    std::string partial = path + ".partial";
+    {
+        std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+        writeRaw(file, (uint32_t)atlasKey.size());
+        file.write(atlasKey.data(), (std::streamsize)atlasKey.size());
+        writeRaw(file, atlas->TexWidth);
+        writeRaw(file, atlas->TexHeight);
+        writeRaw(file, atlas->TexUvWhitePixel);
+        writeRaw(file, atlas->TexUvLines);
+        writeRaw(file, atlas->TexPixelsUseColors);
+        writeRaw(file, font->FontSize);
+        writeRaw(file, font->Ascent);
+        writeRaw(file, font->Descent);
+        writeRaw(file, font->FallbackChar);
+        writeRaw(file, font->EllipsisChar);
+        writeRaw(file, font->EllipsisCharCount);
+        writeRaw(file, font->EllipsisWidth);
+        writeRaw(file, font->EllipsisCharStep);
+        writeRaw(file, font->Glyphs.Size);
+        file.write(reinterpret_cast<const char *>(font->Glyphs.Data), (std::streamsize)font->Glyphs.size_in_bytes());
+        file.write(reinterpret_cast<const char *>(atlas->TexPixelsRGBA32),
+                   (std::streamsize)atlas->TexWidth * atlas->TexHeight * 4);
+        if (!file)
+        {
+            std::fprintf(stderr, "Could not write the font atlas cache %s\n", partial.c_str());
+            file.close();
+            std::remove(partial.c_str());
+            return;
+        }
+    }
+
+    // Renamed into place so another instance never reads half a file
+    std::error_code error;
+    std::filesystem::rename(partial, path, error);
+    if (!error)
+        atlasDirty = false;
+}
+
+// Load the atlas saved for atlasKey into font instead of rasterizing it.
+// The font's sources must already be added to the atlas.
+static bool restoreAtlas(ImFont *font)
+{
+    std::ifstream file(cacheDir + "/atlas.cache", std::ios::binary);
+    uint32_t keyLength;
+    if (!readRaw(file, keyLength) || keyLength != atlasKey.size())
+        return false;
+    std::string key(keyLength, '\0');
+    if (!file.read(&key[0], keyLength) || key != atlasKey)
+        return false;
+
+    int width, height, glyphCount;
+    ImVec2 whitePixel;
+    ImVec4 lines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+    bool useColors;
+    float size, ascent, descent, ellipsisWidth, ellipsisStep;
+    ImWchar fallbackChar, ellipsisChar;
+    short ellipsisCount;
+    if (!readRaw(file, width) || !readRaw(file, height) || !readRaw(file, whitePixel) || !readRaw(file, lines) ||
+        !readRaw(file, useColors) || !readRaw(file, size) || !readRaw(file, ascent) || !readRaw(file, descent) ||
+        !readRaw(file, fallbackChar) || !readRaw(file, ellipsisChar) || !readRaw(file, ellipsisCount) ||
+        !readRaw(file, ellipsisWidth) || !readRaw(file, ellipsisStep) || !readRaw(file, glyphCount))
+        return false;
+    if (width <= 0 || height <= 0 || width > maxCachedTexSize || height > maxCachedTexSize || glyphCount <= 0 ||
+        glyphCount >= 0xFFFF)
+        return false;
+
+    ImVector<ImFontGlyph> cachedGlyphs;
+    cachedGlyphs.resize(glyphCount);
+    if (!file.read(reinterpret_cast<char *>(cachedGlyphs.Data), (std::streamsize)cachedGlyphs.size_in_bytes()))
+        return false;
+
+    size_t pixelBytes = (size_t)width * (size_t)height * 4;
+    unsigned int *pixels = (unsigned int *)IM_ALLOC(pixelBytes);
+    if (!file.read(reinterpret_cast<char *>(pixels), (std::streamsize)pixelBytes))
+    {
+        IM_FREE(pixels);
+        return false;
+    }
+
+    ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+    atlas->ClearTexData();
+    atlas->TexPixelsRGBA32 = pixels;
+    atlas->TexPixelsUseColors = useColors;
+    atlas->TexWidth = width;
+    atlas->TexHeight = height;
+    atlas->TexUvScale = ImVec2(1.0f / width, 1.0f / height);
+    atlas->TexUvWhitePixel = whitePixel;
+    std::memcpy(atlas->TexUvLines, lines, sizeof(lines));
+
+    font->ClearOutputData();
+    font->FontSize = size;
+    font->Ascent = ascent;
+    font->Descent = descent;
+    font->ContainerAtlas = atlas;
+    font->Glyphs.swap(cachedGlyphs);
+    font->FallbackChar = fallbackChar;
+    font->EllipsisChar = ellipsisChar;
+    font->BuildLookupTable();
+
+    // As the builder left them; the lookup table derives its own otherwise
+    font->EllipsisCharCount = ellipsisCount;
+    font->EllipsisWidth = ellipsisWidth;
+    font->EllipsisCharStep = ellipsisStep;
+
+    atlas->TexReady = true;
+    return true;
+}
+
+static void addCodepoint(unsigned int c)
+{
+    if (c < 0x80 || c > IM_UNICODE_CODEPOINT_MAX)
+        return;
+    if (glyphs.insert((ImWchar)c).second)
+    {
+        pendingGlyphs = true;
+        cacheDirty = true;
+    }
+}
+
+static void loadFontCache()
+{
+    std::ifstream file(cacheDir + "/glyphs.cache");
+    unsigned int c;
+    while (file >> std::hex >> c)
+    {
+        glyphs.insert((ImWchar)c);
+        ++stats.cachedGlyphs;
+    }
+}
+
+void saveFontCache()
+{
+    if (cacheDir.empty())
+        return;
+
+    saveAtlas();
+    if (!cacheDirty)
+        return;
+
+    std::ofstream file(cacheDir + "/glyphs.cache", std::ios::trunc);
+    for (ImWchar c : glyphs)
+        file << std::hex << (unsigned int)c << '\n';
+    cacheDirty = false;
+}
+
+static void buildAtlas()
+{
+    ImGuiIO &io = ImGui::GetIO();
+    auto start = std::chrono::steady_clock::now();
+
+    io.Fonts->Clear();
+
+    // The app draws OS cursors, and a cached atlas has no cursor shapes
+    io.Fonts->Flags |= ImFontAtlasFlags_NoMouseCursors;
+
+    // Latin-1 plus the requested codepoints, merged straight from the sorted
+    // set (ImFontGlyphRangesBuilder scans all of Unicode, ~2 ms)
+    std::vector<ImWchar> sortedGlyphs(glyphs.begin(), glyphs.end());
+    std::sort(sortedGlyphs.begin(), sortedGlyphs.end());
+    glyphRanges.clear();
+    glyphRanges.push_back(0x0020);
+    glyphRanges.push_back(0x00FF);
+    for (ImWchar c : sortedGlyphs)
+    {
+        if (c <= glyphRanges.back())
+            continue;
+        if (c == glyphRanges.back() + 1)
+            glyphRanges.back() = c;
+        else
+        {
+            glyphRanges.push_back(c);
+            glyphRanges.push_back(c);
+        }
+    }
+    glyphRanges.push_back(0);
+
+    // Text font rendered at its real size instead of scaling the 13px default
+    static const std::string textFont = executableDir() + "fonts/Roboto-Medium.ttf";
+    ImFontConfig textConfig;
+    textConfig.SizePixels = fontSize;
+    textConfig.GlyphRanges = glyphRanges.Data;
+    bool haveTextFont = fileExists(textFont.c_str());
+    ImFont *font = haveTextFont
+                       ? io.Fonts->AddFontFromFileTTF(textFont.c_str(), fontSize, &textConfig, glyphRanges.Data)
+                       : io.Fonts->AddFontDefault(&textConfig);
+
+#ifdef IMGUI_ENABLE_FREETYPE
+    atlasKey = "imgui " IMGUI_VERSION " freetype";
+#else
+    atlasKey = "imgui " IMGUI_VERSION " stb_truetype";
+#endif
+    atlasKey += " glyph " + std::to_string(sizeof(ImFontGlyph)) + " size " + std::to_string(fontSize) + "\n";
+    atlasKey += haveTextFont ? describeFontFile(textFont) : "default\n";
+
+#ifdef IMGUI_ENABLE_FREETYPE
+    // Emoji are merged in; only the requested codepoints get rasterized
+    for (const char *path : emojiFontCandidates)
+    {
+        if (!fileExists(path))
+            continue;
+
+        ImFontConfig emojiConfig;
+        emojiConfig.MergeMode = true;
+        emojiConfig.OversampleH = emojiConfig.OversampleV = 1;
+        emojiConfig.FontBuilderFlags = ImGuiFreeTypeBuilderFlags_LoadColor | ImGuiFreeTypeBuilderFlags_Bitmap;
+        io.Fonts->AddFontFromFileTTF(path, fontSize, &emojiConfig, glyphRanges.Data);
+        atlasKey += describeFontFile(path);
+        break;
+    }
+#endif
+
+    for (ImWchar c : sortedGlyphs)
+        atlasKey += std::to_string((unsigned int)c) + " ";
+
+    // Rasterizing is most of the startup cost, so a matching atlas is reused
+    stats.atlasCached = !cacheDir.empty() && font && restoreAtlas(font);
+    if (!stats.atlasCached)
+    {
+        io.Fonts->Build();
+
+        // Fonts rarely map U+FE0F; give it a zero-width glyph instead of drawing '?'
+        if (font && !font->FindGlyphNoFallback((ImWchar)variationSelector16))
+        {
+            font->AddGlyph(nullptr, (ImWchar)variationSelector16, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+            font->BuildLookupTable();
+        }
+        atlasDirty = true;
+    }
+
+    unsigned char *pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    stats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.texWidth = width;
+    stats.texHeight = height;
+    stats.texBytes = (size_t)width * (size_t)height * 4;
+    stats.glyphCount = font ? font->Glyphs.Size : 0;
+    ++stats.builds;
+
+    pendingGlyphs = false;
+    lastBuildTime = ImGui::GetTime();
+}
+
+void initFonts(float sizePixels, const char *uiText, bool useCache)
+{
+    fontSize = sizePixels;
+    cacheDir = useCache ? userCacheDir() : "";
+    if (!cacheDir.empty())
+        loadFontCache();
+
+    requestGlyphs(uiText);
+    buildAtlas();
+
+    std::printf("Font atlas: %d glyphs, %dx%d (%.1f KB) %s in %.1f ms\n",
+                stats.glyphCount, stats.texWidth, stats.texHeight,
+                stats.texBytes / 1024.0, stats.atlasCached ? "loaded from cache" : "built", stats.buildMs);
+}
+
+void requestGlyphs(const char *text)
+{
+    if (!text)
+        return;
+
+    // Plain ASCII is always in the atlas, so most names exit here
+    const char *p = text;
+    while (*p && (unsigned char)*p < 0x80)
+        ++p;
+
+    while (*p)
+    {
+        unsigned int c;
+        p += ImTextCharFromUtf8(&c, p, nullptr);
+        addCodepoint(c);
+    }
+}
+
+bool updateFonts()
+{
+    if (!pendingGlyphs || ImGui::GetTime() - lastBuildTime < minRebuildInterval)
+        return false;
+
+    buildAtlas();
+    return true;
+}
+
+const FontStats &getFontStats()
+{
+    return stats;
+}
@@ -1,15 +1,28 @@
 #include "gui.hpp"
 #include "db.hpp"
+#include "alerts.hpp"
+#include "barcode.hpp"
+#include "busy_overlay.hpp"
+#include "fonts.hpp"
+#include "input_replay.hpp"
+#include "undo.hpp"
 #include "imgui.h"
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_opengl3.h"
 // #include <SDL.h>
 // #include <SDL_opengl.h>
 #include <SDL2/SDL.h>
+#ifdef __APPLE__
 #include <OpenGL/gl3.h>
+#else
+#include <SDL2/SDL_opengl.h>
+#endif
+#include <cfloat>
+#include <chrono>
 #include <iostream>
+#include <vector>
 
-void runGUI()
+void runGUI(const GUIOptions &options)
 {
     // Init SDL
     SDL_Init(SDL_INIT_VIDEO);
@@ -28,6 +41,26 @@ void runGUI()
     SDL_GL_MakeCurrent(window, gl_context);
     SDL_GL_SetSwapInterval(1);
 
+    // A replay runs in the recorded window size, as fast as frames can be built
+    RecordingInfo recordingInfo = {800, 600, options.seedRows};
+    if (!options.replayPath.empty())
+    {
+        if (!openReplay(options.replayPath, recordingInfo))
+        {
+            SDL_GL_DeleteContext(gl_context);
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            return;
+        }
+        SDL_SetWindowSize(window, recordingInfo.windowWidth, recordingInfo.windowHeight);
+        SDL_GL_SetSwapInterval(0);
+    }
+    else if (!options.recordPath.empty())
+    {
+        SDL_GetWindowSize(window, &recordingInfo.windowWidth, &recordingInfo.windowHeight);
+        startRecording(options.recordPath, recordingInfo);
+    }
+
     // Print OpenGL version
     const GLubyte *version = glGetString(GL_VERSION);
     std::cout << "OpenGL Version: " << version << std::endl;
@@ -38,9 +71,15 @@ void runGUI()
     ImGuiIO &io = ImGui::GetIO();
     (void)io;
 
+    // Recorded sessions always start from the default layout
+    if (isRecording() || isReplaying())
+        io.IniFilename = nullptr;
+
     // UI Styling
     ImGui::StyleColorsDark();
-    io.FontGlobalScale = 1.2f;
+
+    // Crisp 17px font (instead of scaling the 13px default by 1.2) with emoji merged in
+    initFonts(17.0f, uiGlyphs, true);
 
     ImGuiStyle &style = ImGui::GetStyle();
     style.WindowRounding = 8.0f;
@@ -53,11 +92,19 @@ void runGUI()
     ImGui_ImplSDL2_InitForOpenGL(window, gl_context);
     ImGui_ImplOpenGL3_Init("#version 150");
 
+    // Low-stock alerts, the barcode map and the facets are maintained incrementally from here on
+    initPanels();
+
+    // Long statements from here on keep the window responsive and can be cancelled
+    initBusyOverlay(window);
+
     // App state variables
     bool running = true;
     char name[128] = "";
     int quantity = 0;
-    float price = 0.0f;
+    char price[32] = ""; // parsed exactly by parseMoney, never through float
+    int reorderLevel = 0;
+    char sku[64] = "";
 
     // For UI feedback messages
     std::string statusMessage = "";
@@ -66,537 +113,424 @@ void runGUI()
     // Dark mode toggle state
     bool use_dark = true;
 
-    while (running)
+    // Which panels are open (View menu)
+    struct
     {
-        SDL_Event event;
-        while (SDL_PollEvent(&event))
-        {
-            ImGui_ImplSDL2_ProcessEvent(&event);
-            if (event.type == SDL_QUIT)
-                running = false;
-        }
-
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplSDL2_NewFrame();
-        ImGui::NewFrame();
-
-        // Get SDL window size dynamically for ImGui window sizing
-        int w, h;
-        SDL_GetWindowSize(window, &w, &h);
-        ImGui::SetNextWindowSize(ImVec2((float)w, (float)h), ImGuiCond_Always);
+        bool editor = true;
+        bool products = true;
+        bool search = true;
+        bool dashboard = true;
+        bool alerts = true;
+        bool scanner = false;
+        bool history = false;
+        bool charts = false;
+        bool slowQueries = false;
+        bool locations = false;
+        bool categories = false;
+        bool lots = false;
+    } panels;
+
+    // Last time a backup step ran, so a busy UI cannot starve it
+    double lastBackupStep = 0.0;
+
+    // Events of the current frame, as recorded or as replayed
+    std::vector<SDL_Event> frameEvents;
+    float replayDeltaTime = 0.0f;
+    ImVec2 replayMouse(-FLT_MAX, -FLT_MAX);
 
-        // Begin main window
-        ImGui::Begin("📦 Inventory Manager", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoResize);
-
-        // Dark mode toggle
-        if (ImGui::Checkbox("Dark Mode", &use_dark))
-        {
-            if (use_dark)
-                ImGui::StyleColorsDark();
-            else
-                ImGui::StyleColorsLight();
-        }
-        ImGui::Separator();
+    while (running)
+    {
+        auto frameStart = std::chrono::steady_clock::now();
 
-        ImGui::TextColored(ImVec4(0.2f, 0.7f, 1.0f, 1.0f), "Welcome to Your Inventory System");
-        ImGui::Spacing();
+        beginBusyFrame();
 
-        // Show status message inside UI
-        if (!statusMessage.empty())
+        // Input that arrived while a long query held the last frame comes first
+        frameEvents.clear();
+        SDL_Event polled;
+        while (takeDeferredEvent(polled) || SDL_PollEvent(&polled))
         {
-            ImGui::TextColored(statusColor, "%s", statusMessage.c_str());
-            ImGui::Spacing();
+            // While replaying, the only live input honoured is closing the window
+            if (!isReplaying() || polled.type == SDL_QUIT)
+                frameEvents.push_back(polled);
         }
-
-        // Tabs
-        if (ImGui::BeginTabBar("MainTabs", ImGuiTabBarFlags_FittingPolicyScroll))
+        if (isReplaying())
         {
-            if (ImGui::BeginTabItem("➕ Add Product"))
+            std::vector<SDL_Event> replayed;
+            if (!nextReplayFrame(replayed, replayDeltaTime))
+                break;
+            for (SDL_Event &e : replayed)
             {
-                ImGui::InputText("Product Name", name, IM_ARRAYSIZE(name));
-                ImGui::InputInt("Quantity", &quantity);
-                ImGui::InputFloat("Price", &price);
-
-                if (ImGui::Button("Add Product", ImVec2(150, 40)))
+                // Window IDs differ between runs; everything targets our window
+                if (e.type == SDL_WINDOWEVENT)
                 {
-                    Product p = {0, name, quantity, (double)price};
-                    if (addProduct(p))
-                    {
-                        statusMessage = "✅ Product added!";
-                        statusColor = ImVec4(0, 1, 0, 1);
-                        // Reset inputs
-                        name[0] = '\0';
-                        quantity = 0;
-                        price = 0.0f;
-                    }
-                    else
-                    {
-                        statusMessage = "❌ Failed to add product.";
-                        statusColor = ImVec4(1, 0, 0, 1);
-                    }
+                    e.window.windowID = SDL_GetWindowID(window);
+                    if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                        SDL_SetWindowSize(window, e.window.data1, e.window.data2);
                 }
-
-                ImGui::EndTabItem();
-            }
-
-            if (ImGui::BeginTabItem("📋 View Products"))
-            {
-                // Example product list display using columns
-                ImGui::Text("Product List:");
-                ImGui::Separator();
-
-                ImGui::Columns(4, "product_columns", true);
-                ImGui::Text("ID");
-                ImGui::NextColumn();
-                ImGui::Text("Name");
-                ImGui::NextColumn();
-                ImGui::Text("Quantity");
-                ImGui::NextColumn();
-                ImGui::Text("Price");
-                ImGui::NextColumn();
-
-                // Assuming you have a function to get all products:
-                auto products = getAllProducts(); // Implement this yourself
-
-                for (const auto &prod : products)
+                else if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP)
+                    e.key.windowID = SDL_GetWindowID(window);
+                else if (e.type == SDL_TEXTINPUT)
+                    e.text.windowID = SDL_GetWindowID(window);
+                else if (e.type == SDL_MOUSEMOTION)
                 {
-                    ImGui::Text("%d", prod.id);
-                    ImGui::NextColumn();
-                    ImGui::Text("%s", prod.name.c_str());
-                    ImGui::NextColumn();
-                    ImGui::Text("%d", prod.quantity);
-                    ImGui::NextColumn();
-                    ImGui::Text("%.2f", prod.price);
-                    ImGui::NextColumn();
+                    e.motion.windowID = SDL_GetWindowID(window);
+                    replayMouse = ImVec2((float)e.motion.x, (float)e.motion.y);
                 }
-
-                ImGui::Columns(1);
-
-                ImGui::EndTabItem();
-            }
-
-            if (ImGui::BeginTabItem("🔍 Search"))
-            {
-                renderSearchProduct();
-                ImGui::EndTabItem();
+                else if (e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_MOUSEBUTTONUP)
+                    e.button.windowID = SDL_GetWindowID(window);
+                else if (e.type == SDL_MOUSEWHEEL)
+                    e.wheel.windowID = SDL_GetWindowID(window);
+                frameEvents.push_back(e);
             }
+        }
 
-            if (ImGui::BeginTabItem("✏️ Update Product"))
-            {
-                renderUpdateProduct();
-                ImGui::EndTabItem();
-            }
+        bool hadEvents = !frameEvents.empty();
+        for (SDL_Event &event : frameEvents)
+        {
+            if (event.type == SDL_QUIT)
+                running = false;
 
-            if (ImGui::BeginTabItem("❌ Delete Product"))
+            // In scan mode the keyboard belongs to the scanner: the whole
+            // burst is drained here in one frame and never reaches a widget
+            if (isScanMode())
             {
-                renderDeleteProduct();
-                ImGui::EndTabItem();
+                if (event.type == SDL_TEXTINPUT)
+                {
+                    feedScanText(event.text.text);
+                    continue;
+                }
+                if (event.type == SDL_KEYDOWN)
+                {
+                    SDL_Keycode key = event.key.keysym.sym;
+                    if (key == SDLK_RETURN || key == SDLK_KP_ENTER)
+                        completeScan();
+                    else if (key == SDLK_ESCAPE)
+                        setScanMode(false);
+                    continue;
+                }
+                if (event.type == SDL_KEYUP)
+                    continue;
             }
 
-            ImGui::EndTabBar();
+            ImGui_ImplSDL2_ProcessEvent(&event);
         }
 
-        ImGui::End();
-
-        // Render
-        ImGui::Render();
-        glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        SDL_GL_SwapWindow(window);
-    }
-
-    // Cleanup
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
-    ImGui::DestroyContext();
-    SDL_GL_DeleteContext(gl_context);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-}
-
-void renderProductList()
-{
-    static std::vector<Product> products = getAllProducts();
-
-    ImGui::BeginGroup();
-
-    // Title
-    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "📦 Product List");
-    ImGui::Separator();
-    ImGui::Spacing();
-
-    // Label + Refresh Button (blue style)
-    ImGui::Text("Refresh product list:");
-    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.9f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.3f, 0.6f, 1.0f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.1f, 0.4f, 0.8f, 1.0f));
-
-    if (ImGui::Button("🔄 Refresh List", ImVec2(160, 35)))
-    {
-        // Refresh the products by fetching fresh data
-        products = getAllProducts();
-    }
+        // Everything scanned since the last frame goes in as one transaction
+        applyPendingScans(getScanDelta());
 
-    ImGui::PopStyleColor(3);
-    ImGui::Spacing();
-
-    // Scrollable child for table
-    float tableHeight = 400.0f;
-    ImGui::BeginChild("ProductTableRegion", ImVec2(0, tableHeight), true);
-
-    if (ImGui::BeginTable("ProductTable", 4,
-                          ImGuiTableFlags_Borders |
-                              ImGuiTableFlags_RowBg |
-                              ImGuiTableFlags_Resizable |
-                              ImGuiTableFlags_SizingStretchProp |
-                              ImGuiTableFlags_ScrollY))
-    {
-        ImGui::TableSetupColumn("🆔 ID", ImGuiTableColumnFlags_WidthFixed, 60.0f);
-        ImGui::TableSetupColumn("📦 Name", ImGuiTableColumnFlags_WidthStretch);
-        ImGui::TableSetupColumn("📊 Quantity", ImGuiTableColumnFlags_WidthFixed, 80.0f);
-        ImGui::TableSetupColumn("💵 Price", ImGuiTableColumnFlags_WidthFixed, 80.0f);
-
-        ImGui::TableHeadersRow();
-
-        for (const auto &p : products)
+        if (takeQueryCancelled())
         {
-            ImGui::TableNextRow();
-
-            ImGui::TableSetColumnIndex(0);
-            ImGui::Text("%d", p.id);
-
-            ImGui::TableSetColumnIndex(1);
-            ImGui::TextWrapped("%s", p.name.c_str());
-
-            ImGui::TableSetColumnIndex(2);
-            ImGui::Text("%d", p.quantity);
-
-            ImGui::TableSetColumnIndex(3);
-            ImGui::Text("%.2f", p.price);
+            statusMessage = "⚠️ Query cancelled; lists may be incomplete until they reload";
+            statusColor = ImVec4(1, 0.7f, 0, 1);
         }
 
-        ImGui::EndTable();
-    }
-
-    ImGui::EndChild();
-
-    ImGui::EndGroup();
-}
-
-void renderSearchProduct()
-{
-    static char keyword[128] = "";
-
-    ImGui::Text("🔍 Search for a Product");
-    ImGui::Separator();
-    ImGui::Spacing();
-
-    ImGui::Text("Enter Product ID or Name:");
-    ImGui::PushItemWidth(-1);
-    ImGui::InputText("##SearchBar", keyword, IM_ARRAYSIZE(keyword));
-    ImGui::PopItemWidth();
-
-    ImGui::Spacing();
-
-    // 🔵 Styled "Clear Search" button - soft blue-gray like Update UI
-    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.3f, 0.5f, 0.8f, 1.0f));        // Base color
-    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.4f, 0.6f, 0.9f, 1.0f)); // Hover
-    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.2f, 0.4f, 0.7f, 1.0f));  // Active
-
-    if (ImGui::Button("🔄 Clear Search", ImVec2(150, 35)))
-    {
-        keyword[0] = '\0';
-    }
-
-    ImGui::PopStyleColor(3);
-    ImGui::Spacing();
-
-    if (strlen(keyword) > 0)
-    {
-        std::vector<Product> results = searchProducts(keyword);
-
-        if (results.empty())
+        // Backups copy a few pages per idle frame; while the user keeps
+        // interacting they still advance at least 10 times a second
+        double now = ImGui::GetTime();
+        if (getBackupProgress().active && (!hadEvents || now - lastBackupStep >= 0.1))
         {
-            ImGui::TextColored(ImVec4(1, 0, 0, 1), "No products found matching your search.");
+            stepBackup();
+            lastBackupStep = now;
         }
-        else if (ImGui::BeginTable("SearchTable", 4,
-                                   ImGuiTableFlags_Borders |
-                                       ImGuiTableFlags_RowBg |
-                                       ImGuiTableFlags_Resizable |
-                                       ImGuiTableFlags_SizingStretchProp))
-        {
-            ImGui::TableSetupColumn("🆔 ID", ImGuiTableColumnFlags_WidthFixed, 50.0f);
-            ImGui::TableSetupColumn("📦 Name", ImGuiTableColumnFlags_WidthStretch);
-            ImGui::TableSetupColumn("📊 Quantity", ImGuiTableColumnFlags_WidthFixed, 80.0f);
-            ImGui::TableSetupColumn("💵 Price", ImGuiTableColumnFlags_WidthFixed, 80.0f);
-
-            ImGui::TableHeadersRow();
 
-            for (const auto &p : results)
-            {
-                ImGui::TableNextRow();
-
-                ImGui::TableSetColumnIndex(0);
-                ImGui::Text("%d", p.id);
-
-                ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%s", p.name.c_str());
-
-                ImGui::TableSetColumnIndex(2);
-                ImGui::Text("%d", p.quantity);
-
-                ImGui::TableSetColumnIndex(3);
-                ImGui::Text("%.2f", p.price);
-            }
-
-            ImGui::EndTable();
+        // Newly seen characters (e.g. in product names) grow the atlas between frames
+        if (updateFonts())
+        {
+            ImGui_ImplOpenGL3_DestroyFontsTexture();
+            ImGui_ImplOpenGL3_CreateFontsTexture();
         }
-    }
-}
-
-void renderUpdateProduct()
-{
-    static char inputSearch[128] = "";
-    static Product loadedProduct = {0, "", 0, 0.0};
-    static bool productLoaded = false;
-    static bool updateSuccess = false;
-    static bool updateFailed = false;
-
-    static char updatedName[128] = "";
-    static int updatedQuantity = 0;
-    static float updatedPrice = 0.0f;
-
-    ImGui::BeginGroup();
-
-    ImGui::Text("🛠️ Update Product");
-    ImGui::Separator();
-    ImGui::Spacing();
 
-    ImGui::Text("Enter Product ID or Name:");
-    ImGui::PushItemWidth(-1); // full width input
-    ImGui::InputText("##SearchProduct", inputSearch, IM_ARRAYSIZE(inputSearch));
-    ImGui::PopItemWidth();
-
-    ImGui::Spacing();
-
-    // Styled blue Load button
-    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.9f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.3f, 0.6f, 1.0f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.1f, 0.4f, 0.8f, 1.0f));
-
-    if (ImGui::Button("🔍 Load Product", ImVec2(160, 35)))
-    {
-        productLoaded = false;
-        updateSuccess = false;
-        updateFailed = false;
-
-        std::vector<Product> results = searchProducts(inputSearch);
-
-        if (!results.empty())
-        {
-            loadedProduct = results[0];
-            productLoaded = true;
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplSDL2_NewFrame();
 
-            strcpy(updatedName, loadedProduct.name.c_str());
-            updatedQuantity = loadedProduct.quantity;
-            updatedPrice = (float)loadedProduct.price;
-        }
-        else
+        // The backend just timed the frame and may have read the real mouse;
+        // a replay substitutes what was recorded for both
+        if (isRecording())
+            recordFrame(frameEvents, io.DeltaTime);
+        if (isReplaying())
         {
-            loadedProduct = {0, "", 0, 0.0};
-            productLoaded = false;
+            io.DeltaTime = replayDeltaTime > 0.0f ? replayDeltaTime : 1.0f / 60.0f;
+            io.AddMousePosEvent(replayMouse.x, replayMouse.y);
         }
-    }
-
-    ImGui::PopStyleColor(3); // Restore button color
-
-    ImGui::Spacing();
-
-    if (!productLoaded && strlen(inputSearch) > 0)
-    {
-        ImGui::TextColored(ImVec4(1, 0, 0, 1), "❌ No product found with ID or Name '%s'.", inputSearch);
-    }
 
-    if (productLoaded)
-    {
-        ImGui::PushItemWidth(-1);
-        ImGui::InputText("Updated Name", updatedName, IM_ARRAYSIZE(updatedName));
-        ImGui::InputInt("Updated Quantity", &updatedQuantity);
-        ImGui::InputFloat("Updated Price", &updatedPrice);
-        ImGui::PopItemWidth();
+        ImGui::NewFrame();
 
-        ImGui::Spacing();
+        // Get SDL window size dynamically for the default panel layout
+        int w, h;
+        SDL_GetWindowSize(window, &w, &h);
 
-        // Styled green Update button
-        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.7f, 0.2f, 1.0f));
-        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.3f, 0.85f, 0.3f, 1.0f));
-        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.1f, 0.6f, 0.1f, 1.0f));
+        // Undo/redo shortcuts; while a text field is active it keeps its own
+        if (!io.WantTextInput)
+        {
+            if (ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_Z))
+                undo();
+            else if (ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_Y) ||
+                     ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_Z))
+                redo();
+        }
 
-        if (ImGui::Button("💾 Update Product", ImVec2(180, 40)))
+        // Menu bar: undo/redo and toggling panels on and off
+        float menuHeight = 0.0f;
+        if (ImGui::BeginMainMenuBar())
         {
-            Product updated = {loadedProduct.id, updatedName, updatedQuantity, (double)updatedPrice};
-            if (updateProduct(updated))
+            if (ImGui::BeginMenu("Edit"))
             {
-                updateSuccess = true;
-                updateFailed = false;
-                loadedProduct = updated;
-                strcpy(inputSearch, updatedName);
+                std::string undoText = canUndo() ? "Undo " + undoLabel() : "Undo";
+                std::string redoText = canRedo() ? "Redo " + redoLabel() : "Redo";
+                if (ImGui::MenuItem(undoText.c_str(), "Ctrl+Z", false, canUndo()))
+                    undo();
+                if (ImGui::MenuItem(redoText.c_str(), "Ctrl+Y", false, canRedo()))
+                    redo();
+                ImGui::EndMenu();
             }
-            else
+            if (ImGui::BeginMenu("View"))
             {
-                updateSuccess = false;
-                updateFailed = true;
+                ImGui::MenuItem("Inventory Manager", nullptr, &panels.editor);
+                ImGui::MenuItem("Products", nullptr, &panels.products);
+                ImGui::MenuItem("Search", nullptr, &panels.search);
+                ImGui::MenuItem("Dashboard", nullptr, &panels.dashboard);
+                ImGui::MenuItem("Alerts", nullptr, &panels.alerts);
+                ImGui::MenuItem("Scanner", nullptr, &panels.scanner);
+                ImGui::MenuItem("History", nullptr, &panels.history);
+                ImGui::MenuItem("Charts", nullptr, &panels.charts);
+                ImGui::MenuItem("Slow Queries", nullptr, &panels.slowQueries);
+                ImGui::MenuItem("Locations", nullptr, &panels.locations);
+                ImGui::MenuItem("Categories", nullptr, &panels.categories);
+                ImGui::MenuItem("Lots", nullptr, &panels.lots);
+                ImGui::EndMenu();
             }
+            menuHeight = ImGui::GetWindowSize().y;
+            ImGui::EndMainMenuBar();
         }
 
-        ImGui::PopStyleColor(3); // Restore
+        // Each panel is its own window. Positions below are only the first-run
+        // layout; after that imgui.ini remembers where the user put them.
+        float left = w * 0.45f;
+        float top = menuHeight;
+        float bodyHeight = h - menuHeight;
 
-        if (updateSuccess)
-            ImGui::TextColored(ImVec4(0, 1, 0, 1), "✅ Product updated successfully!");
-        else if (updateFailed)
-            ImGui::TextColored(ImVec4(1, 0, 0, 1), "❌ Update failed. Please try again.");
-    }
+        if (panels.editor)
+        {
+            ImGui::SetNextWindowPos(ImVec2(0, top), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(left, bodyHeight * 0.6f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("📦 Inventory Manager", &panels.editor))
+            {
+                // Dark mode toggle
+                if (ImGui::Checkbox("Dark Mode", &use_dark))
+                {
+                    if (use_dark)
+                        ImGui::StyleColorsDark();
+                    else
+                        ImGui::StyleColorsLight();
+                }
+                ImGui::Separator();
 
-    ImGui::EndGroup();
-}
+                ImGui::TextColored(ImVec4(0.2f, 0.7f, 1.0f, 1.0f), "Welcome to Your Inventory System");
+                ImGui::Spacing();
 
-void renderDeleteProduct()
-{
-    static char inputSearch[128] = "";
-    static Product productToDelete = {0, "", 0, 0.0};
-    static bool showConfirmDialog = false;
-    static bool deleteSuccess = false;
-    static bool deleteFailed = false;
-    static bool productLoaded = false;
+                // Show status message inside UI
+                if (!statusMessage.empty())
+                {
+                    ImGui::TextColored(statusColor, "%s", statusMessage.c_str());
+                    ImGui::Spacing();
+                }
 
-    ImGui::BeginGroup();
+                // Tabs
+                if (ImGui::BeginTabBar("MainTabs", ImGuiTabBarFlags_FittingPolicyScroll))
+                {
+                    if (ImGui::BeginTabItem("➕ Add Product"))
+                    {
+                        ImGui::InputText("Product Name", name, IM_ARRAYSIZE(name));
+                        ImGui::InputInt("Quantity", &quantity);
+                        ImGui::InputText("Price", price, IM_ARRAYSIZE(price), ImGuiInputTextFlags_CharsDecimal);
+                        ImGui::InputInt("Reorder Level", &reorderLevel);
+                        ImGui::InputText("Barcode / SKU", sku, IM_ARRAYSIZE(sku));
+
+                        if (ImGui::Button("Add Product", ImVec2(150, 40)))
+                        {
+                            Product p = {0, name, quantity, {}, reorderLevel, sku};
+                            if (!parseMoney(price, p.price))
+                            {
+                                statusMessage = "❌ Enter a price like 12.99";
+                                statusColor = ImVec4(1, 0, 0, 1);
+                            }
+                            else if (addProduct(p))
+                            {
+                                statusMessage = "✅ Product added!";
+                                statusColor = ImVec4(0, 1, 0, 1);
+                                // Reset inputs
+                                name[0] = '\0';
+                                quantity = 0;
+                                price[0] = '\0';
+                                reorderLevel = 0;
+                                sku[0] = '\0';
+                            }
+                            else
+                            {
+                                statusMessage = lastWriteWasBusy()
+                                                    ? "❌ Database is busy (another terminal is writing). Please try again."
+                                                    : "❌ Failed to add product.";
+                                statusColor = ImVec4(1, 0, 0, 1);
+                            }
+                        }
+
+                        ImGui::EndTabItem();
+                    }
 
-    ImGui::Text("🗑️ Delete Product");
-    ImGui::Separator();
-    ImGui::Spacing();
+                    if (ImGui::BeginTabItem("✏️ Update Product"))
+                    {
+                        renderUpdateProduct();
+                        ImGui::EndTabItem();
+                    }
 
-    ImGui::Text("Enter Product ID or Name:");
-    ImGui::PushItemWidth(-1); // full-width input
-    ImGui::InputText("##DeleteInput", inputSearch, IM_ARRAYSIZE(inputSearch));
-    ImGui::PopItemWidth();
+                    if (ImGui::BeginTabItem("❌ Delete Product"))
+                    {
+                        renderDeleteProduct();
+                        ImGui::EndTabItem();
+                    }
 
-    productLoaded = false;
+                    ImGui::EndTabBar();
+                }
+            }
+            ImGui::End();
+        }
 
-    if (strlen(inputSearch) > 0)
-    {
-        std::vector<Product> results = searchProducts(inputSearch);
-        if (!results.empty())
+        if (panels.search)
         {
-            productToDelete = results[0];
-            productLoaded = true;
+            ImGui::SetNextWindowPos(ImVec2(0, top + bodyHeight * 0.6f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(left, bodyHeight * 0.4f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("🔍 Search", &panels.search))
+                renderSearchProduct();
+            ImGui::End();
         }
-    }
-
-    ImGui::Spacing();
 
-    if (!productLoaded && strlen(inputSearch) > 0)
-    {
-        ImGui::TextColored(ImVec4(1, 0, 0, 1), "⚠️ No product found with ID or Name '%s'", inputSearch);
-    }
-    else if (productLoaded)
-    {
-        ImGui::Text("Product to delete:");
-        ImGui::BulletText("ID: %d", productToDelete.id);
-        ImGui::BulletText("Name: %s", productToDelete.name.c_str());
-        ImGui::BulletText("Quantity: %d", productToDelete.quantity);
-        ImGui::BulletText("Price: %.2f", productToDelete.price);
-    }
-
-    ImGui::Spacing();
-
-    bool canDelete = productLoaded;
-
-    // 🔴 Styled delete button
-    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.85f, 0.25f, 0.25f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.95f, 0.4f, 0.4f, 1.0f));
-    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.75f, 0.2f, 0.2f, 1.0f));
-
-    if (ImGui::Button("🗑️ Delete Product", ImVec2(180, 40)) && canDelete)
-    {
-        showConfirmDialog = true;
-        deleteSuccess = false;
-        deleteFailed = false;
-    }
+        if (panels.products)
+        {
+            ImGui::SetNextWindowPos(ImVec2(left, top), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w - left, bodyHeight * 0.55f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("📋 Products", &panels.products))
+                renderProductList();
+            ImGui::End();
+        }
 
-    ImGui::PopStyleColor(3);
+        if (panels.dashboard)
+        {
+            ImGui::SetNextWindowPos(ImVec2(left, top + bodyHeight * 0.55f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2((w - left) * 0.4f, bodyHeight * 0.45f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("📊 Dashboard", &panels.dashboard))
+                renderDashboard();
+            ImGui::End();
+        }
 
-    if (showConfirmDialog)
-    {
-        ImGui::OpenPopup("Confirm Deletion");
-    }
+        if (panels.alerts)
+        {
+            // "###" keeps the window ID stable while the count in the title changes
+            std::string alertsTitle = "⚠️ Alerts (" + std::to_string(getStockAlerts().size()) + ")###Alerts";
+            ImGui::SetNextWindowPos(ImVec2(left + (w - left) * 0.4f, top + bodyHeight * 0.55f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2((w - left) * 0.6f, bodyHeight * 0.45f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin(alertsTitle.c_str(), &panels.alerts))
+                renderAlerts();
+            ImGui::End();
+        }
 
-    // 🔒 Confirmation Popup
-    if (ImGui::BeginPopupModal("Confirm Deletion", NULL, ImGuiWindowFlags_AlwaysAutoResize))
-    {
-        ImGui::Text("Are you sure you want to delete this product?\n\n");
-        ImGui::BulletText("ID: %d", productToDelete.id);
-        ImGui::BulletText("Name: %s", productToDelete.name.c_str());
-        ImGui::BulletText("Quantity: %d", productToDelete.quantity);
-        ImGui::BulletText("Price: %.2f", productToDelete.price);
+        if (panels.history)
+        {
+            ImGui::SetNextWindowPos(ImVec2(w * 0.2f, top + bodyHeight * 0.15f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w * 0.6f, bodyHeight * 0.7f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("🕘 History", &panels.history))
+                renderHistory();
+            ImGui::End();
+        }
 
-        ImGui::Separator();
+        if (panels.charts)
+        {
+            ImGui::SetNextWindowPos(ImVec2(w * 0.15f, top + bodyHeight * 0.1f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w * 0.7f, bodyHeight * 0.6f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("📈 Charts", &panels.charts))
+                renderCharts();
+            ImGui::End();
+        }
 
-        // 🔴 Confirm Button
-        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.85f, 0.25f, 0.25f, 1.0f));
-        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.95f, 0.4f, 0.4f, 1.0f));
-        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.75f, 0.2f, 0.2f, 1.0f));
+        if (panels.slowQueries)
+        {
+            ImGui::SetNextWindowPos(ImVec2(w * 0.1f, top + bodyHeight * 0.2f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w * 0.8f, bodyHeight * 0.6f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("⏱ Slow Queries", &panels.slowQueries))
+                renderSlowQueries();
+            ImGui::End();
+        }
 
-        if (ImGui::Button("Yes, Delete", ImVec2(140, 35)))
+        if (panels.locations)
         {
-            if (deleteProduct(productToDelete.id))
-            {
-                deleteSuccess = true;
-                deleteFailed = false;
-                memset(inputSearch, 0, sizeof(inputSearch));
-                productLoaded = false;
-                productToDelete = {0, "", 0, 0.0};
-            }
-            else
-            {
-                deleteSuccess = false;
-                deleteFailed = true;
-            }
-            showConfirmDialog = false;
-            ImGui::CloseCurrentPopup();
+            ImGui::SetNextWindowPos(ImVec2(w * 0.15f, top + bodyHeight * 0.15f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w * 0.7f, bodyHeight * 0.7f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("📦 Locations", &panels.locations))
+                renderLocations();
+            ImGui::End();
         }
 
-        ImGui::PopStyleColor(3);
+        if (panels.categories)
+        {
+            ImGui::SetNextWindowPos(ImVec2(w * 0.2f, top + bodyHeight * 0.1f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w * 0.6f, bodyHeight * 0.8f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("📁 Categories", &panels.categories))
+                renderCategories();
+            ImGui::End();
+        }
 
-        ImGui::SameLine();
+        if (panels.lots)
+        {
+            ImGui::SetNextWindowPos(ImVec2(w * 0.2f, top + bodyHeight * 0.15f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w * 0.6f, bodyHeight * 0.7f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("🕘 Lots", &panels.lots))
+                renderLots();
+            ImGui::End();
+        }
 
-        // 🟤 Cancel Button (gray)
-        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.5f, 0.5f, 0.5f, 1.0f));
-        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.6f, 0.6f, 0.6f, 1.0f));
-        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.4f, 0.4f, 0.4f, 1.0f));
+        // Leaving scan mode on with no panel to show it would swallow the keyboard
+        if (!panels.scanner && isScanMode())
+            setScanMode(false);
 
-        if (ImGui::Button("Cancel", ImVec2(140, 35)))
+        if (panels.scanner)
         {
-            showConfirmDialog = false;
-            ImGui::CloseCurrentPopup();
+            ImGui::SetNextWindowPos(ImVec2(w * 0.25f, top + bodyHeight * 0.2f), ImGuiCond_FirstUseEver);
+            ImGui::SetNextWindowSize(ImVec2(w * 0.5f, bodyHeight * 0.6f), ImGuiCond_FirstUseEver);
+            if (ImGui::Begin("🏷️ Scanner", &panels.scanner))
+                renderScanner();
+            ImGui::End();
         }
 
-        ImGui::PopStyleColor(3);
-
-        ImGui::EndPopup();
+        // Render
+        ImGui::Render();
+        glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        if (isReplaying())
+        {
+            // Wait for the GPU so the frame time includes drawing, not just submitting
+            glFinish();
+            addFrameTiming(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count(),
+                           (int)frameEvents.size());
+        }
+        SDL_GL_SwapWindow(window);
     }
 
-    ImGui::Spacing();
-
-    if (deleteSuccess)
-    {
-        ImGui::TextColored(ImVec4(0, 1, 0, 1), "✅ Product deleted successfully!");
-    }
-    else if (deleteFailed)
+    stopRecording();
+    if (isReplaying())
     {
-        ImGui::TextColored(ImVec4(1, 0, 0, 1), "❌ Deletion failed. Please try again.");
+        closeReplay();
+        reportFrameTimings(options.reportPath);
     }
 
-    ImGui::EndGroup();
+    // Cleanup
+    saveFontCache();
+    shutdownBusyOverlay();
+    shutdownPanels();
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplSDL2_Shutdown();
+    ImGui::DestroyContext();
+    SDL_GL_DeleteContext(gl_context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
 }
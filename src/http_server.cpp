@@ -0,0 +1,1421 @@
+#include "http_server.hpp"
+#include "db.hpp"
+#include "schema.hpp"
+#include "undo.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Idle keep-alive connections are closed after this long
+static const int idleTimeoutSeconds = 5;
+// Requests larger than this are rejected
+static const size_t maxRequestBytes = 1 << 20;
+// Deeper JSON is rejected before the recursive reader can exhaust the stack
+static const int maxJSONDepth = 64;
+
+static std::atomic<bool> stopRequested(false);
+
+static void onStopSignal(int)
+{
+    stopRequested = true;
+}
+
+// ---------------------------------------------------------------------------
+// Minimal JSON reader for request bodies (objects, arrays, strings, numbers)
+
+struct JsonValue
+{
+    enum Type { Null, Number, String, Object, Array } type = Null;
+    double number = 0.0;
+    std::string string;
+    std::vector<std::pair<std::string, JsonValue>> members;
+    std::vector<JsonValue> items;
+
+    const JsonValue *get(const char *key) const
+    {
+        for (const auto &member : members)
+            if (member.first == key)
+                return &member.second;
+        return nullptr;
+    }
+};
+
+static void skipSpace(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+        ++p;
+}
+
+static bool parseJSONString(const char *&p, const char *end, std::string &out)
+{
+    if (p >= end || *p != '"')
+        return false;
+    ++p;
+
+    while (p < end && *p != '"')
+    {
+        if (*p == '\\' && p + 1 < end)
+        {
+            ++p;
+            switch (*p)
+            {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'u':
+            {
+                if (end - p < 5)
+                    return false;
+                unsigned code = (unsigned)std::strtoul(std::string(p + 1, 4).c_str(), nullptr, 16);
+                p += 4;
+                // Encode as UTF-8 (BMP only)
+                if (code < 0x80)
+                    out += (char)code;
+                else if (code < 0x800)
+                {
+                    out += (char)(0xC0 | (code >> 6));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    out += (char)(0xE0 | (code >> 12));
+                    out += (char)(0x80 | ((code >> 6) & 0x3F));
+                    out += (char)(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += *p; break;
+            }
+            ++p;
+        }
+        else
+        {
+            out += *p++;
+        }
+    }
+
+    if (p >= end)
+        return false;
+    ++p;
+    return true;
+}
+
+static bool parseJSON(const char *&p, const char *end, JsonValue &out, int depth = 0)
+{
+    skipSpace(p, end);
+    if (p >= end || depth > maxJSONDepth)
+        return false;
+
+    if (*p == '{')
+    {
+        out.type = JsonValue::Object;
+        ++p;
+        skipSpace(p, end);
+        if (p < end && *p == '}')
+            return ++p, true;
+
+        while (true)
+        {
+            std::string key;
+            JsonValue value;
+            skipSpace(p, end);
+            if (!parseJSONString(p, end, key))
+                return false;
+            skipSpace(p, end);
+            if (p >= end || *p++ != ':')
+                return false;
+            if (!parseJSON(p, end, value, depth + 1))
+                return false;
+            out.members.emplace_back(std::move(key), std::move(value));
+
+            skipSpace(p, end);
+            if (p < end && *p == ',')
+                ++p;
+            else if (p < end && *p == '}')
+                return ++p, true;
+            else
+                return false;
+        }
+    }
+
+    if (*p == '[')
+    {
+        out.type = JsonValue::Array;
+        ++p;
+        skipSpace(p, end);
+        if (p < end && *p == ']')
+            return ++p, true;
+
+        while (true)
+        {
+            JsonValue value;
+            if (!parseJSON(p, end, value, depth + 1))
+                return false;
+            out.items.push_back(std::move(value));
+
+            skipSpace(p, end);
+            if (p < end && *p == ',')
+                ++p;
+            else if (p < end && *p == ']')
+                return ++p, true;
+            else
+                return false;
+        }
+    }
+
+    if (*p == '"')
+    {
+        out.type = JsonValue::String;
+        return parseJSONString(p, end, out.string);
+    }
+
+    if (end - p >= 4 && std::strncmp(p, "null", 4) == 0)
+    {
+        p += 4;
+        return true;
+    }
+
+    std::string number;
+    while (p < end && (std::isdigit((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E'))
+        number += *p++;
+    if (number.empty())
+        return false;
+
+    out.type = JsonValue::Number;
+    out.number = std::strtod(number.c_str(), nullptr);
+    return true;
+}
+
+static bool parseJSONBody(const std::string &body, JsonValue &out)
+{
+    const char *p = body.data();
+    return parseJSON(p, body.data() + body.size(), out);
+}
+
+// A JSON number that is a whole value in int range; anything else (strings,
+// fractions, 1e300) is a bad request rather than a silently wrapped int
+static bool readInt(const JsonValue *value, int &out)
+{
+    if (!value || value->type != JsonValue::Number || !std::isfinite(value->number) ||
+        value->number != std::floor(value->number) || value->number < INT_MIN || value->number > INT_MAX)
+        return false;
+    out = (int)value->number;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// JSON output
+
+static void appendJSONString(std::string &out, const std::string &value)
+{
+    out += '"';
+    for (unsigned char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += (char)c;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+static void appendJSON(std::string &out, const Product &p)
+{
+    char numbers[128];
+    out += "{\"id\":" + std::to_string(p.id) + ",\"name\":";
+    appendJSONString(out, p.name);
+    std::snprintf(numbers, sizeof(numbers), ",\"quantity\":%d,\"price\":", p.quantity);
+    out += numbers;
+    out += formatMoney(p.price);
+    std::snprintf(numbers, sizeof(numbers), ",\"reorder_level\":%d,\"sku\":", p.reorderLevel);
+    out += numbers;
+    appendJSONString(out, p.sku);
+    out += ",\"version\":" + std::to_string(p.version) + '}';
+}
+
+// Fill the writable product fields present in a JSON object
+static bool readProduct(const JsonValue &body, Product &p, bool requireAll)
+{
+    if (body.type != JsonValue::Object)
+        return false;
+
+    const JsonValue *name = body.get("name");
+    const JsonValue *quantity = body.get("quantity");
+    const JsonValue *price = body.get("price");
+    const JsonValue *reorderLevel = body.get("reorder_level");
+    const JsonValue *sku = body.get("sku");
+
+    if (requireAll && (!name || !quantity || !price))
+        return false;
+
+    if (name)
+    {
+        if (name->type != JsonValue::String || name->string.empty())
+            return false;
+        p.name = name->string;
+    }
+    if (quantity && !readInt(quantity, p.quantity))
+        return false;
+    if (price && (price->type != JsonValue::Number || !Money::fromDouble(price->number, p.price)))
+        return false;
+    if (reorderLevel && !readInt(reorderLevel, p.reorderLevel))
+        return false;
+    if (sku)
+    {
+        if (sku->type != JsonValue::String)
+            return false;
+        p.sku = sku->string;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Read-only connection pool. Every connection keeps its own prepared
+// statements, so a request only binds and steps.
+
+const std::vector<PooledStatement> &readPoolStatements()
+{
+    static const std::vector<PooledStatement> statements = {
+        {"byId", selectSQL<Product>("WHERE id = ?")},
+        {"all", selectSQL<Product>()},
+        {"search", selectSQL<Product>("WHERE name LIKE ?")},
+        {"lowStock", selectSQL<Product>("WHERE quantity < reorder_level")},
+        {"summary", inventorySummarySQL},
+    };
+    return statements;
+}
+
+struct ReadConnection
+{
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *byId = nullptr;
+    sqlite3_stmt *all = nullptr;
+    sqlite3_stmt *search = nullptr;
+    sqlite3_stmt *lowStock = nullptr;
+    sqlite3_stmt *summary = nullptr;
+};
+
+class ReadPool
+{
+public:
+    bool open(const std::string &path, int size)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            ReadConnection *conn = new ReadConnection();
+            connections.push_back(conn);
+
+            // In readPoolStatements() order
+            sqlite3_stmt **targets[] = {&conn->byId, &conn->all, &conn->search, &conn->lowStock, &conn->summary};
+            bool ok = sqlite3_open_v2(path.c_str(), &conn->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) == SQLITE_OK;
+            for (size_t s = 0; ok && s < readPoolStatements().size(); ++s)
+                ok = prepare(conn->db, readPoolStatements()[s].sql, targets[s]);
+            if (!ok)
+            {
+                std::cerr << "Failed to open read connection: " << sqlite3_errmsg(conn->db) << std::endl;
+                return false;
+            }
+
+            sqlite3_busy_timeout(conn->db, 1000);
+            idle.push_back(conn);
+        }
+        return true;
+    }
+
+    void close()
+    {
+        for (ReadConnection *conn : connections)
+        {
+            for (sqlite3_stmt *stmt : {conn->byId, conn->all, conn->search, conn->lowStock, conn->summary})
+                sqlite3_finalize(stmt);
+            sqlite3_close(conn->db);
+            delete conn;
+        }
+        connections.clear();
+        idle.clear();
+    }
+
+    ReadConnection *acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this]
+                       { return !idle.empty(); });
+        ReadConnection *conn = idle.back();
+        idle.pop_back();
+        return conn;
+    }
+
+    void release(ReadConnection *conn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(conn);
+        }
+        available.notify_one();
+    }
+
+private:
+    static bool prepare(sqlite3 *db, const std::string &sql, sqlite3_stmt **stmt)
+    {
+        return sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, stmt, nullptr) == SQLITE_OK;
+    }
+
+    std::vector<ReadConnection *> connections;
+    std::vector<ReadConnection *> idle;
+    std::mutex mutex;
+    std::condition_variable available;
+};
+
+// Borrow a pooled connection for the duration of one request
+class ReadLease
+{
+public:
+    explicit ReadLease(ReadPool &pool) : pool(pool), conn(pool.acquire()) {}
+    ~ReadLease() { pool.release(conn); }
+    ReadConnection *operator->() const { return conn; }
+
+private:
+    ReadPool &pool;
+    ReadConnection *conn;
+};
+
+// Step a pooled statement to completion, appending each row as JSON
+static void appendRows(std::string &out, sqlite3_stmt *stmt, bool asArray)
+{
+    Product p = noProduct;
+    bool first = true;
+
+    if (asArray)
+        out += '[';
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        readRowInto(stmt, p);
+        if (!first)
+            out += ',';
+        appendJSON(out, p);
+        first = false;
+    }
+    if (asArray)
+        out += ']';
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
+// ---------------------------------------------------------------------------
+// Request handling
+
+struct HttpRequest
+{
+    std::string method;
+    std::string path;
+    std::string query;
+    std::string body;
+    std::string contentType; // header values, lower-cased; empty when absent
+    std::string origin;
+    std::string host;
+    bool keepAlive = true;
+};
+
+struct HttpResponse
+{
+    int status = 200;
+    std::string body;
+};
+
+static const char *statusText(int status)
+{
+    switch (status)
+    {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    default: return "Internal Server Error";
+    }
+}
+
+static HttpResponse errorResponse(int status, const char *message)
+{
+    HttpResponse response;
+    response.status = status;
+    response.body = "{\"error\":";
+    appendJSONString(response.body, message);
+    response.body += '}';
+    return response;
+}
+
+static std::string queryParam(const std::string &query, const char *key)
+{
+    std::string prefix = std::string(key) + "=";
+    size_t start = 0;
+    while (start < query.size())
+    {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos)
+            end = query.size();
+        if (query.compare(start, prefix.size(), prefix) == 0)
+        {
+            // Decode %XX and '+'
+            std::string value;
+            for (size_t i = start + prefix.size(); i < end; ++i)
+            {
+                if (query[i] == '+')
+                    value += ' ';
+                else if (query[i] == '%' && i + 2 < end)
+                {
+                    value += (char)std::strtol(query.substr(i + 1, 2).c_str(), nullptr, 16);
+                    i += 2;
+                }
+                else
+                    value += query[i];
+            }
+            return value;
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
+// A product ID in a path or ?ids= list: digits only, 1..INT_MAX, so
+// "12abc" or "" is a bad request rather than product 12 or 0
+static bool parseId(const std::string &text, int &out)
+{
+    if (text.empty() || text.size() > 10 || text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    long long value = std::stoll(text);
+    if (value < 1 || value > INT_MAX)
+        return false;
+    out = (int)value;
+    return true;
+}
+
+// "localhost" or "127.0.0.1", with or without a port
+static bool isLocalHost(const std::string &authority)
+{
+    size_t colon = authority.find(':');
+    std::string host = authority.substr(0, colon);
+    if (colon != std::string::npos &&
+        (colon + 1 == authority.size() ||
+         authority.find_first_not_of("0123456789", colon + 1) != std::string::npos))
+        return false;
+    return host == "localhost" || host == "127.0.0.1";
+}
+
+static bool isLocalOrigin(const std::string &origin)
+{
+    return origin.compare(0, 7, "http://") == 0 && isLocalHost(origin.substr(7));
+}
+
+static bool isJSONContentType(const std::string &contentType)
+{
+    static const std::string json = "application/json";
+    return contentType.compare(0, json.size(), json) == 0 &&
+           (contentType.size() == json.size() || contentType[json.size()] == ';' || contentType[json.size()] == ' ');
+}
+
+// The server only listens on loopback, but a browser will still send a
+// page's requests there. A form or fetch from any site can POST text/plain
+// without a preflight, and a DNS-rebound name reaches 127.0.0.1 under a
+// foreign Host. Such requests are refused before they are routed.
+static const char *rejectForeignRequest(const HttpRequest &request, int &status)
+{
+    status = 403;
+    if (!request.host.empty() && !isLocalHost(request.host))
+        return "Host must be localhost or 127.0.0.1";
+    if (!request.origin.empty() && !isLocalOrigin(request.origin))
+        return "cross-origin requests are not accepted";
+    status = 415;
+    if ((request.method == "POST" || request.method == "PUT" || !request.body.empty()) &&
+        !isJSONContentType(request.contentType))
+        return "Content-Type must be application/json";
+    return nullptr;
+}
+
+class ApiHandler
+{
+public:
+    explicit ApiHandler(ReadPool &pool) : pool(pool) {}
+
+    HttpResponse handle(const HttpRequest &request)
+    {
+        int status;
+        if (const char *reason = rejectForeignRequest(request, status))
+            return errorResponse(status, reason);
+
+        // Split "/products/12/adjust" into segments
+        std::vector<std::string> parts;
+        size_t start = 1;
+        while (start <= request.path.size())
+        {
+            size_t end = request.path.find('/', start);
+            if (end == std::string::npos)
+                end = request.path.size();
+            if (end > start)
+                parts.push_back(request.path.substr(start, end - start));
+            start = end + 1;
+        }
+
+        if (parts.empty())
+            return errorResponse(404, "not found");
+
+        if (parts[0] == "products")
+        {
+            if (parts.size() == 1)
+            {
+                if (request.method == "GET")
+                    return listProducts(request);
+                if (request.method == "POST")
+                    return createProduct(request);
+                return errorResponse(405, "method not allowed");
+            }
+
+            int id;
+            if (!parseId(parts[1], id))
+                return errorResponse(400, "invalid product id");
+
+            if (parts.size() == 2)
+            {
+                if (request.method == "GET")
+                    return getProduct(id);
+                if (request.method == "PUT")
+                    return replaceProduct(id, request);
+                if (request.method == "DELETE")
+                    return removeProduct(id);
+                return errorResponse(405, "method not allowed");
+            }
+
+            if (parts.size() == 3 && parts[2] == "adjust" && request.method == "POST")
+                return adjustOne(id, request);
+        }
+        else if (parts[0] == "batch" && parts.size() == 2 && parts[1] == "adjust" && request.method == "POST")
+        {
+            return adjustBatch(request);
+        }
+        else if (parts[0] == "alerts" && request.method == "GET")
+        {
+            HttpResponse response;
+            ReadLease conn(pool);
+            appendRows(response.body, conn->lowStock, true);
+            return response;
+        }
+        else if (parts[0] == "stats" && request.method == "GET")
+        {
+            return stats();
+        }
+
+        return errorResponse(404, "not found");
+    }
+
+private:
+    HttpResponse listProducts(const HttpRequest &request)
+    {
+        HttpResponse response;
+        std::string keyword = queryParam(request.query, "q");
+        std::string ids = queryParam(request.query, "ids");
+
+        std::vector<int> idList;
+        for (size_t start = 0; start < ids.size();)
+        {
+            size_t end = ids.find(',', start);
+            if (end == std::string::npos)
+                end = ids.size();
+            int id;
+            if (!parseId(ids.substr(start, end - start), id))
+                return errorResponse(400, "ids must be a comma-separated list of product ids");
+            idList.push_back(id);
+            start = end + 1;
+        }
+
+        ReadLease conn(pool);
+        if (!idList.empty())
+        {
+            // Batch fetch: one prepared statement, stepped once per id
+            response.body += '[';
+            bool first = true;
+            for (int id : idList)
+            {
+                sqlite3_bind_int(conn->byId, 1, id);
+                std::string row;
+                appendRows(row, conn->byId, false);
+                if (!row.empty())
+                {
+                    if (!first)
+                        response.body += ',';
+                    response.body += row;
+                    first = false;
+                }
+            }
+            response.body += ']';
+        }
+        else if (!keyword.empty())
+        {
+            std::string pattern = "%" + keyword + "%";
+            sqlite3_bind_text(conn->search, 1, pattern.c_str(), -1, SQLITE_TRANSIENT);
+            appendRows(response.body, conn->search, true);
+        }
+        else
+        {
+            appendRows(response.body, conn->all, true);
+        }
+        return response;
+    }
+
+    HttpResponse getProduct(int id)
+    {
+        HttpResponse response;
+        {
+            ReadLease conn(pool);
+            sqlite3_bind_int(conn->byId, 1, id);
+            appendRows(response.body, conn->byId, false);
+        }
+        if (response.body.empty())
+            return errorResponse(404, "product not found");
+        return response;
+    }
+
+    HttpResponse stats()
+    {
+        HttpResponse response;
+        ReadLease conn(pool);
+        if (sqlite3_step(conn->summary) == SQLITE_ROW)
+        {
+            char body[160];
+            std::snprintf(body, sizeof(body), "{\"products\":%d,\"units\":%lld,\"value\":%s}",
+                          sqlite3_column_int(conn->summary, 0),
+                          (long long)sqlite3_column_int64(conn->summary, 1),
+                          formatMoney(inventoryValue(sqlite3_column_int64(conn->summary, 2),
+                                                     sqlite3_column_int64(conn->summary, 3)))
+                              .c_str());
+            response.body = body;
+        }
+        sqlite3_reset(conn->summary);
+        return response;
+    }
+
+    HttpResponse createProduct(const HttpRequest &request)
+    {
+        JsonValue body;
+        Product p = noProduct;
+        if (!parseJSONBody(request.body, body) || !readProduct(body, p, true))
+            return errorResponse(400, "expected {name, quantity, price[, reorder_level, sku]}");
+
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (!addProduct(p))
+            return errorResponse(500, "insert failed");
+
+        HttpResponse response;
+        response.status = 201;
+        appendJSON(response.body, getProductById(lastInsertedProductId()));
+        return response;
+    }
+
+    HttpResponse replaceProduct(int id, const HttpRequest &request)
+    {
+        JsonValue body;
+        std::lock_guard<std::mutex> lock(writeMutex);
+
+        Product p = getProductById(id);
+        if (p.id < 0)
+            return errorResponse(404, "product not found");
+        if (!parseJSONBody(request.body, body) || !readProduct(body, p, false))
+            return errorResponse(400, "invalid product body");
+
+        // With the version the client read, the write only lands if nobody
+        // changed the product since; without one the last writer wins
+        HttpResponse response;
+        const JsonValue *version = body.get("version");
+        if (version)
+        {
+            if (!readInt(version, p.version))
+                return errorResponse(400, "version must be an integer");
+            Product current;
+            switch (updateProductIfUnchanged(p, current))
+            {
+            case UpdateResult::Updated:
+                break;
+            case UpdateResult::Conflict:
+                response.status = 409;
+                appendJSON(response.body, current);
+                return response;
+            case UpdateResult::NotFound:
+                return errorResponse(404, "product not found");
+            case UpdateResult::Failed:
+                return errorResponse(500, "update failed");
+            }
+            appendJSON(response.body, current);
+            return response;
+        }
+
+        if (!updateProduct(p))
+            return errorResponse(500, "update failed");
+        appendJSON(response.body, getProductById(id));
+        return response;
+    }
+
+    HttpResponse removeProduct(int id)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (getProductById(id).id < 0)
+            return errorResponse(404, "product not found");
+        if (!deleteProduct(id))
+            return errorResponse(500, "delete failed");
+
+        HttpResponse response;
+        response.body = "{\"deleted\":" + std::to_string(id) + "}";
+        return response;
+    }
+
+    HttpResponse adjustOne(int id, const HttpRequest &request)
+    {
+        JsonValue body;
+        int delta;
+        if (!parseJSONBody(request.body, body) || !readInt(body.get("delta"), delta))
+            return errorResponse(400, "expected {delta}");
+
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (getProductById(id).id < 0)
+            return errorResponse(404, "product not found");
+        if (!adjustQuantity(id, delta))
+            return errorResponse(409, "quantity would drop below zero");
+
+        HttpResponse response;
+        appendJSON(response.body, getProductById(id));
+        return response;
+    }
+
+    HttpResponse adjustBatch(const HttpRequest &request)
+    {
+        JsonValue body;
+        if (!parseJSONBody(request.body, body) || body.type != JsonValue::Array)
+            return errorResponse(400, "expected [{id, delta}, ...]");
+
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (!beginTransaction())
+            return errorResponse(500, "cannot start transaction");
+
+        beginUndoGroup("batch adjust of " + std::to_string(body.items.size()) + " products");
+        for (const JsonValue &item : body.items)
+        {
+            int id, delta;
+            if (!readInt(item.get("id"), id) || !readInt(item.get("delta"), delta) || !adjustQuantity(id, delta))
+            {
+                // All or nothing
+                cancelUndoGroup();
+                rollbackTransaction();
+                return errorResponse(400, "unknown product, malformed item or quantity below zero; nothing applied");
+            }
+        }
+        // Observers only see the changes at COMMIT, so the group closes after it
+        if (!commitTransaction())
+        {
+            cancelUndoGroup();
+            rollbackTransaction();
+            return errorResponse(500, "commit failed");
+        }
+        endUndoGroup();
+
+        HttpResponse response;
+        response.body = "{\"applied\":" + std::to_string(body.items.size()) + "}";
+        return response;
+    }
+
+    ReadPool &pool;
+    std::mutex writeMutex; // db.hpp uses one shared connection
+};
+
+// ---------------------------------------------------------------------------
+// Connection handling
+
+static std::string headerValue(const std::string &headers, const char *name)
+{
+    std::string lower = headers;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+    std::string key = std::string("\r\n") + name + ":";
+    size_t pos = lower.find(key);
+    if (pos == std::string::npos)
+        return "";
+
+    size_t start = pos + key.size();
+    size_t end = lower.find("\r\n", start);
+    std::string value = lower.substr(start, end - start);
+    value.erase(0, value.find_first_not_of(' '));
+    return value;
+}
+
+static void appendResponse(std::string &out, const HttpResponse &response, bool keepAlive)
+{
+    char head[256];
+    std::snprintf(head, sizeof(head),
+                  "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+                  response.status, statusText(response.status), response.body.size(),
+                  keepAlive ? "keep-alive" : "close");
+    out += head;
+    out += response.body;
+}
+
+// Handle every complete request in `buffer` (pipelining), appending the
+// responses to `out` in order. Returns false once the connection must close.
+static bool processRequests(std::string &buffer, std::string &out, ApiHandler &api)
+{
+    while (true)
+    {
+        size_t headerEnd = buffer.find("\r\n\r\n");
+        if (headerEnd == std::string::npos)
+        {
+            if (buffer.size() > maxRequestBytes)
+            {
+                appendResponse(out, errorResponse(413, "request too large"), false);
+                return false;
+            }
+            return true;
+        }
+
+        std::string head = buffer.substr(0, headerEnd + 2);
+        size_t contentLength = (size_t)std::strtoull(headerValue(head, "content-length").c_str(), nullptr, 10);
+        if (contentLength > maxRequestBytes)
+        {
+            appendResponse(out, errorResponse(413, "request too large"), false);
+            return false;
+        }
+        if (buffer.size() < headerEnd + 4 + contentLength)
+            return true; // body still arriving
+
+        HttpRequest request;
+        size_t lineEnd = head.find("\r\n");
+        std::string requestLine = head.substr(0, lineEnd);
+        size_t sp1 = requestLine.find(' ');
+        size_t sp2 = requestLine.rfind(' ');
+        if (sp1 == std::string::npos || sp2 == sp1)
+        {
+            appendResponse(out, errorResponse(400, "malformed request line"), false);
+            return false;
+        }
+
+        request.method = requestLine.substr(0, sp1);
+        std::string target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::string version = requestLine.substr(sp2 + 1);
+        size_t question = target.find('?');
+        request.path = target.substr(0, question);
+        if (question != std::string::npos)
+            request.query = target.substr(question + 1);
+        request.body = buffer.substr(headerEnd + 4, contentLength);
+
+        request.contentType = headerValue(head, "content-type");
+        request.origin = headerValue(head, "origin");
+        request.host = headerValue(head, "host");
+
+        std::string connection = headerValue(head, "connection");
+        request.keepAlive = version == "HTTP/1.0" ? connection == "keep-alive" : connection != "close";
+
+        buffer.erase(0, headerEnd + 4 + contentLength);
+
+        appendResponse(out, api.handle(request), request.keepAlive);
+        if (!request.keepAlive)
+            return false;
+    }
+}
+
+static bool sendAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, 0);
+        if (n <= 0)
+            return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+// A client connection. Between requests it is parked in the accept loop's
+// poll set; a worker only takes it once it has something to read, so idle
+// keep-alive clients never hold a worker.
+struct ClientConnection
+{
+    int fd;
+    std::string buffer; // start of a request still arriving
+    Clock::time_point lastActivity;
+};
+
+// Read what arrived and answer every complete request in it. Returns false
+// once the connection must close.
+static bool serviceConnection(ClientConnection &conn, ApiHandler &api)
+{
+    char chunk[65536];
+    ssize_t n = recv(conn.fd, chunk, sizeof(chunk), 0);
+    if (n <= 0)
+        return false;
+    conn.lastActivity = Clock::now();
+    conn.buffer.append(chunk, (size_t)n);
+
+    // All responses for the requests in this read go out in one send
+    std::string out;
+    bool keepOpen = processRequests(conn.buffer, out, api);
+    return (out.empty() || sendAll(conn.fd, out)) && keepOpen;
+}
+
+static void closeConnection(ClientConnection *conn)
+{
+    close(conn->fd);
+    delete conn;
+}
+
+int runHttpServer(const HttpServerOptions &options)
+{
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    stopRequested = false;
+
+    // Otherwise the file keeps its journal mode: pooled readers then wait
+    // (up to their busy timeout) while the main connection commits
+    if (options.wal)
+    {
+        sqlite3 *setup;
+        char *errMsg = nullptr;
+        if (sqlite3_open(options.dbPath.c_str(), &setup) != SQLITE_OK ||
+            sqlite3_exec(setup, "PRAGMA journal_mode=WAL;", nullptr, nullptr, &errMsg) != SQLITE_OK)
+        {
+            std::cerr << "Cannot switch " << options.dbPath << " to WAL: "
+                      << (errMsg ? errMsg : sqlite3_errmsg(setup)) << std::endl;
+            sqlite3_free(errMsg);
+            sqlite3_close(setup);
+            return 1;
+        }
+        sqlite3_close(setup);
+    }
+
+    ReadPool pool;
+    if (!pool.open(options.dbPath, std::max(1, options.readConnections)))
+    {
+        pool.close();
+        return 1;
+    }
+    ApiHandler api(pool);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)options.port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // never exposed beyond this machine
+
+    if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 128) != 0)
+    {
+        std::cerr << "Cannot listen on 127.0.0.1:" << options.port << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0)
+            close(listener);
+        pool.close();
+        return 1;
+    }
+
+    // Readable connections wait in `ready` for a worker; served ones come
+    // back through `returned`, and the pipe wakes the poll loop for them
+    int wake[2];
+    if (pipe(wake) != 0)
+    {
+        std::cerr << "Cannot create wake pipe: " << std::strerror(errno) << std::endl;
+        close(listener);
+        pool.close();
+        return 1;
+    }
+    fcntl(wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake[1], F_SETFL, O_NONBLOCK);
+
+    std::vector<ClientConnection *> parked;
+    std::deque<ClientConnection *> ready;
+    std::vector<ClientConnection *> returned;
+    std::mutex queueMutex;
+    std::condition_variable readyToServe;
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < std::max(1, options.threads); ++i)
+    {
+        workers.emplace_back([&]
+                             {
+            while (true)
+            {
+                ClientConnection *conn;
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    readyToServe.wait(lock, [&]
+                                      { return !ready.empty() || stopRequested; });
+                    if (ready.empty())
+                        return;
+                    conn = ready.front();
+                    ready.pop_front();
+                }
+
+                if (!serviceConnection(*conn, api))
+                {
+                    closeConnection(conn);
+                    continue;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    returned.push_back(conn);
+                }
+                char byte = 0;
+                (void)!write(wake[1], &byte, 1);
+            } });
+    }
+
+    std::cerr << "Serving http://127.0.0.1:" << options.port << " with " << workers.size()
+              << " workers and " << options.readConnections << " read connections (Ctrl+C to stop)" << std::endl;
+
+    std::vector<pollfd> fds;
+    while (!stopRequested)
+    {
+        fds.assign({{wake[0], POLLIN, 0}, {listener, POLLIN, 0}});
+        for (ClientConnection *conn : parked)
+            fds.push_back({conn->fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), 200) < 0)
+            continue;
+
+        // Hand readable connections to the workers and drop long-idle ones
+        Clock::time_point now = Clock::now();
+        std::vector<ClientConnection *> stillParked;
+        bool handedOut = false;
+        for (size_t i = 0; i < parked.size(); ++i)
+        {
+            ClientConnection *conn = parked[i];
+            if (fds[i + 2].revents)
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                ready.push_back(conn);
+                handedOut = true;
+            }
+            else if (now - conn->lastActivity > std::chrono::seconds(idleTimeoutSeconds))
+                closeConnection(conn);
+            else
+                stillParked.push_back(conn);
+        }
+        parked.swap(stillParked);
+        if (handedOut)
+            readyToServe.notify_all();
+
+        if (fds[1].revents & POLLIN)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0)
+            {
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                parked.push_back(new ClientConnection{fd, std::string(), now});
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            char drain[64];
+            while (read(wake[0], drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+        std::lock_guard<std::mutex> lock(queueMutex);
+        parked.insert(parked.end(), returned.begin(), returned.end());
+        returned.clear();
+    }
+
+    readyToServe.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+    for (ClientConnection *conn : parked)
+        closeConnection(conn);
+    for (ClientConnection *conn : ready)
+        closeConnection(conn);
+    for (ClientConnection *conn : returned)
+        closeConnection(conn);
+    close(wake[0]);
+    close(wake[1]);
+
+    close(listener);
+    pool.close();
+    std::cerr << "Server stopped" << std::endl;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Self checks
+
+struct HttpCheck
+{
+    const char *name;
+    bool expected;
+    std::function<bool()> run;
+};
+
+static bool parses(const std::string &body)
+{
+    JsonValue value;
+    return parseJSONBody(body, value);
+}
+
+static bool readsInt(const char *body)
+{
+    JsonValue value;
+    int out;
+    return parseJSONBody(body, value) && readInt(value.get("n"), out);
+}
+
+static bool readsPrice(const char *body)
+{
+    JsonValue value;
+    Product p = noProduct;
+    return parseJSONBody(body, value) && readProduct(value, p, false);
+}
+
+static bool accepted(const char *method, const char *contentType, const char *origin, const char *host)
+{
+    HttpRequest request;
+    request.method = method;
+    request.body = std::string(method) == "GET" ? "" : "{}";
+    request.contentType = contentType;
+    request.origin = origin;
+    request.host = host;
+    int status;
+    return rejectForeignRequest(request, status) == nullptr;
+}
+
+int runHttpChecks()
+{
+    const std::vector<HttpCheck> checks = {
+        {"nesting at the limit", true, []
+         { return parses(std::string(maxJSONDepth + 1, '[') + std::string(maxJSONDepth + 1, ']')); }},
+        {"nesting past the limit", false, []
+         { return parses(std::string(maxJSONDepth + 2, '[') + std::string(maxJSONDepth + 2, ']')); }},
+        {"200 KB of '['", false, []
+         { return parses(std::string(200 * 1024, '[')); }},
+        {"nested objects past the limit", false, []
+         {
+             std::string body;
+             for (int i = 0; i <= maxJSONDepth + 1; ++i)
+                 body += "{\"a\":";
+             return parses(body + "1" + std::string(maxJSONDepth + 2, '}'));
+         }},
+        {"integer", true, []
+         { return readsInt("{\"n\":-3}"); }},
+        {"fraction", false, []
+         { return readsInt("{\"n\":1.5}"); }},
+        {"out of int range", false, []
+         { return readsInt("{\"n\":3000000000}"); }},
+        {"string", false, []
+         { return readsInt("{\"n\":\"3\"}"); }},
+        {"price", true, []
+         { return readsPrice("{\"price\":1234.5}"); }},
+        {"negative price", false, []
+         { return readsPrice("{\"price\":-0.01}"); }},
+        {"price past Money::maxUnits", false, []
+         { return readsPrice("{\"price\":10000000.01}"); }},
+        {"local write", true, []
+         { return accepted("POST", "application/json; charset=utf-8", "http://localhost:8080", "127.0.0.1:8080"); }},
+        {"write without an Origin", true, []
+         { return accepted("PUT", "application/json", "", "localhost"); }},
+        {"text/plain write", false, []
+         { return accepted("POST", "text/plain", "", "127.0.0.1"); }},
+        {"write without a Content-Type", false, []
+         { return accepted("POST", "", "", "127.0.0.1"); }},
+        {"cross-origin write", false, []
+         { return accepted("POST", "application/json", "http://evil.example", "127.0.0.1"); }},
+        {"look-alike origin", false, []
+         { return accepted("POST", "application/json", "http://localhost.evil.example", "127.0.0.1"); }},
+        {"opaque origin", false, []
+         { return accepted("POST", "application/json", "null", "127.0.0.1"); }},
+        {"rebound Host", false, []
+         { return accepted("GET", "", "", "evil.example:8080"); }},
+        {"path id", true, []
+         { int id; return parseId("12", id) && id == 12; }},
+        {"path id with trailing characters", false, []
+         { int id; return parseId("12abc", id); }},
+        {"empty path id", false, []
+         { int id; return parseId("", id); }},
+        {"path id past INT_MAX", false, []
+         { int id; return parseId("2147483648", id); }},
+        {"plain local read", true, []
+         { return accepted("GET", "", "", "127.0.0.1:8080"); }},
+    };
+
+    int failures = 0;
+    for (const HttpCheck &check : checks)
+    {
+        bool ok = check.run() == check.expected;
+        std::printf("%-34s %s\n", check.name, ok ? "ok" : "FAIL");
+        failures += !ok;
+    }
+    std::printf("%d of %d checks failed\n", failures, (int)checks.size());
+    return failures ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Load test client
+
+static int connectLoopback(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (fd < 0 || connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return fd;
+}
+
+// Read one complete response from the connection; returns the status or -1
+static int readResponse(int fd, std::string &buffer)
+{
+    char chunk[65536];
+    while (true)
+    {
+        size_t headerEnd = buffer.find("\r\n\r\n");
+        if (headerEnd != std::string::npos)
+        {
+            std::string head = buffer.substr(0, headerEnd + 2);
+            size_t length = (size_t)std::strtoull(headerValue(head, "content-length").c_str(), nullptr, 10);
+            if (buffer.size() >= headerEnd + 4 + length)
+            {
+                int status = std::atoi(head.c_str() + 9); // "HTTP/1.1 200"
+                buffer.erase(0, headerEnd + 4 + length);
+                return status;
+            }
+        }
+
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            return -1;
+        buffer.append(chunk, (size_t)n);
+    }
+}
+
+int runHttpLoadTest(const HttpLoadTestOptions &options)
+{
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int connections = std::max(1, options.connections);
+    int pipeline = std::max(1, options.pipeline);
+    int perConnection = std::max(1, options.requests / connections);
+    std::string request = "GET " + options.path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+
+    std::vector<std::vector<double>> latencies(connections); // microseconds
+    std::atomic<long> failures(0);
+    std::vector<std::thread> clients;
+
+    Clock::time_point start = Clock::now();
+    for (int c = 0; c < connections; ++c)
+    {
+        clients.emplace_back([&, c]
+                             {
+            int fd = connectLoopback(options.port);
+            if (fd < 0)
+            {
+                failures += perConnection;
+                return;
+            }
+
+            std::string buffer, batch;
+            latencies[c].reserve(perConnection);
+
+            for (int done = 0; done < perConnection;)
+            {
+                int inFlight = std::min(pipeline, perConnection - done);
+                batch.clear();
+                for (int i = 0; i < inFlight; ++i)
+                    batch += request;
+
+                Clock::time_point sentAt = Clock::now();
+                if (!sendAll(fd, batch))
+                {
+                    failures += perConnection - done;
+                    break;
+                }
+
+                for (int i = 0; i < inFlight; ++i)
+                {
+                    int status = readResponse(fd, buffer);
+                    latencies[c].push_back(std::chrono::duration<double, std::micro>(Clock::now() - sentAt).count());
+                    if (status != 200)
+                        ++failures;
+                    if (status < 0)
+                    {
+                        failures += perConnection - done - i - 1;
+                        done = perConnection;
+                        break;
+                    }
+                }
+                done += inFlight;
+            }
+            close(fd); });
+    }
+    for (std::thread &client : clients)
+        client.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (const auto &perClient : latencies)
+        all.insert(all.end(), perClient.begin(), perClient.end());
+    std::sort(all.begin(), all.end());
+
+    auto percentile = [&](double p)
+    {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, (size_t)(p * all.size()))];
+    };
+
+    std::printf("GET %s: %zu requests over %d connections (pipeline %d) in %.2f s\n",
+                options.path.c_str(), all.size(), connections, pipeline, seconds);
+    std::printf("  throughput: %.0f req/s\n", seconds > 0 ? all.size() / seconds : 0.0);
+    std::printf("  latency:    p50 %.0f us, p99 %.0f us, max %.0f us\n",
+                percentile(0.50), percentile(0.99), all.empty() ? 0.0 : all.back());
+    std::printf("  failures:   %ld\n", failures.load());
+
+    return failures > 0 ? 2 : 0;
+}
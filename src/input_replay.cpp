@@ -0,0 +1,191 @@
+#include "input_replay.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// File layout (native byte order; recordings are replayed on the machine
+// type that made them):
+//   "INVREC01", uint32 sizeof(SDL_Event), int32 width, height, seedRows
+//   per frame: uint32 eventCount, float deltaTime, eventCount * SDL_Event
+static const char magic[8] = {'I', 'N', 'V', 'R', 'E', 'C', '0', '1'};
+
+struct FrameTiming
+{
+    int frame;
+    int events;
+    double ms;
+};
+
+static std::ofstream recording;
+static std::ifstream replay;
+static std::vector<FrameTiming> timings;
+
+template <typename T>
+static void writeValue(std::ofstream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool readValue(std::ifstream &in, T &value)
+{
+    return (bool)in.read(reinterpret_cast<char *>(&value), sizeof(value));
+}
+
+static bool isRecordable(const SDL_Event &event)
+{
+    switch (event.type)
+    {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    case SDL_TEXTINPUT:
+    case SDL_MOUSEMOTION:
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+    case SDL_MOUSEWHEEL:
+    case SDL_WINDOWEVENT:
+    case SDL_QUIT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool startRecording(const std::string &path, const RecordingInfo &info)
+{
+    recording.open(path, std::ios::binary | std::ios::trunc);
+    if (!recording)
+    {
+        std::cerr << "Cannot write recording " << path << std::endl;
+        return false;
+    }
+
+    recording.write(magic, sizeof(magic));
+    writeValue(recording, (uint32_t)sizeof(SDL_Event));
+    writeValue(recording, (int32_t)info.windowWidth);
+    writeValue(recording, (int32_t)info.windowHeight);
+    writeValue(recording, (int32_t)info.seedRows);
+    return true;
+}
+
+void recordFrame(const std::vector<SDL_Event> &events, float deltaTime)
+{
+    if (!recording.is_open())
+        return;
+
+    uint32_t count = 0;
+    for (const SDL_Event &event : events)
+        count += isRecordable(event);
+
+    writeValue(recording, count);
+    writeValue(recording, deltaTime);
+    for (const SDL_Event &event : events)
+        if (isRecordable(event))
+            writeValue(recording, event);
+}
+
+void stopRecording()
+{
+    if (recording.is_open())
+        recording.close();
+}
+
+bool isRecording()
+{
+    return recording.is_open();
+}
+
+bool openReplay(const std::string &path, RecordingInfo &info)
+{
+    replay.open(path, std::ios::binary);
+    char header[sizeof(magic)];
+    uint32_t eventSize = 0;
+    int32_t width = 0, height = 0, seedRows = -1;
+    if (!replay || !replay.read(header, sizeof(header)) || std::memcmp(header, magic, sizeof(magic)) != 0 ||
+        !readValue(replay, eventSize) || !readValue(replay, width) || !readValue(replay, height) ||
+        !readValue(replay, seedRows))
+    {
+        std::cerr << "Not a recording: " << path << std::endl;
+        replay.close();
+        return false;
+    }
+    if (eventSize != sizeof(SDL_Event))
+    {
+        std::cerr << "Recording was made with a different SDL build" << std::endl;
+        replay.close();
+        return false;
+    }
+
+    info = {width, height, seedRows};
+    timings.clear();
+    return true;
+}
+
+bool nextReplayFrame(std::vector<SDL_Event> &events, float &deltaTime)
+{
+    events.clear();
+    uint32_t count;
+    if (!replay.is_open() || !readValue(replay, count) || !readValue(replay, deltaTime))
+        return false;
+
+    events.resize(count);
+    for (SDL_Event &event : events)
+        if (!readValue(replay, event))
+            return false;
+    return true;
+}
+
+void closeReplay()
+{
+    if (replay.is_open())
+        replay.close();
+}
+
+bool isReplaying()
+{
+    return replay.is_open();
+}
+
+void addFrameTiming(double ms, int events)
+{
+    timings.push_back({(int)timings.size(), events, ms});
+}
+
+void reportFrameTimings(const std::string &csvPath)
+{
+    if (timings.empty())
+        return;
+
+    if (!csvPath.empty())
+    {
+        std::ofstream csv(csvPath, std::ios::trunc);
+        csv << "frame,events,ms\n";
+        for (const FrameTiming &t : timings)
+            csv << t.frame << ',' << t.events << ',' << t.ms << '\n';
+    }
+
+    std::vector<FrameTiming> sorted = timings;
+    std::sort(sorted.begin(), sorted.end(), [](const FrameTiming &a, const FrameTiming &b)
+              { return a.ms < b.ms; });
+    auto percentile = [&sorted](double p)
+    {
+        return sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))].ms;
+    };
+
+    double total = 0.0;
+    for (const FrameTiming &t : timings)
+        total += t.ms;
+
+    std::printf("frames: %zu  avg %.3f ms  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n", timings.size(),
+                total / timings.size(), percentile(0.5), percentile(0.95), percentile(0.99), sorted.back().ms);
+    std::printf("slowest frames:");
+    for (size_t i = 0; i < sorted.size() && i < 5; ++i)
+    {
+        const FrameTiming &t = sorted[sorted.size() - 1 - i];
+        std::printf(" #%d (%.3f ms, %d events)", t.frame, t.ms, t.events);
+    }
+    std::printf("\n");
+}
@@ -1,14 +1,84 @@
+#include "audit.hpp"
 #include "db.hpp"
 #include "gui.hpp"
+#include "input_replay.hpp"
+#include "seed.hpp"
+#include "timeseries.hpp"
+#include "cli.hpp"
+#include "undo.hpp"
+#include <cstdlib>
 #include <iostream>
 
-int main() {
-    if (!initDB("inventory.db")) {
+// --record FILE / --replay FILE [--report CSV] [--seed N] [--db FILE] open the
+// window with input recording or replay; returns false for anything else
+static bool parseGUIOptions(int argc, char **argv, GUIOptions &options, std::string &dbPath)
+{
+    bool explicitDb = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            return false;
+        if (arg == "--record")
+            options.recordPath = argv[++i];
+        else if (arg == "--replay")
+            options.replayPath = argv[++i];
+        else if (arg == "--report")
+            options.reportPath = argv[++i];
+        else if (arg == "--seed")
+            options.seedRows = std::atoi(argv[++i]);
+        else if (arg == "--db")
+        {
+            dbPath = argv[++i];
+            explicitDb = true;
+        }
+        else
+            return false;
+    }
+    if (options.recordPath.empty() == options.replayPath.empty())
+        return false;
+
+    // A replay is only meaningful against the catalogue it was recorded with
+    if (!options.replayPath.empty() && options.seedRows < 0)
+    {
+        RecordingInfo info;
+        if (openReplay(options.replayPath, info))
+            options.seedRows = info.seedRows;
+        closeReplay();
+    }
+    // Seeding wipes the database first, so never default to the real one
+    if (options.seedRows >= 0 && !explicitDb)
+        dbPath = "seeded.db";
+    return true;
+}
+
+int main(int argc, char **argv) {
+    std::string dbPath = "inventory.db";
+    GUIOptions options;
+
+    // Any other arguments select the headless batch mode (no window is opened)
+    if (argc > 1 && !parseGUIOptions(argc, argv, options, dbPath))
+        return runCLI(argc, argv);
+
+    if (options.seedRows >= 0)
+        removeDatabaseFiles(dbPath);
+    if (!initDB(dbPath)) {
         std::cerr << "Failed to open database." << std::endl;
         return 1;
     }
+    if (options.seedRows > 0 && !seedCatalogue(options.seedRows)) {
+        std::cerr << "Failed to seed database." << std::endl;
+        return 1;
+    }
 
-    runGUI();
+    initUndo(dbPath + ".undo");
+    initAudit(dbPath, "gui");
+    initSeries(dbPath);
+    runGUI(options);
+    shutdownSeries();
+    shutdownAudit();
+    shutdownUndo();
+    closeDB();
 
     return 0;
 }
@@ -0,0 +1,1888 @@
+#include "gui.hpp"
+#include "db.hpp"
+#include "alerts.hpp"
+#include "allocation.hpp"
+#include "audit.hpp"
+#include "barcode.hpp"
+#include "facets.hpp"
+#include "fonts.hpp"
+#include "product_view.hpp"
+#include "query_log.hpp"
+#include "timeseries.hpp"
+#include "undo.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+
+const char *const uiGlyphs = "⏱⚠✅✏❌➕🆔🏷💵💾📁📈📉📊📋📦🔄🔍🔔🕘🗑🛠";
+
+// Bumped on every product change; panels compare it with what they last loaded
+static unsigned dataRevision = 0;
+
+// Quantity change applied by each scan while scan mode is on
+static int scanDelta = 1;
+
+static int changeObserver = 0;
+
+// When a panel reloads its data: after a change event (with bursts coalesced
+// by minGap) or once its periodic interval runs out, whichever comes first.
+// Panels that are hidden or collapsed are not drawn, so they never refresh.
+struct PanelRefresh
+{
+    double interval; // seconds between periodic reloads, 0 = change events only
+    double minGap;   // minimum seconds between reloads caused by changes
+    unsigned seenRevision = ~0u;
+    double lastRefresh = -1.0e9;
+
+    bool due(double now)
+    {
+        bool changed = seenRevision != dataRevision && now - lastRefresh >= minGap;
+        bool expired = interval > 0.0 && now - lastRefresh >= interval;
+        if (!changed && !expired)
+            return false;
+
+        seenRevision = dataRevision;
+        lastRefresh = now;
+        return true;
+    }
+};
+
+void initPanels()
+{
+    if (changeObserver)
+        return;
+
+    initAlerts();
+    initBarcodeIndex();
+    initFacets();
+
+    // Panels reload their data when this observer reports a change
+    changeObserver = addProductObserver([](const ProductChange &)
+                                        { ++dataRevision; });
+    ++dataRevision;
+}
+
+void shutdownPanels()
+{
+    if (!changeObserver)
+        return;
+
+    removeProductObserver(changeObserver);
+    changeObserver = 0;
+    shutdownFacets();
+    shutdownBarcodeIndex();
+    shutdownAlerts();
+}
+
+int getScanDelta()
+{
+    return scanDelta;
+}
+
+void renderProductList()
+{
+    static std::vector<Product> products;
+    // Reload on change, and every 10 s to pick up edits made by other terminals
+    static PanelRefresh refresh = {10.0, 0.25};
+    bool reloaded = false;
+
+    if (refresh.due(ImGui::GetTime()))
+    {
+        reloaded = true;
+        products = getAllProducts();
+        for (const auto &p : products)
+            requestGlyphs(p.name.c_str());
+    }
+
+    ImGui::BeginGroup();
+
+    // Title
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "📦 Product List");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    // Label + Refresh Button (blue style)
+    ImGui::Text("Refresh product list:");
+    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.9f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.3f, 0.6f, 1.0f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.1f, 0.4f, 0.8f, 1.0f));
+
+    if (ImGui::Button("🔄 Refresh List", ImVec2(160, 35)))
+    {
+        // Refresh the products by fetching fresh data
+        reloaded = true;
+        products = getAllProducts();
+        for (const auto &p : products)
+            requestGlyphs(p.name.c_str());
+    }
+
+    ImGui::PopStyleColor(3);
+    ImGui::Spacing();
+
+    // Facet filters: counts and matches come from the bitmap indexes, so
+    // they stay instant however large the catalogue is
+    static FacetSelection selection = emptyFacetSelection();
+    static std::vector<std::vector<uint64_t>> counts;
+    static std::vector<uint32_t> visible; // indices into products, in display order
+    static unsigned seenFacets = ~0u;
+    static SortColumn sortColumn = SortColumn::Id;
+    static bool sortDescending = false;
+    static bool resort = true; // persists while the grouped view hides the table
+    static int grouping = 0;
+    bool selectionChanged = false;
+    bool regroup = false;
+
+    if (ImGui::CollapsingHeader("Filters"))
+    {
+        const std::vector<Facet> &facets = getFacets();
+        if (counts.size() != facets.size())
+            counts = countFacets(selection);
+
+        for (size_t f = 0; f < facets.size(); ++f)
+        {
+            ImGui::TextDisabled("%s", facets[f].name.c_str());
+            for (size_t v = 0; v < facets[f].values.size(); ++v)
+            {
+                char label[96];
+                snprintf(label, sizeof(label), "%s (%llu)##facet%zu_%zu", facets[f].values[v].label.c_str(),
+                         (unsigned long long)counts[f][v], f, v);
+                bool checked = selection[f][v];
+                ImGui::SameLine();
+                if (ImGui::Checkbox(label, &checked))
+                {
+                    selection[f][v] = checked;
+                    selectionChanged = true;
+                }
+            }
+        }
+
+        if (isFilteringFacets(selection) && ImGui::SmallButton("Clear filters"))
+        {
+            selection = emptyFacetSelection();
+            selectionChanged = true;
+        }
+    }
+
+    if (reloaded || selectionChanged || seenFacets != getFacetsRevision())
+    {
+        seenFacets = getFacetsRevision();
+        counts = countFacets(selection);
+
+        visible.clear();
+        bool filtering = isFilteringFacets(selection);
+        RoaringBitmap matches = filtering ? filterByFacets(selection) : RoaringBitmap();
+        for (size_t i = 0; i < products.size(); ++i)
+            if (!filtering || matches.contains((uint32_t)products[i].id))
+                visible.push_back((uint32_t)i);
+        regroup = resort = true;
+    }
+
+    ImGui::PushItemWidth(200);
+    if (ImGui::Combo("Group by", &grouping, "None\0First word of name\0Price\0Reorder level\0"))
+        regroup = true;
+    ImGui::PopItemWidth();
+
+    if (grouping > 0)
+    {
+        static std::vector<ProductGroup> groups;
+        if (regroup)
+            groups = groupRows(products, visible, (GroupColumn)(grouping - 1));
+
+        ImGui::BeginChild("ProductGroupRegion", ImVec2(0, 0), true);
+        if (ImGui::BeginTable("ProductGroups", 4,
+                              ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY))
+        {
+            ImGui::TableSetupColumn("Group", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Products", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+            ImGui::TableSetupColumn("Units", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+            ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+            ImGui::TableHeadersRow();
+
+            ImGuiListClipper clipper;
+            clipper.Begin((int)groups.size());
+            while (clipper.Step())
+            {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+                {
+                    const ProductGroup &g = groups[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("%s", g.label.c_str());
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text("%d", g.products);
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%lld", g.units);
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%s", formatMoney(g.value).c_str());
+                }
+            }
+            ImGui::EndTable();
+        }
+        ImGui::EndChild();
+
+        ImGui::EndGroup();
+        return;
+    }
+
+    // Scrollable child for table, filling the rest of the panel
+    ImGui::BeginChild("ProductTableRegion", ImVec2(0, 0), true);
+
+    if (ImGui::BeginTable("ProductTable", 5,
+                          ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_Resizable |
+                              ImGuiTableFlags_Sortable |
+                              ImGuiTableFlags_SizingStretchProp |
+                              ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupColumn("🆔 ID", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultSort, 60.0f,
+                                (ImGuiID)SortColumn::Id);
+        ImGui::TableSetupColumn("📦 Name", ImGuiTableColumnFlags_WidthStretch, 0.0f, (ImGuiID)SortColumn::Name);
+        ImGui::TableSetupColumn("📊 Quantity", ImGuiTableColumnFlags_WidthFixed, 80.0f, (ImGuiID)SortColumn::Quantity);
+        ImGui::TableSetupColumn("💵 Price", ImGuiTableColumnFlags_WidthFixed, 80.0f, (ImGuiID)SortColumn::Price);
+        ImGui::TableSetupColumn("🏷️ SKU", ImGuiTableColumnFlags_WidthFixed, 120.0f, (ImGuiID)SortColumn::Sku);
+        ImGui::TableSetupScrollFreeze(0, 1);
+
+        ImGui::TableHeadersRow();
+
+        // Header clicks re-sort the filtered rows on precomputed keys
+        ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs();
+        if (specs && specs->SpecsDirty && specs->SpecsCount > 0)
+        {
+            sortColumn = (SortColumn)specs->Specs[0].ColumnUserID;
+            sortDescending = specs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
+            specs->SpecsDirty = false;
+            resort = true;
+        }
+        if (resort)
+        {
+            sortRows(products, visible, sortColumn, sortDescending);
+            resort = false;
+        }
+
+        // Only the rows on screen are laid out, so a million rows cost the same as fifty
+        ImGuiListClipper clipper;
+        clipper.Begin((int)visible.size());
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+            {
+                const Product &p = products[visible[i]];
+                ImGui::TableNextRow();
+
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%d", p.id);
+
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%s", p.name.c_str());
+
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%d", p.quantity);
+
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%s", formatMoney(p.price).c_str());
+
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%s", p.sku.c_str());
+            }
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::EndChild();
+
+    ImGui::EndGroup();
+}
+
+// Text in the search panel's box
+static char searchKeyword[128] = "";
+
+void setSearchKeyword(const char *text)
+{
+    snprintf(searchKeyword, sizeof(searchKeyword), "%s", text);
+}
+
+void renderSearchProduct()
+{
+
+    ImGui::Text("🔍 Search for a Product");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::Text("Enter Product ID or Name:");
+    ImGui::PushItemWidth(-1);
+    ImGui::InputText("##SearchBar", searchKeyword, IM_ARRAYSIZE(searchKeyword));
+    ImGui::PopItemWidth();
+
+    ImGui::Spacing();
+
+    // 🔵 Styled "Clear Search" button - soft blue-gray like Update UI
+    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.3f, 0.5f, 0.8f, 1.0f));        // Base color
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.4f, 0.6f, 0.9f, 1.0f)); // Hover
+    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.2f, 0.4f, 0.7f, 1.0f));  // Active
+
+    if (ImGui::Button("🔄 Clear Search", ImVec2(150, 35)))
+    {
+        searchKeyword[0] = '\0';
+    }
+
+    ImGui::PopStyleColor(3);
+    ImGui::Spacing();
+
+    // Re-run the query only when the keyword or the data changed
+    static std::vector<Product> results;
+    static std::string lastKeyword;
+    static PanelRefresh refresh = {0.0, 0.25};
+
+    bool stale = refresh.due(ImGui::GetTime());
+    if (stale || lastKeyword != searchKeyword)
+    {
+        lastKeyword = searchKeyword;
+        results = strlen(searchKeyword) > 0 ? searchProducts(searchKeyword) : std::vector<Product>();
+        for (const auto &p : results)
+            requestGlyphs(p.name.c_str());
+    }
+
+    if (strlen(searchKeyword) > 0)
+    {
+        if (results.empty())
+        {
+            ImGui::TextColored(ImVec4(1, 0, 0, 1), "No products found matching your search.");
+        }
+        else if (ImGui::BeginTable("SearchTable", 4,
+                                   ImGuiTableFlags_Borders |
+                                       ImGuiTableFlags_RowBg |
+                                       ImGuiTableFlags_Resizable |
+                                       ImGuiTableFlags_SizingStretchProp))
+        {
+            ImGui::TableSetupColumn("🆔 ID", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+            ImGui::TableSetupColumn("📦 Name", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("📊 Quantity", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+            ImGui::TableSetupColumn("💵 Price", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+
+            ImGui::TableHeadersRow();
+
+            for (const auto &p : results)
+            {
+                ImGui::TableNextRow();
+
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%d", p.id);
+
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%s", p.name.c_str());
+
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%d", p.quantity);
+
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%s", formatMoney(p.price).c_str());
+            }
+
+            ImGui::EndTable();
+        }
+    }
+}
+
+// Three-way merge after an optimistic update lost the race: base is what the
+// editor loaded, mine what the user typed, theirs what another terminal saved
+struct UpdateConflict
+{
+    bool active = false;
+    Product base, mine, theirs;
+    int choice[5] = {}; // per field: 0 = mine, 1 = theirs, 2 = both quantity changes
+};
+
+static const char *const mergeFields[] = {"Name", "Quantity", "Price", "Reorder level", "Barcode / SKU"};
+
+static std::string fieldText(const Product &p, int field)
+{
+    switch (field)
+    {
+    case 0: return p.name;
+    case 1: return std::to_string(p.quantity);
+    case 2: return formatMoney(p.price);
+    case 3: return std::to_string(p.reorderLevel);
+    default: return p.sku;
+    }
+}
+
+static void startConflict(UpdateConflict &c, const Product &base, const Product &mine, const Product &theirs)
+{
+    c.active = true;
+    c.base = base;
+    c.mine = mine;
+    c.theirs = theirs;
+    for (int f = 0; f < IM_ARRAYSIZE(mergeFields); ++f)
+    {
+        bool mineChanged = fieldText(mine, f) != fieldText(base, f);
+        bool theirsChanged = fieldText(theirs, f) != fieldText(base, f);
+        // Fields only one side touched need no decision. Stock counted on two
+        // terminals usually means both deltas happened, so those add up.
+        if (!mineChanged)
+            c.choice[f] = 1;
+        else if (f == 1 && theirsChanged)
+            c.choice[f] = 2;
+        else
+            c.choice[f] = 0;
+    }
+}
+
+// theirs carries the version the merged write is checked against
+static Product mergedProduct(const UpdateConflict &c)
+{
+    Product p = c.theirs;
+    if (c.choice[0] == 0)
+        p.name = c.mine.name;
+    if (c.choice[1] == 0)
+        p.quantity = c.mine.quantity;
+    else if (c.choice[1] == 2)
+        p.quantity = c.theirs.quantity + (c.mine.quantity - c.base.quantity);
+    if (c.choice[2] == 0)
+        p.price = c.mine.price;
+    if (c.choice[3] == 0)
+        p.reorderLevel = c.mine.reorderLevel;
+    if (c.choice[4] == 0)
+        p.sku = c.mine.sku;
+    return p;
+}
+
+static void renderMergeTable(UpdateConflict &c)
+{
+    if (!ImGui::BeginTable("MergeTable", 5,
+                           ImGuiTableFlags_Borders |
+                               ImGuiTableFlags_RowBg |
+                               ImGuiTableFlags_SizingStretchProp))
+        return;
+
+    ImGui::TableSetupColumn("Field", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+    ImGui::TableSetupColumn("When loaded");
+    ImGui::TableSetupColumn("Yours");
+    ImGui::TableSetupColumn("Theirs");
+    ImGui::TableSetupColumn("Keep", ImGuiTableColumnFlags_WidthFixed, 190.0f);
+    ImGui::TableHeadersRow();
+
+    const ImVec4 changed(1.0f, 0.8f, 0.3f, 1.0f);
+    for (int f = 0; f < IM_ARRAYSIZE(mergeFields); ++f)
+    {
+        std::string base = fieldText(c.base, f);
+        std::string mine = fieldText(c.mine, f);
+        std::string theirs = fieldText(c.theirs, f);
+        bool both = mine != base && theirs != base && mine != theirs;
+
+        ImGui::PushID(f);
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        if (both)
+            ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "%s", mergeFields[f]);
+        else
+            ImGui::TextUnformatted(mergeFields[f]);
+
+        ImGui::TableSetColumnIndex(1);
+        ImGui::TextDisabled("%s", base.c_str());
+        ImGui::TableSetColumnIndex(2);
+        if (mine != base)
+            ImGui::TextColored(changed, "%s", mine.c_str());
+        else
+            ImGui::TextUnformatted(mine.c_str());
+        ImGui::TableSetColumnIndex(3);
+        if (theirs != base)
+            ImGui::TextColored(changed, "%s", theirs.c_str());
+        else
+            ImGui::TextUnformatted(theirs.c_str());
+
+        ImGui::TableSetColumnIndex(4);
+        ImGui::RadioButton("Yours", &c.choice[f], 0);
+        ImGui::SameLine();
+        ImGui::RadioButton("Theirs", &c.choice[f], 1);
+        if (f == 1)
+        {
+            ImGui::SameLine();
+            ImGui::RadioButton("Both", &c.choice[f], 2);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Their quantity plus your change (%+d)", c.mine.quantity - c.base.quantity);
+        }
+        ImGui::PopID();
+    }
+
+    ImGui::EndTable();
+}
+
+void renderUpdateProduct()
+{
+    static char inputSearch[128] = "";
+    static Product loadedProduct = noProduct;
+    static bool productLoaded = false;
+    static bool updateSuccess = false;
+    static bool updateFailed = false;
+    static bool updateBusy = false; // failed only because another terminal held the lock
+    static bool updateGone = false;  // deleted by someone else while being edited
+    static UpdateConflict conflict;
+
+    static char updatedName[128] = "";
+    static int updatedQuantity = 0;
+    static char updatedPrice[32] = "";
+    static int updatedReorderLevel = 0;
+    static char updatedSku[64] = "";
+
+    // The editor keeps the version it was filled from for the optimistic update
+    auto loadEditor = [](const Product &p)
+    {
+        loadedProduct = p;
+        productLoaded = true;
+        conflict.active = false;
+        requestGlyphs(p.name.c_str());
+
+        snprintf(updatedName, sizeof(updatedName), "%s", p.name.c_str());
+        updatedQuantity = p.quantity;
+        snprintf(updatedPrice, sizeof(updatedPrice), "%s", formatMoney(p.price).c_str());
+        updatedReorderLevel = p.reorderLevel;
+        snprintf(updatedSku, sizeof(updatedSku), "%s", p.sku.c_str());
+    };
+
+    // Apply one optimistic write and route the outcome; a lost race opens
+    // (or refreshes) the merge view instead of overwriting
+    auto saveProduct = [&](const Product &edited, const Product &base)
+    {
+        Product current;
+        UpdateResult result = updateProductIfUnchanged(edited, current);
+
+        // Moving stock between locations or filing the product under another
+        // category bumps the version without changing any field shown here;
+        // that is no reason to ask the user
+        if (result == UpdateResult::Conflict)
+        {
+            bool visible = false;
+            for (int f = 0; f < IM_ARRAYSIZE(mergeFields); ++f)
+                visible = visible || fieldText(current, f) != fieldText(base, f);
+            if (!visible)
+            {
+                Product retry = edited;
+                retry.categoryId = current.categoryId;
+                retry.version = current.version;
+                result = updateProductIfUnchanged(retry, current);
+            }
+        }
+        updateSuccess = result == UpdateResult::Updated;
+        updateFailed = result == UpdateResult::Failed;
+        updateBusy = updateFailed && lastWriteWasBusy();
+        updateGone = result == UpdateResult::NotFound;
+
+        if (result == UpdateResult::Updated)
+        {
+            loadEditor(current);
+            snprintf(inputSearch, sizeof(inputSearch), "%s", current.name.c_str());
+        }
+        else if (result == UpdateResult::Conflict)
+        {
+            requestGlyphs(current.name.c_str());
+            startConflict(conflict, base, edited, current);
+        }
+        else if (result == UpdateResult::NotFound)
+            conflict.active = false;
+    };
+
+    ImGui::BeginGroup();
+
+    ImGui::Text("🛠️ Update Product");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::Text("Enter Product ID or Name:");
+    ImGui::PushItemWidth(-1); // full width input
+    ImGui::InputText("##SearchProduct", inputSearch, IM_ARRAYSIZE(inputSearch));
+    ImGui::PopItemWidth();
+
+    ImGui::Spacing();
+
+    // Styled blue Load button
+    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.5f, 0.9f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.3f, 0.6f, 1.0f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.1f, 0.4f, 0.8f, 1.0f));
+
+    if (ImGui::Button("🔍 Load Product", ImVec2(160, 35)))
+    {
+        productLoaded = false;
+        updateSuccess = false;
+        updateFailed = false;
+        updateGone = false;
+        conflict.active = false;
+
+        // Only the first match is needed, so stop after one row
+        Cursor<Product> results = openProductSearch(inputSearch);
+
+        if (results.next())
+            loadEditor(results.current());
+        else
+        {
+            loadedProduct = noProduct;
+            productLoaded = false;
+        }
+    }
+
+    ImGui::PopStyleColor(3); // Restore button color
+
+    ImGui::Spacing();
+
+    if (!productLoaded && strlen(inputSearch) > 0)
+    {
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), "❌ No product found with ID or Name '%s'.", inputSearch);
+    }
+
+    if (productLoaded && conflict.active)
+    {
+        ImGui::TextColored(ImVec4(1.0f, 0.7f, 0.2f, 1.0f),
+                           "⚠️ Someone else saved this product while you were editing it.");
+        ImGui::TextWrapped("Nothing was overwritten. Choose which value to keep for each field, then save again.");
+        ImGui::Spacing();
+
+        renderMergeTable(conflict);
+        Product merged = mergedProduct(conflict);
+        ImGui::Spacing();
+
+        if (ImGui::Button("💾 Save Merged", ImVec2(180, 35)))
+            saveProduct(merged, conflict.theirs);
+        ImGui::SameLine();
+        if (ImGui::Button("🔄 Discard My Changes", ImVec2(200, 35)))
+        {
+            loadEditor(conflict.theirs);
+            updateSuccess = updateFailed = false;
+        }
+
+        if (updateFailed)
+            ImGui::TextColored(ImVec4(1, 0, 0, 1), updateBusy
+                                                       ? "❌ Database is busy (another terminal is writing). Please try again."
+                                                       : "❌ Update failed. Please try again.");
+    }
+    else if (productLoaded)
+    {
+        ImGui::PushItemWidth(-1);
+        ImGui::InputText("Updated Name", updatedName, IM_ARRAYSIZE(updatedName));
+        ImGui::InputInt("Updated Quantity", &updatedQuantity);
+        ImGui::InputText("Updated Price", updatedPrice, IM_ARRAYSIZE(updatedPrice), ImGuiInputTextFlags_CharsDecimal);
+        ImGui::InputInt("Updated Reorder Level", &updatedReorderLevel);
+        ImGui::InputText("Updated Barcode / SKU", updatedSku, IM_ARRAYSIZE(updatedSku));
+        ImGui::PopItemWidth();
+
+        ImGui::Spacing();
+
+        // Styled green Update button
+        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.2f, 0.7f, 0.2f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.3f, 0.85f, 0.3f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.1f, 0.6f, 0.1f, 1.0f));
+
+        if (ImGui::Button("💾 Update Product", ImVec2(180, 40)))
+        {
+            Product updated = loadedProduct;
+            updated.name = updatedName;
+            updated.quantity = updatedQuantity;
+            updated.reorderLevel = updatedReorderLevel;
+            updated.sku = updatedSku;
+            if (parseMoney(updatedPrice, updated.price))
+                saveProduct(updated, loadedProduct);
+            else
+            {
+                updateSuccess = false;
+                updateFailed = true;
+                updateBusy = false;
+            }
+        }
+
+        ImGui::PopStyleColor(3); // Restore
+
+        if (updateSuccess)
+            ImGui::TextColored(ImVec4(0, 1, 0, 1), "✅ Product updated successfully!");
+        else if (updateGone)
+            ImGui::TextColored(ImVec4(1, 0, 0, 1), "❌ Someone else deleted this product. Nothing was saved.");
+        else if (updateFailed)
+            ImGui::TextColored(ImVec4(1, 0, 0, 1), updateBusy
+                                                       ? "❌ Database is busy (another terminal is writing). Please try again."
+                                                       : "❌ Update failed. Please try again.");
+    }
+
+    ImGui::EndGroup();
+}
+
+void renderDeleteProduct()
+{
+    static char inputSearch[128] = "";
+    static Product productToDelete = noProduct;
+    static bool showConfirmDialog = false;
+    static bool deleteSuccess = false;
+    static bool deleteFailed = false;
+    static bool deleteBusy = false;
+    static bool productLoaded = false;
+
+    ImGui::BeginGroup();
+
+    ImGui::Text("🗑️ Delete Product");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::Text("Enter Product ID or Name:");
+    ImGui::PushItemWidth(-1); // full-width input
+    ImGui::InputText("##DeleteInput", inputSearch, IM_ARRAYSIZE(inputSearch));
+    ImGui::PopItemWidth();
+
+    // Look the product up again only when the input or the data changed
+    static std::string lastSearch;
+    static PanelRefresh refresh = {0.0, 0.0};
+
+    bool stale = refresh.due(ImGui::GetTime());
+    if (stale || lastSearch != inputSearch)
+    {
+        lastSearch = inputSearch;
+        productLoaded = false;
+
+        if (strlen(inputSearch) > 0)
+        {
+            Cursor<Product> results = openProductSearch(inputSearch);
+            if (results.next())
+            {
+                productToDelete = results.current();
+                productLoaded = true;
+                requestGlyphs(productToDelete.name.c_str());
+            }
+        }
+    }
+
+    ImGui::Spacing();
+
+    if (!productLoaded && strlen(inputSearch) > 0)
+    {
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), "⚠️ No product found with ID or Name '%s'", inputSearch);
+    }
+    else if (productLoaded)
+    {
+        ImGui::Text("Product to delete:");
+        ImGui::BulletText("ID: %d", productToDelete.id);
+        ImGui::BulletText("Name: %s", productToDelete.name.c_str());
+        ImGui::BulletText("Quantity: %d", productToDelete.quantity);
+        ImGui::BulletText("Price: %s", formatMoney(productToDelete.price).c_str());
+    }
+
+    ImGui::Spacing();
+
+    bool canDelete = productLoaded;
+
+    // 🔴 Styled delete button
+    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.85f, 0.25f, 0.25f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.95f, 0.4f, 0.4f, 1.0f));
+    ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.75f, 0.2f, 0.2f, 1.0f));
+
+    if (ImGui::Button("🗑️ Delete Product", ImVec2(180, 40)) && canDelete)
+    {
+        showConfirmDialog = true;
+        deleteSuccess = false;
+        deleteFailed = false;
+    }
+
+    ImGui::PopStyleColor(3);
+
+    if (showConfirmDialog)
+    {
+        ImGui::OpenPopup("Confirm Deletion");
+    }
+
+    // 🔒 Confirmation Popup
+    if (ImGui::BeginPopupModal("Confirm Deletion", NULL, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::Text("Are you sure you want to delete this product?\n\n");
+        ImGui::BulletText("ID: %d", productToDelete.id);
+        ImGui::BulletText("Name: %s", productToDelete.name.c_str());
+        ImGui::BulletText("Quantity: %d", productToDelete.quantity);
+        ImGui::BulletText("Price: %s", formatMoney(productToDelete.price).c_str());
+
+        ImGui::Separator();
+
+        // 🔴 Confirm Button
+        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.85f, 0.25f, 0.25f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.95f, 0.4f, 0.4f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.75f, 0.2f, 0.2f, 1.0f));
+
+        if (ImGui::Button("Yes, Delete", ImVec2(140, 35)))
+        {
+            if (deleteProduct(productToDelete.id))
+            {
+                deleteSuccess = true;
+                deleteFailed = false;
+                memset(inputSearch, 0, sizeof(inputSearch));
+                productLoaded = false;
+                productToDelete = noProduct;
+            }
+            else
+            {
+                deleteSuccess = false;
+                deleteFailed = true;
+                deleteBusy = lastWriteWasBusy();
+            }
+            showConfirmDialog = false;
+            ImGui::CloseCurrentPopup();
+        }
+
+        ImGui::PopStyleColor(3);
+
+        ImGui::SameLine();
+
+        // 🟤 Cancel Button (gray)
+        ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.5f, 0.5f, 0.5f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0.6f, 0.6f, 0.6f, 1.0f));
+        ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.4f, 0.4f, 0.4f, 1.0f));
+
+        if (ImGui::Button("Cancel", ImVec2(140, 35)))
+        {
+            showConfirmDialog = false;
+            ImGui::CloseCurrentPopup();
+        }
+
+        ImGui::PopStyleColor(3);
+
+        ImGui::EndPopup();
+    }
+
+    ImGui::Spacing();
+
+    if (deleteSuccess)
+    {
+        ImGui::TextColored(ImVec4(0, 1, 0, 1), "✅ Product deleted successfully!");
+    }
+    else if (deleteFailed)
+    {
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), deleteBusy
+                                                   ? "❌ Database is busy (another terminal is writing). Please try again."
+                                                   : "❌ Deletion failed. Please try again.");
+    }
+
+    ImGui::EndGroup();
+}
+
+void renderAlerts()
+{
+    const auto &alerts = getStockAlerts();
+
+    static unsigned seenRevision = ~0u;
+    if (seenRevision != getAlertsRevision())
+    {
+        seenRevision = getAlertsRevision();
+        for (const auto &entry : alerts)
+            requestGlyphs(entry.second.name.c_str());
+    }
+
+    ImGui::BeginGroup();
+
+    ImGui::TextColored(ImVec4(1.0f, 0.7f, 0.2f, 1.0f), "⚠️ Low Stock Alerts");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    if (alerts.empty())
+    {
+        ImGui::TextColored(ImVec4(0, 1, 0, 1), "✅ All products are above their reorder level.");
+        ImGui::EndGroup();
+        return;
+    }
+
+    ImGui::Text("%d product(s) need reordering:", (int)alerts.size());
+    ImGui::Spacing();
+
+    if (ImGui::BeginTable("AlertsTable", 5,
+                          ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_Resizable |
+                              ImGuiTableFlags_SizingStretchProp |
+                              ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupColumn("🆔 ID", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+        ImGui::TableSetupColumn("📦 Name", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("📊 Quantity", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableSetupColumn("🔔 Reorder At", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+        ImGui::TableSetupColumn("📉 Shortfall", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+
+        ImGui::TableHeadersRow();
+
+        for (const auto &entry : alerts)
+        {
+            const StockAlert &a = entry.second;
+            ImGui::TableNextRow();
+
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%d", a.productId);
+
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%s", a.name.c_str());
+
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "%d", a.quantity);
+
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%d", a.reorderLevel);
+
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%d", a.reorderLevel - a.quantity);
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::EndGroup();
+}
+
+void renderLocations()
+{
+    static std::vector<Location> locations;
+    static std::vector<LocationStock> stock;
+    static int selected = 0; // location ID, 0 = none
+    static char newName[64] = "";
+    static int productId = 1;
+    static int amount = 1;
+    static int moveTarget = 0;
+    static const char *message = "";
+    static PanelRefresh refresh = {2.0, 0.25};
+
+    // Moves between locations leave the product total alone and raise no
+    // change event, so this panel's own actions reload it directly
+    bool reload = refresh.due(ImGui::GetTime());
+    auto finish = [&](bool ok, const char *failure)
+    {
+        message = ok ? "" : failure;
+        reload = true;
+    };
+
+    ImGui::BeginGroup();
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "📦 Stock by Location");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::BeginChild("LocationList", ImVec2(220, 0), ImGuiChildFlags_Borders);
+    ImGui::PushItemWidth(-1);
+    ImGui::InputTextWithHint("##NewLocation", "New location", newName, IM_ARRAYSIZE(newName));
+    ImGui::PopItemWidth();
+    if (ImGui::Button("➕ Add Location", ImVec2(-1, 0)) && newName[0])
+    {
+        int id = addLocation(newName);
+        finish(id > 0, "❌ Location names must be unique.");
+        if (id > 0)
+        {
+            selected = id;
+            newName[0] = '\0';
+        }
+    }
+    ImGui::Separator();
+
+    if (reload)
+    {
+        locations = getLocations();
+        for (const Location &l : locations)
+            requestGlyphs(l.name.c_str());
+    }
+    for (const Location &l : locations)
+    {
+        char label[128];
+        snprintf(label, sizeof(label), "%s (%lld)##%d", l.name.c_str(), l.units, l.id);
+        if (ImGui::Selectable(label, selected == l.id))
+        {
+            selected = l.id;
+            reload = true;
+        }
+    }
+    ImGui::EndChild();
+
+    ImGui::SameLine();
+    ImGui::BeginGroup();
+
+    auto current = std::find_if(locations.begin(), locations.end(), [](const Location &l)
+                                { return l.id == selected; });
+    if (current == locations.end())
+    {
+        ImGui::TextDisabled(locations.empty() ? "Add a location to start tracking stock per warehouse."
+                                              : "Select a location.");
+        ImGui::EndGroup();
+        ImGui::EndGroup();
+        return;
+    }
+
+    if (reload)
+    {
+        stock.clear();
+        for (const LocationStock &s : openLocationStock(selected))
+        {
+            stock.push_back(s);
+            requestGlyphs(s.name.c_str());
+        }
+    }
+
+    ImGui::Text("%s: %d product(s), %lld unit(s)", current->name.c_str(), current->products, current->units);
+
+    ImGui::PushItemWidth(120);
+    ImGui::InputInt("Product ID", &productId);
+    ImGui::SameLine();
+    ImGui::InputInt("Units", &amount);
+    ImGui::PopItemWidth();
+    amount = std::max(amount, 1);
+
+    if (ImGui::Button("Receive"))
+        finish(adjustStock(selected, productId, amount), "❌ Unknown product.");
+    ImGui::SameLine();
+    if (ImGui::Button("Ship"))
+        finish(adjustStock(selected, productId, -amount), "❌ Not that many units here.");
+    ImGui::SameLine();
+
+    // Moving to or from "Unassigned" (ID 0) leaves the product total as it is
+    if (moveTarget == selected)
+        moveTarget = 0;
+    std::string targetName = "Unassigned";
+    for (const Location &l : locations)
+        if (l.id == moveTarget)
+            targetName = l.name;
+    ImGui::PushItemWidth(160);
+    if (ImGui::BeginCombo("##MoveTarget", targetName.c_str()))
+    {
+        if (ImGui::Selectable("Unassigned", moveTarget == 0))
+            moveTarget = 0;
+        for (const Location &l : locations)
+            if (l.id != selected && ImGui::Selectable(l.name.c_str(), moveTarget == l.id))
+                moveTarget = l.id;
+        ImGui::EndCombo();
+    }
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    if (ImGui::Button("Move Here"))
+        finish(transferStock(productId, moveTarget, selected, amount), "❌ Not that many units there.");
+    ImGui::SameLine();
+    if (ImGui::Button("Move Away"))
+        finish(transferStock(productId, selected, moveTarget, amount), "❌ Not that many units here.");
+
+    if (*message)
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), "%s", message);
+    ImGui::Spacing();
+
+    if (ImGui::BeginTable("LocationStock", 4,
+                          ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_Resizable |
+                              ImGuiTableFlags_SizingStretchProp |
+                              ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("🆔 ID", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+        ImGui::TableSetupColumn("📦 Name", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Here", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableSetupColumn("All Locations", ImGuiTableColumnFlags_WidthFixed, 100.0f);
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)stock.size());
+        while (clipper.Step())
+        {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+            {
+                const LocationStock &s = stock[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                if (ImGui::Selectable(std::to_string(s.productId).c_str(), productId == s.productId,
+                                      ImGuiSelectableFlags_SpanAllColumns))
+                    productId = s.productId;
+                ImGui::TableSetColumnIndex(1);
+                ImGui::TextUnformatted(s.name.c_str());
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%d", s.quantity);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%d", s.total);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::EndGroup();
+    ImGui::EndGroup();
+}
+
+void renderDashboard()
+{
+    static InventorySummary summary = {};
+    // Aggregates scan the whole table, so cap them at one reload per second
+    static PanelRefresh refresh = {5.0, 1.0};
+
+    if (refresh.due(ImGui::GetTime()))
+        summary = getInventorySummary();
+
+    ImGui::BeginGroup();
+
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "📊 Inventory Overview");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::BulletText("Products: %d", summary.productCount);
+    ImGui::BulletText("Units in stock: %lld", summary.totalUnits);
+    ImGui::BulletText("Stock value: %s", formatMoney(summary.totalValue).c_str());
+    ImGui::BulletText("Low stock: %d", (int)getStockAlerts().size());
+
+    ImGui::Spacing();
+    ImGui::TextDisabled("Updated %.0f s ago", ImGui::GetTime() - refresh.lastRefresh);
+
+    if (ImGui::CollapsingHeader("💾 Backup"))
+    {
+        static char backupPath[256] = "inventory-backup.db";
+        static int pagesPerStep = 64;
+        const BackupProgress &backup = getBackupProgress();
+
+        ImGui::PushItemWidth(-1);
+        ImGui::InputText("##BackupPath", backupPath, IM_ARRAYSIZE(backupPath));
+        ImGui::SliderInt("##PagesPerStep", &pagesPerStep, 1, 1024, "%d pages per step");
+        ImGui::PopItemWidth();
+
+        if (backup.active)
+        {
+            if (ImGui::Button("Cancel Backup"))
+                cancelBackup();
+
+            int done = backup.totalPages - backup.remainingPages;
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "%d / %d pages", done, backup.totalPages);
+            ImGui::ProgressBar(backup.totalPages > 0 ? (float)done / backup.totalPages : 0.0f,
+                               ImVec2(-1, 0), overlay);
+        }
+        else
+        {
+            if (ImGui::Button("Start Backup"))
+                startBackup(backupPath, pagesPerStep);
+
+            if (backup.succeeded)
+                ImGui::TextColored(ImVec4(0, 1, 0, 1), "✅ Backed up to %s", backup.path.c_str());
+            else if (!backup.error.empty())
+                ImGui::TextColored(ImVec4(1, 0, 0, 1), "❌ Backup failed: %s", backup.error.c_str());
+        }
+
+        // What the backup cost the UI thread: each step runs inside one frame
+        if (backup.steps > 0)
+        {
+            ImGui::BulletText("%d steps (%d retried while locked)", backup.steps, backup.busySteps);
+            ImGui::BulletText("Step time: last %.2f ms, avg %.2f ms, max %.2f ms",
+                              backup.lastStepMs, backup.totalStepMs / backup.steps, backup.maxStepMs);
+        }
+        ImGui::BulletText("Frame time: %.1f ms", 1000.0f / ImGui::GetIO().Framerate);
+    }
+
+    if (ImGui::CollapsingHeader("Diagnostics"))
+    {
+        const FontStats &fonts = getFontStats();
+        ImGui::BulletText("Font atlas: %d glyphs, %dx%d, %.1f KB", fonts.glyphCount,
+                          fonts.texWidth, fonts.texHeight, fonts.texBytes / 1024.0);
+        ImGui::BulletText("Last atlas build: %.1f ms (%d builds, %d glyphs from cache, %s)",
+                          fonts.buildMs, fonts.builds, fonts.cachedGlyphs,
+                          fonts.atlasCached ? "atlas from cache" : "rasterized");
+
+        AuditStats audit = getAuditStats();
+        ImGui::BulletText("Audit log: %lld written, %lld queued, %lld lost, %d batches (last %.1f ms)",
+                          audit.written, audit.queued - audit.written - audit.lost, audit.lost, audit.batches,
+                          audit.lastBatchMs);
+
+        const ContentionStats &locks = getContentionStats();
+        ImGui::BulletText("Lock waits: %lld of %lld writes, %lld retries, %.0f ms waited (longest %.0f ms), %lld failed",
+                          locks.busyEvents, locks.writes, locks.retries, locks.waitedMs, locks.maxWaitMs,
+                          locks.failedWrites);
+
+        SeriesStats series = getSeriesStats();
+        ImGui::BulletText("History series: %lld points, %lld blocks written (%.1f bytes/point), %d open",
+                          series.points, series.blocks,
+                          series.blockPoints ? (double)series.bytes / series.blockPoints : 0.0, series.openBlocks);
+
+        UndoStats undoStats = getUndoStats();
+        ImGui::BulletText("Undo: %d in memory, %d on disk, %d redo (%ld row images)",
+                          undoStats.memoryCommands, undoStats.spilledCommands,
+                          undoStats.redoCommands, undoStats.memoryChanges);
+    }
+
+    ImGui::EndGroup();
+}
+
+void renderScanner()
+{
+    // 0 = receive, 1 = sell, 2 = custom
+    static int mode = 0;
+    static int customDelta = 1;
+
+    ImGui::BeginGroup();
+
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "🏷️ Barcode Scanner");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    bool scanning = isScanMode();
+    if (ImGui::Checkbox("Scan mode", &scanning))
+        setScanMode(scanning);
+
+    if (scanning)
+        ImGui::TextColored(ImVec4(0, 1, 0, 1), "Listening for scans - press Esc to stop.");
+    else
+        ImGui::TextDisabled("Keyboard input goes to the other panels.");
+
+    ImGui::Spacing();
+    ImGui::RadioButton("Receive (+1)", &mode, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("Sell (-1)", &mode, 1);
+    ImGui::SameLine();
+    ImGui::RadioButton("Custom", &mode, 2);
+    if (mode == 2)
+    {
+        ImGui::PushItemWidth(120);
+        ImGui::InputInt("Quantity per scan", &customDelta);
+        ImGui::PopItemWidth();
+    }
+    scanDelta = mode == 0 ? 1 : mode == 1 ? -1 : customDelta;
+
+    ImGui::Spacing();
+
+    const std::deque<ScanResult> &scans = getRecentScans();
+    if (scans.empty())
+    {
+        ImGui::TextDisabled("No scans yet.");
+        ImGui::EndGroup();
+        return;
+    }
+
+    if (ImGui::BeginTable("ScanTable", 4,
+                          ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_SizingStretchProp |
+                              ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupColumn("🏷️ Code", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("🆔 ID", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+        ImGui::TableSetupColumn("🔄 Change", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableSetupColumn("📊 Quantity", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+
+        ImGui::TableHeadersRow();
+
+        for (const ScanResult &scan : scans)
+        {
+            ImGui::TableNextRow();
+
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%s", scan.code.c_str());
+
+            ImGui::TableSetColumnIndex(1);
+            if (scan.productId >= 0)
+                ImGui::Text("%d", scan.productId);
+            else
+                ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "unknown");
+
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%+d", scan.delta);
+
+            ImGui::TableSetColumnIndex(3);
+            if (scan.applied)
+                ImGui::Text("%d", scan.newQuantity);
+            else
+                ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "❌");
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::EndGroup();
+}
+
+void renderHistory()
+{
+    static int productId = 1;
+    static int loadedId = -1;
+    static std::vector<AuditEntry> history;
+    static PanelRefresh refresh = {0.0, 0.5};
+
+    ImGui::BeginGroup();
+
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "🕘 Change History");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::PushItemWidth(160);
+    ImGui::InputInt("Product ID", &productId);
+    ImGui::PopItemWidth();
+
+    // The audit writer lags behind by up to one batch, so reloading flushes it first
+    bool stale = refresh.due(ImGui::GetTime());
+    if (stale || loadedId != productId)
+    {
+        loadedId = productId;
+        history = getProductHistory(productId);
+        for (const auto &e : history)
+            requestGlyphs(e.name.c_str());
+    }
+
+    ImGui::Spacing();
+
+    if (history.empty())
+    {
+        ImGui::TextDisabled("No recorded changes for product %d.", productId);
+        ImGui::EndGroup();
+        return;
+    }
+
+    if (ImGui::BeginTable("HistoryTable", 5,
+                          ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_Resizable |
+                              ImGuiTableFlags_SizingStretchProp |
+                              ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupColumn("🕘 When", ImGuiTableColumnFlags_WidthFixed, 150.0f);
+        ImGui::TableSetupColumn("User", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+        ImGui::TableSetupColumn("Action", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("📊 Quantity", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+        ImGui::TableSetupColumn("💵 Price", ImGuiTableColumnFlags_WidthFixed, 130.0f);
+
+        ImGui::TableHeadersRow();
+
+        for (const AuditEntry &e : history)
+        {
+            ImGui::TableNextRow();
+
+            ImGui::TableSetColumnIndex(0);
+            std::time_t seconds = (std::time_t)(e.changedAt / 1000);
+            char when[32];
+            std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&seconds));
+            ImGui::Text("%s", when);
+
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%s (%s)", e.user.c_str(), e.source.c_str());
+
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%s '%s'", e.action.c_str(), e.name.c_str());
+
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%d -> %d", e.oldQuantity, e.newQuantity);
+
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%s -> %s", formatMoney(e.oldPrice).c_str(), formatMoney(e.newPrice).c_str());
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::EndGroup();
+}
+
+void renderCharts()
+{
+    static int productId = catalogueSeries;
+    static int range = 1;
+    static int metric = 0;
+    static const long long rangeMs[] = {3600000LL, 86400000LL, 7 * 86400000LL, 0};
+
+    static std::vector<std::pair<double, double>> line; // (seconds, value), full resolution
+    static std::vector<std::pair<double, double>> drawn; // downsampled to the canvas width
+    static float drawnWidth = 0.0f;
+    static int loadedId = -1, loadedRange = -1, loadedMetric = -1;
+    static PanelRefresh refresh = {5.0, 1.0};
+
+    ImGui::BeginGroup();
+
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "📈 Stock and Price History");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::PushItemWidth(160);
+    ImGui::InputInt("Product ID (0 = whole catalogue)", &productId);
+    ImGui::Combo("Range", &range, "Last hour\0Last day\0Last week\0All time\0");
+    ImGui::PopItemWidth();
+    if (productId < 0)
+        productId = 0;
+
+    bool catalogue = productId == catalogueSeries;
+    ImGui::RadioButton(catalogue ? "Units" : "Quantity", &metric, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton(catalogue ? "Stock value" : "Price", &metric, 1);
+
+    bool stale = refresh.due(ImGui::GetTime());
+    if (stale || loadedId != productId || loadedRange != range || loadedMetric != metric)
+    {
+        loadedId = productId;
+        loadedRange = range;
+        loadedMetric = metric;
+
+        long long to = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+        long long from = rangeMs[range] ? to - rangeMs[range] : 0;
+
+        line.clear();
+        for (const SeriesPoint &p : querySeries(productId, from, to))
+            line.emplace_back(p.time / 1000.0, metric == 0 ? (double)p.quantity : p.price.toDouble());
+        drawnWidth = 0.0f;
+    }
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    size.y = std::max(size.y - ImGui::GetTextLineHeightWithSpacing(), 120.0f);
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(30, 30, 40, 255), 6.0f);
+    ImGui::InvisibleButton("##ChartCanvas", size);
+
+    if (line.empty())
+    {
+        ImGui::TextDisabled("No recorded changes in this range.");
+        ImGui::EndGroup();
+        return;
+    }
+
+    // One point per horizontal pixel is all the screen can show
+    if (drawnWidth != size.x)
+    {
+        drawn = downsampleLTTB(line, (size_t)std::max(size.x, 3.0f));
+        drawnWidth = size.x;
+    }
+
+    double minX = drawn.front().first, maxX = drawn.back().first;
+    double minY = drawn[0].second, maxY = drawn[0].second;
+    for (const auto &p : drawn)
+    {
+        minY = std::min(minY, p.second);
+        maxY = std::max(maxY, p.second);
+    }
+    if (maxX <= minX)
+        maxX = minX + 1.0;
+    if (maxY <= minY)
+        maxY = minY + 1.0;
+
+    const float pad = 8.0f;
+    std::vector<ImVec2> screen;
+    screen.reserve(drawn.size());
+    for (const auto &p : drawn)
+    {
+        float x = origin.x + pad + (float)((p.first - minX) / (maxX - minX)) * (size.x - 2 * pad);
+        float y = origin.y + size.y - pad - (float)((p.second - minY) / (maxY - minY)) * (size.y - 2 * pad);
+        screen.push_back(ImVec2(x, y));
+    }
+    drawList->AddPolyline(screen.data(), (int)screen.size(), IM_COL32(80, 170, 255, 255), ImDrawFlags_None, 2.0f);
+
+    char label[64];
+    snprintf(label, sizeof(label), "%.2f", maxY);
+    drawList->AddText(ImVec2(origin.x + pad, origin.y + pad), IM_COL32(200, 200, 200, 255), label);
+    snprintf(label, sizeof(label), "%.2f", minY);
+    drawList->AddText(ImVec2(origin.x + pad, origin.y + size.y - pad - ImGui::GetTextLineHeight()),
+                      IM_COL32(200, 200, 200, 255), label);
+
+    ImGui::Text("%d points, %d drawn", (int)line.size(), (int)drawn.size());
+
+    ImGui::EndGroup();
+}
+
+// Statements in db.cpp are laid out over several lines; the table shows
+// them on one
+static std::string singleLine(const std::string &sql)
+{
+    std::string line;
+    for (char c : sql)
+    {
+        bool space = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+        if (!space)
+            line += c;
+        else if (!line.empty() && line.back() != ' ')
+            line += ' ';
+    }
+    if (!line.empty() && line.back() == ' ')
+        line.pop_back();
+    return line;
+}
+
+void renderSlowQueries()
+{
+    static int selected = -1;
+    static std::string dumpStatus;
+
+    ImGui::BeginGroup();
+
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "⏱ Slow Queries");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    bool enabled = getSlowQueryThreshold() >= 0.0;
+    float threshold = (float)std::max(getSlowQueryThreshold(), 0.0);
+    if (ImGui::Checkbox("Record", &enabled))
+        setSlowQueryThreshold(enabled ? threshold : -1.0);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(160);
+    if (ImGui::InputFloat("Threshold (ms)", &threshold, 1.0f, 10.0f, "%.1f") && enabled)
+        setSlowQueryThreshold(std::max(threshold, 0.0f));
+
+    if (ImGui::Button("Clear"))
+    {
+        clearSlowQueries();
+        selected = -1;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("💾 Dump to slow-queries.log"))
+        dumpStatus = dumpSlowQueries("slow-queries.log") ? "Written to slow-queries.log" : "Could not write the log";
+    if (!dumpStatus.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", dumpStatus.c_str());
+    }
+
+    const std::vector<SlowQuery> &queries = getSlowQueries();
+    if (selected >= (int)queries.size())
+        selected = -1;
+
+    // Statements whose plan walks a whole table are the ones to look at
+    auto scansTable = [](const SlowQuery &q)
+    { return q.plan.find("SCAN ") != std::string::npos && q.plan.find("SCAN CONSTANT ROW") == std::string::npos; };
+
+    float planHeight = selected >= 0 ? ImGui::GetTextLineHeightWithSpacing() * 8 : 0.0f;
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
+                            ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("SlowQueries", 6, flags, ImVec2(0, -planHeight)))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Time", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("ms", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Rows", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("VM steps", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Full scan", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Statement", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+
+        // Newest first
+        for (int i = (int)queries.size() - 1; i >= 0; --i)
+        {
+            const SlowQuery &q = queries[i];
+            char when[16];
+            std::strftime(when, sizeof(when), "%H:%M:%S", std::localtime(&q.at));
+
+            ImGui::PushID(i);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (ImGui::Selectable(when, selected == i, ImGuiSelectableFlags_SpanAllColumns))
+                selected = selected == i ? -1 : i;
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", q.ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%lld", q.rows);
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", q.vmSteps);
+            ImGui::TableNextColumn();
+            if (scansTable(q))
+                ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.3f, 1.0f), "%d", q.fullScanSteps);
+            else
+                ImGui::Text("%d", q.fullScanSteps);
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(singleLine(q.sql).c_str());
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+
+    if (selected >= 0)
+    {
+        const SlowQuery &q = queries[selected];
+        ImGui::Text("Sorts %d, auto-index rows %d. Plan:", q.sorts, q.autoIndexRows);
+        ImGui::BeginChild("Plan", ImVec2(0, 0), ImGuiChildFlags_Borders);
+        ImGui::TextUnformatted(q.plan.empty() ? "(no plan)" : q.plan.c_str());
+        ImGui::EndChild();
+    }
+    else if (queries.empty())
+        ImGui::TextDisabled("Nothing slower than %.1f ms so far.", threshold);
+
+    ImGui::EndGroup();
+}
+
+// Category tree, loaded one level at a time: a node's subcategories and
+// products are only queried when it is expanded, and kept until the data
+// changes. Totals come from the cached subtree aggregates, so a collapsed
+// node with a million products below it costs one row.
+struct CategoryTree
+{
+    std::vector<Category> top;
+    std::map<int, std::vector<Category>> children; // by parent ID
+    std::map<int, std::vector<Product>> products;  // filed directly under a category
+    int selected = 0;
+};
+
+static const size_t categoryProductLimit = 200;
+
+static void renderCategoryNode(CategoryTree &tree, const Category &c)
+{
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_SpanFullWidth;
+    if (c.children == 0 && c.products == 0)
+        flags |= ImGuiTreeNodeFlags_Leaf;
+    if (tree.selected == c.id)
+        flags |= ImGuiTreeNodeFlags_Selected;
+    bool open = ImGui::TreeNodeEx((void *)(intptr_t)c.id, flags, "📁 %s", c.name.c_str());
+    if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
+        tree.selected = c.id;
+
+    ImGui::TableSetColumnIndex(1);
+    ImGui::Text("%d", c.products);
+    ImGui::TableSetColumnIndex(2);
+    ImGui::Text("%lld", c.units);
+    ImGui::TableSetColumnIndex(3);
+    ImGui::Text("%s", formatMoney(c.value).c_str());
+
+    if (!open)
+        return;
+
+    auto sub = tree.children.find(c.id);
+    if (sub == tree.children.end())
+    {
+        sub = tree.children.emplace(c.id, getCategoryChildren(c.id)).first;
+        for (const Category &child : sub->second)
+            requestGlyphs(child.name.c_str());
+    }
+    for (const Category &child : sub->second)
+        renderCategoryNode(tree, child);
+
+    auto direct = tree.products.find(c.id);
+    if (direct == tree.products.end())
+    {
+        direct = tree.products.emplace(c.id, std::vector<Product>()).first;
+        Cursor<Product> cursor = openCategoryProducts(c.id);
+        // One more than shown, to know whether to say so
+        while (direct->second.size() <= categoryProductLimit && cursor.next())
+        {
+            direct->second.push_back(cursor.current());
+            requestGlyphs(cursor.current().name.c_str());
+        }
+    }
+    const std::vector<Product> &items = direct->second;
+    for (size_t i = 0; i < std::min(items.size(), categoryProductLimit); ++i)
+    {
+        const Product &p = items[i];
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TreeNodeEx((void *)(intptr_t)-p.id, ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen,
+                          "🆔 %d  %s", p.id, p.name.c_str());
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%d", p.quantity);
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%s", formatMoney(Money::fromCents(p.price.cents * p.quantity)).c_str());
+    }
+    if (items.size() > categoryProductLimit)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextDisabled("(more products; see the product list)");
+    }
+    ImGui::TreePop();
+}
+
+void renderCategories()
+{
+    static CategoryTree tree;
+    static InventorySummary summary = {0, 0, {}};
+    static char newName[128] = "";
+    static int productId = 1;
+    static const char *message = "";
+    static PanelRefresh refresh = {5.0, 0.25};
+
+    // Everything below the top level reloads lazily as nodes are drawn
+    if (refresh.due(ImGui::GetTime()))
+    {
+        tree.top = getCategoryChildren(0);
+        tree.children.clear();
+        tree.products.clear();
+        summary = getInventorySummary();
+        for (const Category &c : tree.top)
+            requestGlyphs(c.name.c_str());
+        if (tree.selected && getCategory(tree.selected).id < 0)
+            tree.selected = 0;
+    }
+    auto finish = [&](bool ok, const char *failure)
+    {
+        message = ok ? "" : failure;
+        refresh.lastRefresh = -1.0e9;
+    };
+
+    ImGui::BeginGroup();
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "📁 Categories");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    std::string selectedPath = tree.selected ? getCategoryPath(tree.selected) : "";
+    ImGui::Text("Selected: %s", tree.selected ? selectedPath.c_str() : "(top level)");
+
+    ImGui::PushItemWidth(220);
+    ImGui::InputTextWithHint("##NewCategory", "New category (or A/B/C)", newName, IM_ARRAYSIZE(newName));
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    if (ImGui::Button("➕ Add Here") && newName[0])
+    {
+        std::string path = tree.selected ? selectedPath + "/" + newName : newName;
+        finish(addCategoryPath(path) > 0, "❌ Could not add that category.");
+        newName[0] = '\0';
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("🗑 Delete") && tree.selected)
+        finish(deleteCategory(tree.selected), "❌ Only empty categories can be deleted.");
+
+    ImGui::PushItemWidth(120);
+    ImGui::InputInt("Product ID", &productId);
+    ImGui::PopItemWidth();
+    ImGui::SameLine();
+    if (ImGui::Button("🏷 File Under Selected"))
+        finish(setProductCategory(productId, tree.selected), "❌ Unknown product.");
+
+    if (*message)
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), "%s", message);
+    ImGui::Spacing();
+
+    if (ImGui::BeginTable("CategoryTree", 4,
+                          ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_Resizable |
+                              ImGuiTableFlags_SizingStretchProp |
+                              ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("📦 Category", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Products", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableSetupColumn("Units", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+        ImGui::TableSetupColumn("💵 Value", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+        ImGui::TableHeadersRow();
+
+        int products = 0;
+        long long units = 0;
+        Money value;
+        for (const Category &c : tree.top)
+        {
+            renderCategoryNode(tree, c);
+            products += c.products;
+            units += c.units;
+            value += c.value;
+        }
+
+        // Whatever the top level does not account for is uncategorized
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        if (ImGui::Selectable("(uncategorized)", tree.selected == 0, ImGuiSelectableFlags_SpanAllColumns))
+            tree.selected = 0;
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%d", summary.productCount - products);
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%lld", summary.totalUnits - units);
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%s", formatMoney(Money::fromCents(summary.totalValue.cents - value.cents)).c_str());
+
+        ImGui::EndTable();
+    }
+
+    ImGui::EndGroup();
+}
+
+void renderLots()
+{
+    static int productId = 1;
+    static int shownProduct = -1;
+    static std::vector<Lot> lots;
+    static std::string today;
+    static long long available = 0;
+    static char code[32] = "";
+    static char expires[16] = "";
+    static int receiveQuantity = 1;
+    static int orderQuantity = 1;
+    static std::vector<LotPick> picks;
+    static const char *message = "";
+    static PanelRefresh refresh = {30.0, 0.25};
+
+    bool reload = refresh.due(ImGui::GetTime()) || productId != shownProduct;
+    auto finish = [&](bool ok, const char *failure)
+    {
+        message = ok ? "" : failure;
+        reload = true;
+    };
+
+    ImGui::BeginGroup();
+    ImGui::TextColored(ImVec4(0.2f, 0.8f, 1.0f, 1.0f), "🕘 Lots and Expiry");
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::PushItemWidth(120);
+    ImGui::InputInt("Product ID", &productId);
+    ImGui::PopItemWidth();
+
+    ImGui::PushItemWidth(110);
+    ImGui::InputTextWithHint("##LotCode", "Lot code", code, IM_ARRAYSIZE(code));
+    ImGui::SameLine();
+    ImGui::InputTextWithHint("##LotExpires", "YYYY-MM-DD", expires, IM_ARRAYSIZE(expires));
+    ImGui::SameLine();
+    ImGui::InputInt("Units##Receive", &receiveQuantity);
+    ImGui::PopItemWidth();
+    receiveQuantity = std::max(receiveQuantity, 1);
+    ImGui::SameLine();
+    if (ImGui::Button("➕ Receive Lot"))
+        finish(receiveLot(productId, code, expires, receiveQuantity) > 0,
+               "❌ Unknown product or invalid date (YYYY-MM-DD, or empty if it does not expire).");
+
+    ImGui::PushItemWidth(110);
+    ImGui::InputInt("Units##Allocate", &orderQuantity);
+    ImGui::PopItemWidth();
+    orderQuantity = std::max(orderQuantity, 1);
+    ImGui::SameLine();
+    if (ImGui::Button("📦 Allocate (FEFO)"))
+    {
+        picks.clear();
+        finish(allocateFefo(productId, orderQuantity, todayDate(), picks),
+               "❌ Not enough unexpired stock in lots. Nothing was allocated.");
+    }
+
+    if (reload)
+    {
+        shownProduct = productId;
+        today = todayDate();
+        lots.clear();
+        for (const Lot &lot : openProductLots(productId))
+        {
+            lots.push_back(lot);
+            requestGlyphs(lot.code.c_str());
+        }
+        available = availableUnits(productId, today);
+    }
+
+    if (*message)
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), "%s", message);
+    for (const LotPick &p : picks)
+        ImGui::TextColored(ImVec4(0, 1, 0, 1), "✅ Pick %d from lot %s (%s)", p.quantity, p.code.c_str(),
+                           p.expires.empty() ? "no expiry" : p.expires.c_str());
+    ImGui::Text("%lld unit(s) can be allocated today", available);
+    ImGui::Spacing();
+
+    if (ImGui::BeginTable("Lots", 4,
+                          ImGuiTableFlags_Borders |
+                              ImGuiTableFlags_RowBg |
+                              ImGuiTableFlags_SizingStretchProp |
+                              ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("🆔 Lot", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+        ImGui::TableSetupColumn("🏷 Code", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("🕘 Expires", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+        ImGui::TableSetupColumn("📦 Units", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableHeadersRow();
+
+        for (const Lot &lot : lots)
+        {
+            bool expired = !lot.expires.empty() && lot.expires < today;
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%d", lot.id);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextUnformatted(lot.code.c_str());
+            ImGui::TableSetColumnIndex(2);
+            if (expired)
+                ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "%s ⚠", lot.expires.c_str());
+            else
+                ImGui::TextUnformatted(lot.expires.empty() ? "-" : lot.expires.c_str());
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%d", lot.quantity);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::EndGroup();
+}
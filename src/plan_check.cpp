@@ -0,0 +1,289 @@
+#include "plan_check.hpp"
+#include "allocation.hpp"
+#include "db.hpp"
+#include "http_server.hpp"
+#include "query_log.hpp"
+#include "seed.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct PlanCheck
+{
+    const char *name;
+    int scansAllowed;     // whole-table scans one call may make
+    double budgetMs;      // average per call; per 100k rows when scalesWithRows
+    bool scalesWithRows;
+    std::function<void(int id)> run;
+    const char *mustUse = nullptr; // plan fragment that has to appear
+};
+
+// The HTTP read pool prepares its statements on connections of its own, so
+// they are explained rather than traced
+struct PooledPlan
+{
+    const char *name;
+    int scansAllowed;
+    const char *mustUse;
+};
+
+static const PooledPlan pooledPlans[] = {
+    {"byId", 0, "USING INTEGER PRIMARY KEY"},
+    {"all", 1, nullptr},
+    {"search", 1, nullptr}, // contains-match
+    {"lowStock", 0, "idx_products_low_stock"},
+    {"summary", 1, nullptr},
+};
+
+template <typename Entity>
+static void drain(Cursor<Entity> cursor)
+{
+    for (const Entity &e : cursor)
+        (void)e;
+}
+
+// A bare "SCAN products" reads every row; scanning an index ("SCAN products
+// USING COVERING INDEX ...") reads only the rows that index holds
+static bool isFullScan(const std::string &line)
+{
+    size_t start = line.find_first_not_of(' ');
+    if (start == std::string::npos || line.compare(start, 5, "SCAN ") != 0)
+        return line.find("AUTOMATIC") != std::string::npos;
+    return line.find(" USING ") == std::string::npos && line.find("CONSTANT ROW") == std::string::npos;
+}
+
+static std::vector<std::string> planLines(const std::string &plan)
+{
+    std::vector<std::string> lines;
+    size_t start = 0;
+    for (size_t end; (end = plan.find('\n', start)) != std::string::npos; start = end + 1)
+        lines.push_back(plan.substr(start, end - start));
+    return lines;
+}
+
+// Scans beyond the allowance, and a missing mustUse, go into problems
+static void checkPlan(const std::string &sql, const std::string &plan, int &scans, bool &used, const char *mustUse,
+                      std::vector<std::string> &scanLines)
+{
+    for (const std::string &line : planLines(plan))
+    {
+        if (isFullScan(line))
+        {
+            ++scans;
+            scanLines.push_back(line + "  <-  " + sql);
+        }
+        if (mustUse && line.find(mustUse) != std::string::npos)
+            used = true;
+    }
+}
+
+static void judgePlan(int scans, int scansAllowed, bool used, const char *mustUse,
+                      const std::vector<std::string> &scanLines, std::vector<std::string> &problems)
+{
+    if (scans > scansAllowed)
+        for (const std::string &line : scanLines)
+            problems.push_back(line);
+    if (mustUse && !used)
+        problems.push_back(std::string("plan never uses ") + mustUse);
+}
+
+int runPlanChecks(const PlanCheckOptions &options)
+{
+    removeDatabaseFiles(options.dbPath);
+    if (!initDB(options.dbPath) || !seedCatalogue(options.rows))
+    {
+        std::cerr << "Failed to seed " << options.dbPath << std::endl;
+        return 1;
+    }
+
+    int rows = options.rows;
+    int added = 0;
+    int location = addLocation("Plan check");
+    int category = addCategoryPath("Plan/Check/Leaf");
+    int checkParent = getCategory(category).parentId;
+    int otherParent = addCategoryPath("Plan/Other");
+
+    // Budgets are several times a laptop's timings: they catch a lookup
+    // turning into a scan, not noise. Write transactions are not
+    // committed per call, so disk syncs are not what gets measured.
+    const std::vector<PlanCheck> checks = {
+        {"getProductById", 0, 0.5, false, [](int id)
+         { getProductById(id); }},
+        {"updateProduct", 0, 0.5, false, [](int id)
+         {
+             Product p = {id, "Checked " + std::to_string(id), id % 500, Money::fromCents(id), 10,
+                          "SKU" + std::to_string(100000 + id - 1)};
+             updateProduct(p);
+         }},
+        {"updateProductIfUnchanged", 0, 0.5, false, [](int id)
+         {
+             Product p = getProductById(id), current;
+             p.quantity += 1;
+             updateProductIfUnchanged(p, current);
+         }},
+        {"adjustQuantity", 0, 0.5, false, [](int id)
+         { adjustQuantity(id, 1); }},
+        {"deleteProduct+restoreProduct", 0, 1.0, false, [](int id)
+         {
+             Product p = getProductById(id);
+             if (p.id == id && deleteProduct(id))
+                 restoreProduct(p);
+         }},
+        {"addProduct", 0, 0.5, false, [&added](int)
+         { addProduct({0, "Added " + std::to_string(added), 1, Money::fromCents(100), 0,
+                       "CHK" + std::to_string(added++)}); }},
+        {"openSkus", 0, 250.0, true, [](int)
+         {
+             for (const SkuEntry &s : openSkus())
+                 (void)s;
+         }},
+        {"openLowStockProducts", 0, 250.0, true, [](int)
+         { drain(openLowStockProducts()); }},
+        {"adjustStock", 0, 0.5, false, [location](int id)
+         { adjustStock(location, id, 1); }},
+        // A move from unassigned stock and back again
+        {"transferStock", 0, 1.0, false, [location](int id)
+         {
+             if (transferStock(id, 0, location, 1))
+                 transferStock(id, location, 0, 1);
+         }},
+        {"getLocations", 1, 0.5, false, [](int)
+         { getLocations(); }},
+        {"getProductStock", 0, 0.5, false, [](int id)
+         { getProductStock(id); }},
+        {"openLocationStock", 0, 250.0, true, [location](int)
+         { drain(openLocationStock(location)); }},
+        // Filing a product walks the closure table for both the old and the
+        // new category's ancestors
+        {"setProductCategory", 0, 0.5, false, [category](int id)
+         { setProductCategory(id, category); }},
+        // Moving a subtree rewrites its closure rows and both sets of
+        // ancestors' totals
+        {"moveCategory", 0, 1.0, false, [category, checkParent, otherParent](int)
+         { moveCategory(category, getCategory(category).parentId == checkParent ? otherParent : checkParent); }},
+        {"getCategoryChildren", 0, 0.5, false, [](int)
+         { getCategoryChildren(0); }},
+        {"getCategoryPath", 0, 0.5, false, [category](int)
+         { getCategoryPath(category); }},
+        {"openCategoryProducts", 0, 50.0, false, [category](int)
+         { drain(openCategoryProducts(category)); }},
+        // Allocation reads a product's lots through the partial index once,
+        // then works from its heap
+        {"receiveLot", 0, 0.5, false, [](int id)
+         { receiveLot(id, "PC", "2099-01-01", 5); }},
+        {"allocateFefo", 0, 0.5, false, [](int id)
+         {
+             std::vector<LotPick> picks;
+             allocateFefo(id, 1, "2000-01-01", picks);
+         }},
+        {"consumeLots", 0, 1.0, false, [](int id)
+         {
+             int lot = receiveLot(id, "PC", "2099-01-01", 2);
+             if (lot > 0)
+                 consumeLots(id, {{lot, id, "", "", 1}});
+         }},
+        {"openProductLots", 0, 0.5, false, [](int id)
+         { drain(openProductLots(id)); }},
+        {"openProducts", 1, 500.0, true, [](int)
+         { drain(openProducts()); }},
+        // A contains-match cannot use an index; a numeric keyword adds a
+        // primary key lookup, not a second scan
+        {"openProductSearch(name)", 1, 300.0, true, [](int)
+         { drain(openProductSearch("Widget 1")); }},
+        {"openProductSearch(id)", 1, 300.0, true, [](int id)
+         { drain(openProductSearch(std::to_string(id))); },
+         "USING INTEGER PRIMARY KEY"},
+        {"getInventorySummary", 1, 150.0, true, [](int)
+         { getInventorySummary(); }},
+    };
+
+    std::mt19937 rng(7);
+    auto randomId = [&rng, rows]
+    { return rows > 0 ? (int)(rng() % rows) + 1 : 1; };
+
+    int failures = 0;
+    std::printf("%-30s %-7s %10s %10s  %s\n", "operation", "result", "avg ms", "budget", "plan");
+    for (const PlanCheck &check : checks)
+    {
+        // Plans: catch every statement the operation issues
+        setSlowQueryThreshold(0.0);
+        clearSlowQueries();
+        beginTransaction();
+        check.run(randomId());
+        commitTransaction();
+
+        std::vector<std::string> problems, scanLines;
+        std::string firstPlan;
+        int scans = 0;
+        bool used = false;
+        for (const SlowQuery &q : getSlowQueries())
+        {
+            if (firstPlan.empty())
+                firstPlan = q.plan.substr(0, q.plan.find('\n'));
+            checkPlan(q.sql, q.plan, scans, used, check.mustUse, scanLines);
+        }
+        judgePlan(scans, check.scansAllowed, used, check.mustUse, scanLines, problems);
+
+        // Timing, without the tracing overhead
+        setSlowQueryThreshold(-1.0);
+        int calls = check.scalesWithRows ? 3 : options.iterations;
+        beginTransaction();
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < calls; ++i)
+            check.run(randomId());
+        double avgMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / calls;
+        commitTransaction();
+
+        double budget = check.scalesWithRows ? check.budgetMs * std::max(rows, 1) / 100000.0 : check.budgetMs;
+        if (avgMs > budget)
+            problems.push_back("too slow: " + std::to_string(avgMs) + " ms per call");
+
+        std::printf("%-30s %-7s %10.3f %10.3f  %s\n", check.name, problems.empty() ? "ok" : "FAIL", avgMs, budget,
+                    firstPlan.empty() ? "(no plan)" : firstPlan.c_str());
+        for (const std::string &problem : problems)
+            std::printf("    %s\n", problem.c_str());
+        failures += !problems.empty();
+    }
+
+    int total = (int)checks.size();
+    for (const PooledStatement &statement : readPoolStatements())
+    {
+        std::string name = std::string("pool ") + statement.name;
+        const PooledPlan *expected = nullptr;
+        for (const PooledPlan &plan : pooledPlans)
+            if (std::strcmp(plan.name, statement.name) == 0)
+                expected = &plan;
+
+        std::vector<std::string> problems, scanLines;
+        std::string plan = explainQueryPlan(statement.sql);
+        int scans = 0;
+        bool used = false;
+        if (!expected)
+            problems.push_back("no plan expectations for this statement");
+        else
+        {
+            checkPlan(statement.sql, plan, scans, used, expected->mustUse, scanLines);
+            judgePlan(scans, expected->scansAllowed, used, expected->mustUse, scanLines, problems);
+        }
+
+        std::printf("%-30s %-7s %10s %10s  %s\n", name.c_str(), problems.empty() ? "ok" : "FAIL", "-", "-",
+                    plan.substr(0, plan.find('\n')).c_str());
+        for (const std::string &problem : problems)
+            std::printf("    %s\n", problem.c_str());
+        failures += !problems.empty();
+        ++total;
+    }
+
+    closeDB();
+    removeDatabaseFiles(options.dbPath);
+
+    std::printf("%d of %d checks failed\n", failures, total);
+    return failures ? 1 : 0;
+}
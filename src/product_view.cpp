@@ -0,0 +1,289 @@
+#include "product_view.hpp"
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+// Below this many rows one thread is faster than starting several
+static const size_t parallelThreshold = 65536;
+
+struct SortEntry
+{
+    uint64_t key;
+    uint32_t position; // index into the rows being sorted
+};
+
+static unsigned workerCount(size_t n)
+{
+    if (n < parallelThreshold)
+        return 1;
+    unsigned hw = std::thread::hardware_concurrency();
+    return std::max(1u, std::min(hw ? hw : 1u, 8u));
+}
+
+// Run fn(begin, end) over `workers` contiguous slices of [0, n)
+template <typename F>
+static void parallelSlices(size_t n, unsigned workers, F fn)
+{
+    if (workers <= 1)
+    {
+        fn(size_t(0), n);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned w = 0; w < workers; ++w)
+        threads.emplace_back(fn, n * w / workers, n * (w + 1) / workers);
+    for (std::thread &t : threads)
+        t.join();
+}
+
+std::string collationKey(const std::string &text)
+{
+    std::string key = text;
+    for (char &c : key)
+        if (c >= 'A' && c <= 'Z')
+            c = (char)(c - 'A' + 'a');
+    return key;
+}
+
+// Bytes [offset, offset + 8) of a collation key, big-endian, zero padded
+static uint64_t prefixKey(const std::string &collated, size_t offset = 0)
+{
+    uint64_t key = 0;
+    for (size_t i = offset; i < offset + 8; ++i)
+        key = (key << 8) | (i < collated.size() ? (unsigned char)collated[i] : 0);
+    return key;
+}
+
+// Signed values sort correctly as unsigned once the sign bit is flipped
+static uint64_t numberKey(long long value)
+{
+    return (uint64_t)value ^ (1ULL << 63);
+}
+
+// LSD radix sort on 8-bit digits. All eight histograms come from one read
+// of the keys, and digits that are the same in every key are skipped, so
+// small IDs or quantities cost two or three passes, not eight.
+static void radixSort(SortEntry *begin, SortEntry *end, SortEntry *scratch)
+{
+    size_t n = (size_t)(end - begin);
+    if (n < 2)
+        return;
+
+    std::vector<size_t> counts(8 * 256, 0);
+    for (size_t i = 0; i < n; ++i)
+        for (int digit = 0; digit < 8; ++digit)
+            ++counts[digit * 256 + ((begin[i].key >> (digit * 8)) & 0xFF)];
+
+    SortEntry *from = begin, *to = scratch;
+    for (int digit = 0; digit < 8; ++digit)
+    {
+        size_t *count = &counts[digit * 256];
+        int shift = digit * 8;
+        if (count[(from[0].key >> shift) & 0xFF] == n)
+            continue;
+
+        size_t offset = 0;
+        for (int b = 0; b < 256; ++b)
+        {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i)
+            to[count[(from[i].key >> shift) & 0xFF]++] = from[i];
+        std::swap(from, to);
+    }
+
+    if (from != begin)
+        std::copy(from, from + n, begin);
+}
+
+// Rows whose keys tie share their first `offset` collation bytes. Sort each
+// run of ties on the next 8 bytes, and so on until the strings run out.
+static void refineTies(SortEntry *entries, SortEntry *scratch, size_t n, const std::vector<std::string> &collated,
+                       size_t offset, bool descending)
+{
+    for (size_t i = 0; i < n;)
+    {
+        size_t j = i + 1;
+        while (j < n && entries[j].key == entries[i].key)
+            ++j;
+
+        bool longer = false;
+        for (size_t k = i; k < j && !longer && j - i > 1; ++k)
+            longer = collated[entries[k].position].size() > offset;
+
+        if (longer)
+        {
+            for (size_t k = i; k < j; ++k)
+            {
+                uint64_t key = prefixKey(collated[entries[k].position], offset);
+                entries[k].key = descending ? ~key : key;
+            }
+            // Short runs are not worth the radix histograms
+            if (j - i < 64)
+                std::stable_sort(entries + i, entries + j, [](const SortEntry &a, const SortEntry &b)
+                                 { return a.key < b.key; });
+            else
+                radixSort(entries + i, entries + j, scratch + i);
+            refineTies(entries + i, scratch + i, j - i, collated, offset + 8, descending);
+        }
+        i = j;
+    }
+}
+
+void sortRows(const std::vector<Product> &products, std::vector<uint32_t> &rows, SortColumn column, bool descending)
+{
+    size_t n = rows.size();
+    if (n < 2)
+        return;
+
+    bool text = column == SortColumn::Name || column == SortColumn::Sku;
+    unsigned workers = workerCount(n);
+    std::vector<SortEntry> entries(n), scratch(n);
+    std::vector<std::string> collated(text ? n : 0);
+
+    parallelSlices(n, workers, [&](size_t begin, size_t end)
+                   {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Product &p = products[rows[i]];
+            uint64_t key;
+            switch (column)
+            {
+            case SortColumn::Id: key = numberKey(p.id); break;
+            case SortColumn::Quantity: key = numberKey(p.quantity); break;
+            case SortColumn::Price: key = numberKey(p.price.cents); break;
+            default:
+                collated[i] = collationKey(column == SortColumn::Name ? p.name : p.sku);
+                key = prefixKey(collated[i]);
+                break;
+            }
+            entries[i] = {descending ? ~key : key, (uint32_t)i};
+        }
+        radixSort(entries.data() + begin, entries.data() + end, scratch.data() + begin); });
+
+    // Merge the sorted slices pairwise; std::merge takes from the left slice
+    // first on ties, which keeps the sort stable
+    std::vector<size_t> bounds;
+    for (unsigned w = 0; w <= workers; ++w)
+        bounds.push_back(n * w / workers);
+
+    while (bounds.size() > 2)
+    {
+        std::vector<size_t> merged;
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2)
+        {
+            merged.push_back(bounds[i]);
+            if (i + 2 >= bounds.size())
+            {
+                std::copy(entries.begin() + bounds[i], entries.begin() + bounds[i + 1], scratch.begin() + bounds[i]);
+                continue;
+            }
+            threads.emplace_back([&, i]
+                                 { std::merge(entries.begin() + bounds[i], entries.begin() + bounds[i + 1],
+                                              entries.begin() + bounds[i + 1], entries.begin() + bounds[i + 2],
+                                              scratch.begin() + bounds[i],
+                                              [](const SortEntry &a, const SortEntry &b)
+                                              { return a.key < b.key; }); });
+        }
+        for (std::thread &t : threads)
+            t.join();
+        merged.push_back(n);
+        bounds = std::move(merged);
+        entries.swap(scratch);
+    }
+
+    // Equal 8-byte prefixes: continue on the following bytes
+    if (text)
+        refineTies(entries.data(), scratch.data(), n, collated, 8, descending);
+
+    std::vector<uint32_t> sorted(n);
+    for (size_t i = 0; i < n; ++i)
+        sorted[i] = rows[entries[i].position];
+    rows.swap(sorted);
+}
+
+template <typename Key, typename KeyOf, typename LabelOf>
+static std::vector<ProductGroup> hashGroup(const std::vector<Product> &products, const std::vector<uint32_t> &rows,
+                                           KeyOf keyOf, LabelOf labelOf)
+{
+    using Table = std::unordered_map<Key, ProductGroup>;
+    unsigned workers = workerCount(rows.size());
+    std::vector<Table> tables(workers);
+
+    for (unsigned w = 0; w < workers; ++w)
+        tables[w].reserve(64);
+
+    std::vector<std::thread> threads;
+    auto groupSlice = [&](unsigned w)
+    {
+        Table &table = tables[w];
+        size_t begin = rows.size() * w / workers, end = rows.size() * (w + 1) / workers;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Product &p = products[rows[i]];
+            ProductGroup &g = table[keyOf(p)];
+            if (g.products == 0)
+                g.label = labelOf(p);
+            g.products++;
+            g.units += p.quantity;
+            g.value += p.price * p.quantity;
+        }
+    };
+    for (unsigned w = 1; w < workers; ++w)
+        threads.emplace_back(groupSlice, w);
+    groupSlice(0);
+    for (std::thread &t : threads)
+        t.join();
+
+    Table &merged = tables[0];
+    for (unsigned w = 1; w < workers; ++w)
+        for (auto &entry : tables[w])
+        {
+            auto it = merged.find(entry.first);
+            if (it == merged.end())
+            {
+                merged.emplace(entry.first, std::move(entry.second));
+                continue;
+            }
+            it->second.products += entry.second.products;
+            it->second.units += entry.second.units;
+            it->second.value += entry.second.value;
+        }
+
+    std::vector<std::pair<Key, ProductGroup>> ordered(std::make_move_iterator(merged.begin()),
+                                                       std::make_move_iterator(merged.end()));
+    std::sort(ordered.begin(), ordered.end(), [](const auto &a, const auto &b)
+              { return a.first < b.first; });
+
+    std::vector<ProductGroup> groups;
+    groups.reserve(ordered.size());
+    for (auto &entry : ordered)
+        groups.push_back(std::move(entry.second));
+    return groups;
+}
+
+static std::string firstWord(const std::string &name)
+{
+    return name.substr(0, name.find(' '));
+}
+
+std::vector<ProductGroup> groupRows(const std::vector<Product> &products, const std::vector<uint32_t> &rows,
+                                   GroupColumn column)
+{
+    switch (column)
+    {
+    case GroupColumn::Price:
+        return hashGroup<long long>(products, rows, [](const Product &p) { return p.price.cents; },
+                                    [](const Product &p) { return formatMoney(p.price); });
+    case GroupColumn::ReorderLevel:
+        return hashGroup<int>(products, rows, [](const Product &p) { return p.reorderLevel; },
+                              [](const Product &p) { return std::to_string(p.reorderLevel); });
+    default:
+        return hashGroup<std::string>(products, rows, [](const Product &p) { return collationKey(firstWord(p.name)); },
+                                      [](const Product &p) { return firstWord(p.name); });
+    }
+}
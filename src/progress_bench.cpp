@@ -0,0 +1,169 @@
+#include "progress_bench.hpp"
+#include "db.hpp"
+#include "query_pump.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double msBetween(Clock::time_point from, Clock::time_point to)
+{
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Input events as the GUI would get them: queued by another thread,
+// seen only when the querying thread looks
+struct InputFeed
+{
+    std::mutex mutex;
+    std::vector<Clock::time_point> pending;
+    std::atomic<bool> stop{false};
+    std::vector<double> latencies;
+
+    void run()
+    {
+        while (!stop.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(Clock::now());
+        }
+    }
+
+    void drain()
+    {
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Clock::time_point sent : pending)
+            latencies.push_back(msBetween(sent, now));
+        pending.clear();
+    }
+};
+
+// Times one statement through the app's connection
+static bool timedSpin(long long rows, double &ms)
+{
+    Clock::time_point start = Clock::now();
+    bool ok = runSpinQuery(rows);
+    ms = msBetween(start, Clock::now());
+    return ok;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5))];
+}
+
+static void printLatencies(const char *label, double ms, const InputFeed &feed, const QueryPumpStats &stats)
+{
+    std::printf("%-18s %9.2f %8zu %9.3f %9.3f %9.3f %14lld %8lld\n", label, ms / 1000.0, feed.latencies.size(),
+                percentile(feed.latencies, 0.5), percentile(feed.latencies, 0.99),
+                feed.latencies.empty() ? 0.0 : *std::max_element(feed.latencies.begin(), feed.latencies.end()),
+                stats.calls, stats.pumps);
+}
+
+int runProgressBench(const ProgressBenchOptions &options)
+{
+    // The same connection setup, progress handler and pump as the GUI; only
+    // the pump's work differs (draining the feed instead of SDL and GL)
+    if (!initDB(":memory:"))
+    {
+        std::cerr << "Cannot open an in-memory database" << std::endl;
+        return 1;
+    }
+
+    // Size the statement to the requested length
+    const long long probe = 1000000;
+    double calibrationMs;
+    if (!timedSpin(probe, calibrationMs))
+    {
+        std::cerr << "Benchmark query failed" << std::endl;
+        closeDB();
+        return 1;
+    }
+    long long count = std::max(probe, (long long)(probe * options.seconds * 1000.0 / std::max(calibrationMs, 0.001)));
+
+    QueryPumpTiming timing;
+    std::printf("pump after %.0f ms blocked, at most every %.1f ms, handler every %d instructions\n\n",
+                timing.showAfterSeconds * 1000.0, timing.redrawSeconds * 1000.0, options.instructions);
+    std::printf("%-18s %9s %8s %9s %9s %9s %14s %8s\n", "", "run s", "events", "p50 ms", "p99 ms", "max ms",
+                "handler calls", "pumps");
+
+    // 1: nothing looks at input until the statement is done
+    {
+        InputFeed feed;
+        std::thread input(&InputFeed::run, &feed);
+        double ms;
+        bool ok = timedSpin(count, ms);
+        feed.stop = true;
+        input.join();
+        feed.drain();
+        printLatencies("no handler", ms, feed, {0, 0});
+        if (!ok)
+        {
+            closeDB();
+            return 1;
+        }
+    }
+
+    // 2: the shipped pump drains input as the statement runs
+    double handledMs;
+    {
+        InputFeed feed;
+        startQueryPump([&feed](double)
+                       { feed.drain(); },
+                       timing, options.instructions);
+        std::thread input(&InputFeed::run, &feed);
+        bool ok = timedSpin(count, handledMs);
+        feed.stop = true;
+        input.join();
+        feed.drain();
+        QueryPumpStats stats = getQueryPumpStats();
+        stopQueryPump();
+        printLatencies("query pump", handledMs, feed, stats);
+        if (!ok || takeQueryCancelled())
+        {
+            std::printf("query pump: statement did not finish\n");
+            closeDB();
+            return 1;
+        }
+    }
+
+    // 3: cancel from the input thread a third of the way in, the way the
+    // overlay's Cancel button does
+    {
+        Clock::time_point requested;
+        startQueryPump([](double) {}, timing, options.instructions);
+        std::thread input([&]
+                          {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(handledMs / 3));
+            requested = Clock::now();
+            requestQueryCancel(); });
+        bool finished = runSpinQuery(count);
+        Clock::time_point stopped = Clock::now();
+        input.join();
+        stopQueryPump();
+
+        bool cancelled = takeQueryCancelled();
+        if (finished || !cancelled)
+        {
+            std::printf("cancel: statement was not interrupted\n");
+            closeDB();
+            return 1;
+        }
+        std::printf("cancel: statement stopped %.3f ms after the request (takeQueryCancelled)\n",
+                    msBetween(requested, stopped));
+    }
+
+    closeDB();
+    return 0;
+}
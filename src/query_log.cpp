@@ -0,0 +1,241 @@
+#include "query_log.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+static const size_t maxEntries = 256;
+
+static sqlite3 *connection = nullptr;
+static double thresholdMs = 10.0;
+static std::vector<SlowQuery> entries;
+static std::vector<std::string> planSources; // statement text to explain, per entry (empty once done)
+static std::unordered_map<std::string, std::string> plans;
+static bool explaining = false; // our own EXPLAIN statements are not traced
+
+// Rows returned so far by each running statement. Almost every row belongs
+// to the same statement as the one before, so that one is counted outside
+// the map.
+static sqlite3_stmt *rowStatement = nullptr;
+static long long rowCount = 0;
+static std::unordered_map<sqlite3_stmt *, long long> otherRowCounts;
+
+static long long takeRowCount(sqlite3_stmt *stmt)
+{
+    if (stmt == rowStatement)
+    {
+        rowStatement = nullptr;
+        return rowCount;
+    }
+    auto it = otherRowCounts.find(stmt);
+    if (it == otherRowCounts.end())
+        return 0;
+    long long rows = it->second;
+    otherRowCounts.erase(it);
+    return rows;
+}
+
+static void countRow(sqlite3_stmt *stmt)
+{
+    if (stmt == rowStatement)
+    {
+        ++rowCount;
+        return;
+    }
+    if (rowStatement)
+        otherRowCounts[rowStatement] = rowCount;
+    rowStatement = stmt;
+    auto it = otherRowCounts.find(stmt);
+    rowCount = 1;
+    if (it != otherRowCounts.end())
+    {
+        rowCount += it->second;
+        otherRowCounts.erase(it);
+    }
+}
+
+static void recordStatement(sqlite3_stmt *stmt, double ms)
+{
+    // Counters are reset on every run so each one is measured on its own
+    SlowQuery entry = {};
+    entry.rows = takeRowCount(stmt);
+    entry.vmSteps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+    entry.fullScanSteps = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    entry.sorts = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+    entry.autoIndexRows = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+    if (ms < thresholdMs)
+        return;
+
+    entry.at = std::time(nullptr);
+    entry.ms = ms;
+    char *expanded = sqlite3_expanded_sql(stmt);
+    entry.sql = expanded ? expanded : sqlite3_sql(stmt);
+    sqlite3_free(expanded);
+
+    // EXPLAIN cannot run from inside the trace callback; it is done the
+    // next time the log is read
+    if (entries.size() == maxEntries)
+    {
+        entries.erase(entries.begin());
+        planSources.erase(planSources.begin());
+    }
+    entries.push_back(std::move(entry));
+    planSources.push_back(sqlite3_sql(stmt));
+}
+
+static int traceCallback(unsigned type, void *, void *p, void *x)
+{
+    if (explaining)
+        return 0;
+
+    sqlite3_stmt *stmt = (sqlite3_stmt *)p;
+    if (type == SQLITE_TRACE_ROW)
+        countRow(stmt);
+    else if (type == SQLITE_TRACE_PROFILE)
+        recordStatement(stmt, *(sqlite3_int64 *)x / 1e6);
+    return 0;
+}
+
+static void installTrace()
+{
+    if (!connection)
+        return;
+    if (thresholdMs < 0)
+        sqlite3_trace_v2(connection, 0, nullptr, nullptr);
+    else
+        sqlite3_trace_v2(connection, SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, traceCallback, nullptr);
+}
+
+// EXPLAIN QUERY PLAN rows form a tree through their parent ids
+static std::string explainPlan(const std::string &sql)
+{
+    auto cached = plans.find(sql);
+    if (cached != plans.end())
+        return cached->second;
+
+    std::string plan;
+    sqlite3_stmt *stmt;
+    explaining = true;
+    if (sqlite3_prepare_v2(connection, ("EXPLAIN QUERY PLAN " + sql).c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        std::unordered_map<int, int> depth;
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            int id = sqlite3_column_int(stmt, 0);
+            int parent = sqlite3_column_int(stmt, 1);
+            int level = parent ? depth[parent] + 1 : 0;
+            depth[id] = level;
+            plan += std::string(level * 2, ' ') + (const char *)sqlite3_column_text(stmt, 3) + "\n";
+        }
+        sqlite3_finalize(stmt);
+    }
+    else
+        plan = std::string("(no plan: ") + sqlite3_errmsg(connection) + ")\n";
+    explaining = false;
+
+    plans.emplace(sql, plan);
+    return plan;
+}
+
+static void explainPending()
+{
+    if (!connection)
+        return;
+    for (size_t i = 0; i < entries.size(); ++i)
+        if (!planSources[i].empty())
+        {
+            entries[i].plan = explainPlan(planSources[i]);
+            planSources[i].clear();
+        }
+}
+
+std::string explainQueryPlan(const std::string &sql)
+{
+    return connection ? explainPlan(sql) : std::string();
+}
+
+void attachQueryLog(sqlite3 *db)
+{
+    connection = db;
+    installTrace();
+}
+
+void detachQueryLog()
+{
+    explainPending();
+    if (connection)
+        sqlite3_trace_v2(connection, 0, nullptr, nullptr);
+    connection = nullptr;
+    rowStatement = nullptr;
+    otherRowCounts.clear();
+    plans.clear();
+}
+
+void setSlowQueryThreshold(double ms)
+{
+    thresholdMs = ms;
+    installTrace();
+}
+
+double getSlowQueryThreshold()
+{
+    return thresholdMs;
+}
+
+const std::vector<SlowQuery> &getSlowQueries()
+{
+    explainPending();
+    return entries;
+}
+
+void clearSlowQueries()
+{
+    entries.clear();
+    planSources.clear();
+    plans.clear();
+}
+
+// Each line of text indented, without the blank lines around statements
+// written as raw string literals
+static void writeIndented(std::ostream &out, const std::string &text, const char *indent)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = std::min(text.find('\n', start), text.size());
+        if (text.find_first_not_of(" \t\r", start) < end)
+            out << indent << text.substr(start, end - start) << "\n";
+        start = end + 1;
+    }
+}
+
+void writeSlowQueries(std::ostream &out)
+{
+    for (const SlowQuery &q : getSlowQueries())
+    {
+        char header[160];
+        char when[32];
+        std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&q.at));
+        std::snprintf(header, sizeof(header),
+                      "%s  %.2f ms  rows %lld  vm steps %d  full scan steps %d  sorts %d  auto-index rows %d\n", when,
+                      q.ms, q.rows, q.vmSteps, q.fullScanSteps, q.sorts, q.autoIndexRows);
+        out << header;
+        writeIndented(out, q.sql, "  ");
+        writeIndented(out, q.plan.empty() ? "(no plan)" : q.plan, "    ");
+        out << "\n";
+    }
+}
+
+bool dumpSlowQueries(const std::string &path)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    writeSlowQueries(out);
+    return (bool)out;
+}
@@ -0,0 +1,66 @@
+#include "query_pump.hpp"
+#include "db.hpp"
+#include <atomic>
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+static QueryPump pump;
+static QueryPumpTiming timing;
+static Clock::time_point frameStart;
+static Clock::time_point lastPump;
+static std::atomic<bool> cancelRequested{false};
+static QueryPumpStats stats = {0, 0};
+
+static bool onQueryProgress()
+{
+    ++stats.calls;
+    if (cancelRequested.load(std::memory_order_relaxed))
+        return false;
+
+    Clock::time_point now = Clock::now();
+    double blocked = std::chrono::duration<double>(now - frameStart).count();
+    if (blocked < timing.showAfterSeconds || std::chrono::duration<double>(now - lastPump).count() < timing.redrawSeconds)
+        return true;
+
+    lastPump = now;
+    ++stats.pumps;
+    pump(blocked);
+    return !cancelRequested.load(std::memory_order_relaxed);
+}
+
+void startQueryPump(QueryPump newPump, const QueryPumpTiming &newTiming, int instructions)
+{
+    pump = std::move(newPump);
+    timing = newTiming;
+    stats = {0, 0};
+    beginPumpFrame();
+    setQueryProgressHandler(onQueryProgress, instructions);
+}
+
+void stopQueryPump()
+{
+    setQueryProgressHandler(nullptr);
+    pump = nullptr;
+}
+
+void beginPumpFrame()
+{
+    frameStart = Clock::now();
+    cancelRequested = false;
+}
+
+void requestQueryCancel()
+{
+    cancelRequested = true;
+}
+
+bool queryCancelRequested()
+{
+    return cancelRequested.load(std::memory_order_relaxed);
+}
+
+QueryPumpStats getQueryPumpStats()
+{
+    return stats;
+}
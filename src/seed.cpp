@@ -0,0 +1,30 @@
+#include "seed.hpp"
+#include "db.hpp"
+#include <cstdio>
+#include <random>
+
+bool seedCatalogue(int rows)
+{
+    static const char *const words[] = {"Widget", "Gadget", "Bolt", "Cable", "Adapter", "Filter", "Sensor", "Valve"};
+    std::mt19937 rng(42);
+
+    if (!beginTransaction())
+        return false;
+    for (int i = 0; i < rows; ++i)
+    {
+        Product p = {0, std::string(words[rng() % 8]) + " " + std::to_string(i), (int)(rng() % 500),
+                     Money::fromCents(rng() % 100000), (int)(rng() % 3) * 10, "SKU" + std::to_string(100000 + i)};
+        if (!addProduct(p))
+        {
+            rollbackTransaction();
+            return false;
+        }
+    }
+    return commitTransaction();
+}
+
+void removeDatabaseFiles(const std::string &path)
+{
+    for (const char *suffix : {"", "-wal", "-shm", "-journal", "-turnstile", ".undo", ".audit", ".series"})
+        std::remove((path + suffix).c_str());
+}
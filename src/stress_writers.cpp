@@ -0,0 +1,368 @@
+#include "stress_writers.hpp"
+#include "db.hpp"
+#include "seed.hpp"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Write latencies in power-of-two microsecond buckets, so the processes'
+// histograms can simply be added up
+static const int latencyBuckets = 32;
+
+struct WriterReport
+{
+    long long committed;    // changes that made it into the file
+    long long failed;       // changes lost to a failed write or commit
+    long long reads;
+    long long conflicts;    // optimistic edits that found the row changed and retried
+    long long unitsAdded;   // sum of the committed quantity deltas
+    long long latency[latencyBuckets];
+    ContentionStats contention;
+};
+
+static void addLatency(WriterReport &report, double ms)
+{
+    int bucket = 0;
+    for (long long us = (long long)(ms * 1000.0); us > 1 && bucket < latencyBuckets - 1; us >>= 1)
+        ++bucket;
+    ++report.latency[bucket];
+}
+
+// Upper bound of the bucket holding the p-th percentile, in ms
+static double latencyPercentile(const WriterReport &report, double p)
+{
+    long long total = 0;
+    for (long long n : report.latency)
+        total += n;
+    long long seen = 0;
+    for (int b = 0; b < latencyBuckets; ++b)
+    {
+        seen += report.latency[b];
+        if (total && seen >= p * total)
+            return (1LL << (b + 1)) / 1000.0;
+    }
+    return 0.0;
+}
+
+static void pause(double ms)
+{
+    if (ms > 0)
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+// One read-modify-write of a product's quantity, the way the Update tab does
+// it: read the row, spend editMs on it, save the whole row back
+static bool editProduct(const WriterStressOptions &options, int id, int delta, WriterReport &report)
+{
+    if (options.mode == WriteMode::Blind)
+    {
+        Product p = getProductById(id);
+        pause(options.editMs);
+        p.quantity += delta;
+        return p.id >= 0 && updateProduct(p);
+    }
+
+    // Pessimistic: the write lock is held from the read to the commit
+    if (options.mode == WriteMode::Pessimistic)
+    {
+        if (!beginTransaction())
+            return false;
+        Product p = getProductById(id);
+        pause(options.editMs);
+        p.quantity += delta;
+        if (p.id >= 0 && updateProduct(p) && commitTransaction())
+            return true;
+        rollbackTransaction();
+        return false;
+    }
+
+    // Optimistic: nothing is locked while editing. On a conflict the change
+    // is applied again to the newer row, as the merge view's "Both" does.
+    Product p = getProductById(id);
+    pause(options.editMs);
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        Product edited = p;
+        edited.quantity += delta;
+        switch (updateProductIfUnchanged(edited, p))
+        {
+        case UpdateResult::Updated:
+            return true;
+        case UpdateResult::Conflict:
+            ++report.conflicts;
+            break;
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+// Called with the database open; the clock starts once every process is ready
+static WriterReport runWriter(const WriterStressOptions &options, int process)
+{
+    WriterReport report = {};
+    std::mt19937 rng(1000 + process);
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                    std::chrono::duration<double>(options.seconds));
+    int batch = std::max(1, options.writesPerTransaction);
+
+    while (Clock::now() < deadline)
+    {
+        // Readers hold the file too, which is what makes COMMIT wait
+        if (rng() % 5 == 0)
+        {
+            getProductById((int)(rng() % options.rows) + 1);
+            ++report.reads;
+            continue;
+        }
+
+        pause(options.pauseMs);
+
+        Clock::time_point start = Clock::now();
+        if (options.mode != WriteMode::Adjust)
+        {
+            int delta = (int)(rng() % 5) + 1;
+            bool ok = editProduct(options, (int)(rng() % options.rows) + 1, delta, report);
+            addLatency(report, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            ++(ok ? report.committed : report.failed);
+            report.unitsAdded += ok ? delta : 0;
+            continue;
+        }
+
+        long long units = 0;
+        bool ok = batch == 1 || beginTransaction();
+        for (int i = 0; ok && i < batch; ++i)
+        {
+            int delta = (int)(rng() % 5) + 1;
+            ok = adjustQuantity((int)(rng() % options.rows) + 1, delta);
+            units += delta;
+        }
+        if (batch > 1)
+        {
+            if (ok)
+                ok = commitTransaction();
+            if (!ok)
+                rollbackTransaction();
+        }
+        addLatency(report, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+        if (ok)
+        {
+            report.committed += batch;
+            report.unitsAdded += units;
+        }
+        else
+            report.failed += batch;
+    }
+
+    report.contention = getContentionStats();
+    return report;
+}
+
+// Seeds the database, runs the writer processes and sums their reports.
+// unitsChange is how much the stored stock actually moved; perProcess gets
+// each process's committed changes (-1 for one that died). False if the run
+// could not be set up or a process failed; the report is not usable then.
+static bool runProcesses(const WriterStressOptions &options, bool printProcesses, WriterReport &total,
+                         long long &unitsChange, std::vector<long long> &perProcess)
+{
+    total = {};
+    unitsChange = 0;
+    perProcess.assign(options.processes, -1);
+
+    removeDatabaseFiles(options.dbPath);
+    if (!initDB(options.dbPath) || !seedCatalogue(options.rows))
+    {
+        std::cerr << "Failed to seed " << options.dbPath << std::endl;
+        return false;
+    }
+    long long unitsBefore = getInventorySummary().totalUnits;
+    closeDB();
+
+    // Children start with no open connection and each reports back through a
+    // pipe. They open the database first and then wait on the start pipe, which
+    // reads end-of-file for all of them at once when the parent closes it, so
+    // opening does not race against writers that are already running.
+    int start[2];
+    if (pipe(start) != 0)
+    {
+        std::cerr << "Cannot create a pipe" << std::endl;
+        return false;
+    }
+    std::vector<pid_t> children;
+    std::vector<int> pipes;
+    for (int p = 0; p < options.processes; ++p)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+            break;
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(fds[0]);
+            close(start[1]);
+            bool opened = initDB(options.dbPath);
+            char go;
+            while (read(start[0], &go, 1) > 0)
+                ;
+            if (!opened)
+                _exit(1);
+            WriterReport report = runWriter(options, p);
+            closeDB();
+            ssize_t written = write(fds[1], &report, sizeof(report));
+            _exit(written == (ssize_t)sizeof(report) ? 0 : 1);
+        }
+        close(fds[1]);
+        if (pid < 0)
+        {
+            close(fds[0]);
+            break;
+        }
+        children.push_back(pid);
+        pipes.push_back(fds[0]);
+    }
+    close(start[0]);
+    close(start[1]);
+
+    bool complete = children.size() == (size_t)options.processes;
+    if (printProcesses)
+        std::printf("%8s %10s %8s %8s %10s %8s %8s %10s %10s\n", "process", "committed", "failed", "reads",
+                    "lock waits", "retries", "gave up", "waited ms", "max wait");
+    for (size_t i = 0; i < children.size(); ++i)
+    {
+        WriterReport report;
+        bool received = read(pipes[i], &report, sizeof(report)) == (ssize_t)sizeof(report);
+        close(pipes[i]);
+        int exitStatus = 0;
+        waitpid(children[i], &exitStatus, 0);
+        if (!received || !WIFEXITED(exitStatus) || WEXITSTATUS(exitStatus) != 0)
+        {
+            std::printf("%8zu  failed without a report\n", i);
+            complete = false;
+            continue;
+        }
+
+        perProcess[i] = report.committed;
+        const ContentionStats &c = report.contention;
+        if (printProcesses)
+            std::printf("%8zu %10lld %8lld %8lld %10lld %8lld %8lld %10.1f %10.1f\n", i, report.committed,
+                        report.failed, report.reads, c.busyEvents, c.retries, c.gaveUp, c.waitedMs, c.maxWaitMs);
+
+        total.committed += report.committed;
+        total.failed += report.failed;
+        total.reads += report.reads;
+        total.conflicts += report.conflicts;
+        total.unitsAdded += report.unitsAdded;
+        for (int b = 0; b < latencyBuckets; ++b)
+            total.latency[b] += report.latency[b];
+        total.contention.busyEvents += c.busyEvents;
+        total.contention.retries += c.retries;
+        total.contention.gaveUp += c.gaveUp;
+        total.contention.waitedMs += c.waitedMs;
+        total.contention.maxWaitMs = std::max(total.contention.maxWaitMs, c.maxWaitMs);
+    }
+
+    if (initDB(options.dbPath))
+    {
+        unitsChange = getInventorySummary().totalUnits - unitsBefore;
+        closeDB();
+    }
+    else
+        complete = false;
+    removeDatabaseFiles(options.dbPath);
+    return complete;
+}
+
+int runWriterStress(const WriterStressOptions &options)
+{
+    WriterReport total;
+    long long unitsChange;
+    std::vector<long long> perProcess;
+    if (!runProcesses(options, true, total, unitsChange, perProcess))
+    {
+        std::cerr << "Stress run failed" << std::endl;
+        return 1;
+    }
+    int status = 0;
+
+    long long attempted = total.committed + total.failed;
+    std::printf("\n%d processes, %d change(s) per transaction, %.1f s\n", options.processes,
+                std::max(1, options.writesPerTransaction), options.seconds);
+    std::printf("throughput:   %.0f committed changes/s, %.0f reads/s\n", total.committed / options.seconds,
+                total.reads / options.seconds);
+    std::printf("failure rate: %.3f%% (%lld of %lld changes)\n", attempted ? 100.0 * total.failed / attempted : 0.0,
+                total.failed, attempted);
+    std::printf("lock waits:   %lld, %lld retries, %lld gave up, %.1f ms waited (longest %.1f ms)\n",
+                total.contention.busyEvents, total.contention.retries, total.contention.gaveUp,
+                total.contention.waitedMs, total.contention.maxWaitMs);
+    std::printf("write time:   p50 <= %.2f ms, p99 <= %.2f ms\n", latencyPercentile(total, 0.5),
+                latencyPercentile(total, 0.99));
+
+    // Totals hide a process that never gets the lock, so each one has to
+    // reach a minimum share of the average
+    long long slowest = *std::min_element(perProcess.begin(), perProcess.end());
+    long long fastest = *std::max_element(perProcess.begin(), perProcess.end());
+    double mean = (double)total.committed / options.processes;
+    bool fair = slowest >= 0 && slowest >= options.minShare * mean;
+    std::printf("per process:  min %.0f/s, max %.0f/s, slowest at %.0f%% of the mean (%s, needs %.0f%%)\n",
+                slowest / options.seconds, fastest / options.seconds, mean > 0 ? 100.0 * slowest / mean : 0.0,
+                fair ? "ok" : "STARVED", 100.0 * options.minShare);
+    if (!fair)
+        status = 1;
+
+    // Every committed change must be in the file, and nothing else
+    bool consistent = unitsChange == total.unitsAdded;
+    std::printf("consistency:  %s (units +%lld, committed +%lld)\n", consistent ? "ok" : "MISMATCH", unitsChange,
+                total.unitsAdded);
+    return consistent ? status : 1;
+}
+
+int runEditBench(const WriterStressOptions &options)
+{
+    std::printf("%d processes editing %d products, %.1f ms per edit, %.1f s per mode\n\n", options.processes,
+                options.rows, options.editMs, options.seconds);
+    std::printf("%-12s %9s %8s %10s %10s %10s %9s %9s %14s\n", "", "edits/s", "failed", "conflicts", "lock waits",
+                "waited ms", "p50 ms", "p99 ms", "lost updates");
+
+    const struct
+    {
+        WriteMode mode;
+        const char *label;
+    } modes[] = {{WriteMode::Blind, "blind"}, {WriteMode::Pessimistic, "pessimistic"}, {WriteMode::Optimistic, "optimistic"}};
+
+    int status = 0;
+    for (const auto &m : modes)
+    {
+        WriterStressOptions run = options;
+        run.mode = m.mode;
+        WriterReport total;
+        long long unitsChange;
+        std::vector<long long> perProcess;
+        if (!runProcesses(run, false, total, unitsChange, perProcess))
+        {
+            std::printf("%-12s failed\n", m.label);
+            status = 1;
+            continue;
+        }
+
+        // Units that edits reported saved but a concurrent save overwrote
+        long long lost = total.unitsAdded - unitsChange;
+        std::printf("%-12s %9.0f %8lld %10lld %10lld %10.1f %9.2f %9.2f %14lld\n", m.label,
+                    total.committed / options.seconds, total.failed, total.conflicts, total.contention.busyEvents,
+                    total.contention.waitedMs, latencyPercentile(total, 0.5), latencyPercentile(total, 0.99), lost);
+
+        // Losing updates is exactly what the locking modes are for
+        if (m.mode != WriteMode::Blind && lost != 0)
+            status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,477 @@
+#include "timeseries.hpp"
+#include "db.hpp"
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+
+// Points per block, and how many partially filled blocks may stay in memory
+// before they are all written out (bulk imports touch every product once)
+static const int blockCapacity = 128;
+static const size_t maxOpenBlocks = 10000;
+
+// ---------------------------------------------------------------------------
+// Bit streams
+
+class BitWriter
+{
+public:
+    void write(uint64_t value, int bits)
+    {
+        for (int i = bits - 1; i >= 0; --i)
+        {
+            if (bitCount % 8 == 0)
+                bytes.push_back(0);
+            if ((value >> i) & 1)
+                bytes.back() |= (uint8_t)(0x80 >> (bitCount % 8));
+            ++bitCount;
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    size_t bitCount = 0;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t *data, size_t size) : data(data), bitSize(size * 8) {}
+
+    uint64_t read(int bits)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bits; ++i)
+        {
+            if (pos >= bitSize)
+            {
+                overrun = true;
+                return 0;
+            }
+            value = (value << 1) | ((data[pos / 8] >> (7 - pos % 8)) & 1);
+            ++pos;
+        }
+        return value;
+    }
+
+    bool overrun = false;
+
+private:
+    const uint8_t *data;
+    size_t bitSize;
+    size_t pos = 0;
+};
+
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// ---------------------------------------------------------------------------
+// Gorilla codec. Timestamps: delta-of-delta in 0/7/9/12/64-bit buckets.
+// Values: XOR with the previous value; identical values cost one bit, and
+// changes reuse the previous leading/trailing-zero window when they fit.
+
+struct XorWindow
+{
+    int leading = -1;
+    int trailing = 0;
+};
+
+static void writeXor(BitWriter &w, uint64_t previous, uint64_t value, XorWindow &window)
+{
+    uint64_t x = previous ^ value;
+    if (x == 0)
+    {
+        w.write(0, 1);
+        return;
+    }
+
+    int leading = __builtin_clzll(x);
+    int trailing = __builtin_ctzll(x);
+    if (window.leading >= 0 && leading >= window.leading && trailing >= window.trailing)
+    {
+        w.write(0b10, 2);
+        w.write(x >> window.trailing, 64 - window.leading - window.trailing);
+        return;
+    }
+
+    int length = 64 - leading - trailing;
+    w.write(0b11, 2);
+    w.write((uint64_t)leading, 6);
+    w.write((uint64_t)(length - 1), 6);
+    w.write(x >> trailing, length);
+    window = {leading, trailing};
+}
+
+static uint64_t readXor(BitReader &r, uint64_t previous, XorWindow &window)
+{
+    if (r.read(1) == 0)
+        return previous;
+
+    if (r.read(1) == 0)
+    {
+        int length = 64 - window.leading - window.trailing;
+        return previous ^ (r.read(length) << window.trailing);
+    }
+
+    int leading = (int)r.read(6);
+    int length = (int)r.read(6) + 1;
+    window = {leading, 64 - leading - length};
+    return previous ^ (r.read(length) << window.trailing);
+}
+
+static void writeDeltaOfDelta(BitWriter &w, int64_t dod)
+{
+    uint64_t z = zigzag(dod);
+    if (z == 0)
+        w.write(0, 1);
+    else if (z < (1u << 7))
+        w.write((0b10ull << 7) | z, 9);
+    else if (z < (1u << 9))
+        w.write((0b110ull << 9) | z, 12);
+    else if (z < (1u << 12))
+        w.write((0b1110ull << 12) | z, 16);
+    else
+    {
+        w.write(0b1111, 4);
+        w.write(z, 64);
+    }
+}
+
+static int64_t readDeltaOfDelta(BitReader &r)
+{
+    int prefix = 0;
+    while (prefix < 4 && r.read(1) == 1)
+        ++prefix;
+    static const int widths[] = {0, 7, 9, 12, 64};
+    return prefix == 0 ? 0 : unzigzag(r.read(widths[prefix]));
+}
+
+struct OpenBlock
+{
+    BitWriter bits;
+    int count = 0;
+    long long startTime = 0;
+    long long previousTime = 0;
+    long long previousDelta = 0;
+    uint64_t previousQuantity = 0;
+    uint64_t previousCents = 0;
+    XorWindow quantityWindow;
+    XorWindow priceWindow;
+
+    void append(const SeriesPoint &p)
+    {
+        uint64_t quantity = (uint64_t)p.quantity;
+        uint64_t cents = (uint64_t)p.price.cents;
+
+        if (count == 0)
+        {
+            startTime = p.time;
+            bits.write((uint64_t)p.time, 64);
+            bits.write(quantity, 64);
+            bits.write(cents, 64);
+        }
+        else
+        {
+            long long delta = p.time - previousTime;
+            writeDeltaOfDelta(bits, delta - previousDelta);
+            writeXor(bits, previousQuantity, quantity, quantityWindow);
+            writeXor(bits, previousCents, cents, priceWindow);
+            previousDelta = delta;
+        }
+
+        previousTime = p.time;
+        previousQuantity = quantity;
+        previousCents = cents;
+        ++count;
+    }
+};
+
+static bool decodeBlock(const uint8_t *data, size_t size, int count, std::vector<SeriesPoint> &out)
+{
+    BitReader r(data, size);
+    XorWindow quantityWindow, priceWindow;
+    long long time = 0, delta = 0;
+    uint64_t quantity = 0, cents = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (i == 0)
+        {
+            time = (long long)r.read(64);
+            quantity = r.read(64);
+            cents = r.read(64);
+        }
+        else
+        {
+            delta += readDeltaOfDelta(r);
+            time += delta;
+            quantity = readXor(r, quantity, quantityWindow);
+            cents = readXor(r, cents, priceWindow);
+        }
+        if (r.overrun)
+            return false;
+        out.push_back({time, (long long)quantity, Money::fromCents((long long)cents)});
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Storage
+
+static sqlite3 *seriesDB = nullptr;
+static sqlite3_stmt *insertBlock = nullptr;
+static std::unordered_map<int, OpenBlock> openBlocks;
+static int observerHandle = 0;
+
+// Running catalogue totals for series 0
+static long long catalogueUnits = 0;
+static Money catalogueValue;
+
+static SeriesStats stats = {};
+
+static long long nowMs()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+// A block that fails to write stays open and is tried again at the next flush
+static bool writeBlock(int productId, const OpenBlock &block)
+{
+    sqlite3_bind_int(insertBlock, 1, productId);
+    sqlite3_bind_int64(insertBlock, 2, block.startTime);
+    sqlite3_bind_int64(insertBlock, 3, block.previousTime);
+    sqlite3_bind_int(insertBlock, 4, block.count);
+    sqlite3_bind_blob(insertBlock, 5, block.bits.bytes.data(), (int)block.bits.bytes.size(), SQLITE_STATIC);
+    bool written = sqlite3_step(insertBlock) == SQLITE_DONE;
+    if (!written)
+        std::cerr << "Failed to write series block: " << sqlite3_errmsg(seriesDB) << std::endl;
+    sqlite3_reset(insertBlock);
+    return written;
+}
+
+static void countBlock(const OpenBlock &block)
+{
+    stats.blocks++;
+    stats.bytes += (long long)block.bits.bytes.size();
+    stats.blockPoints += block.count;
+}
+
+static void append(int productId, const SeriesPoint &point)
+{
+    OpenBlock &block = openBlocks[productId];
+    block.append(point);
+    stats.points++;
+
+    if (block.count >= blockCapacity)
+    {
+        if (writeBlock(productId, block))
+        {
+            countBlock(block);
+            openBlocks.erase(productId);
+        }
+    }
+    else if (openBlocks.size() > maxOpenBlocks)
+    {
+        flushSeries();
+    }
+}
+
+static void onProductChange(const ProductChange &change)
+{
+    long long now = nowMs();
+    const Product &before = change.before;
+    const Product &after = change.after;
+
+    if (after.id >= 0)
+        append(after.id, {now, after.quantity, after.price});
+
+    if (before.id >= 0)
+    {
+        catalogueUnits -= before.quantity;
+        catalogueValue -= before.price * before.quantity;
+    }
+    if (after.id >= 0)
+    {
+        catalogueUnits += after.quantity;
+        catalogueValue += after.price * after.quantity;
+    }
+    append(catalogueSeries, {now, catalogueUnits, catalogueValue});
+}
+
+bool initSeries(const std::string &dbPath)
+{
+    if (observerHandle)
+        return true;
+
+    std::string path = dbPath + ".series";
+    const char *schema = R"(
+        PRAGMA journal_mode=WAL;
+        CREATE TABLE IF NOT EXISTS series_blocks (
+            product_id INTEGER NOT NULL,
+            start_ms INTEGER NOT NULL,
+            end_ms INTEGER NOT NULL,
+            count INTEGER NOT NULL,
+            data BLOB NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_series_product_time ON series_blocks(product_id, start_ms);
+    )";
+
+    // Several terminals share the store; the schema and flushes wait for
+    // each other the way the audit log does
+    if (sqlite3_open(path.c_str(), &seriesDB) != SQLITE_OK ||
+        sqlite3_busy_timeout(seriesDB, 5000) != SQLITE_OK ||
+        sqlite3_exec(seriesDB, schema, nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(seriesDB, "INSERT INTO series_blocks (product_id, start_ms, end_ms, count, data) VALUES (?, ?, ?, ?, ?);",
+                           -1, &insertBlock, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Failed to open series store: " << sqlite3_errmsg(seriesDB) << std::endl;
+        sqlite3_close(seriesDB);
+        seriesDB = nullptr;
+        return false;
+    }
+
+    InventorySummary summary = getInventorySummary();
+    catalogueUnits = summary.totalUnits;
+    catalogueValue = summary.totalValue;
+
+    observerHandle = addProductObserver(onProductChange);
+    return true;
+}
+
+void flushSeries()
+{
+    if (!seriesDB || openBlocks.empty())
+        return;
+
+    // IMMEDIATE takes the write lock (waiting on the busy timeout) before
+    // anything is written; a block is only dropped once it is committed
+    bool ok = sqlite3_exec(seriesDB, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    for (auto it = openBlocks.begin(); ok && it != openBlocks.end(); ++it)
+        ok = writeBlock(it->first, it->second);
+    if (ok && sqlite3_exec(seriesDB, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK)
+    {
+        for (const auto &entry : openBlocks)
+            countBlock(entry.second);
+        openBlocks.clear();
+        return;
+    }
+
+    std::cerr << "Failed to flush series blocks: " << sqlite3_errmsg(seriesDB) << std::endl;
+    sqlite3_exec(seriesDB, "ROLLBACK;", nullptr, nullptr, nullptr);
+}
+
+void shutdownSeries()
+{
+    if (!observerHandle)
+        return;
+
+    removeProductObserver(observerHandle);
+    observerHandle = 0;
+
+    flushSeries();
+    sqlite3_finalize(insertBlock);
+    sqlite3_close(seriesDB);
+    insertBlock = nullptr;
+    seriesDB = nullptr;
+}
+
+std::vector<SeriesPoint> querySeries(int productId, long long from, long long to)
+{
+    std::vector<SeriesPoint> points;
+    if (!seriesDB)
+        return points;
+
+    // Only blocks overlapping the range are read and decoded
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT count, data FROM series_blocks"
+                      " WHERE product_id = ? AND start_ms <= ? AND end_ms >= ? ORDER BY start_ms;";
+    if (sqlite3_prepare_v2(seriesDB, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_int(stmt, 1, productId);
+        sqlite3_bind_int64(stmt, 2, to);
+        sqlite3_bind_int64(stmt, 3, from);
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const uint8_t *data = static_cast<const uint8_t *>(sqlite3_column_blob(stmt, 1));
+            if (!decodeBlock(data, (size_t)sqlite3_column_bytes(stmt, 1), sqlite3_column_int(stmt, 0), points))
+                std::cerr << "Skipping damaged series block for product " << productId << std::endl;
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // Plus whatever has not been written yet
+    auto open = openBlocks.find(productId);
+    if (open != openBlocks.end())
+        decodeBlock(open->second.bits.bytes.data(), open->second.bits.bytes.size(), open->second.count, points);
+
+    std::vector<SeriesPoint> inRange;
+    for (const SeriesPoint &p : points)
+        if (p.time >= from && p.time <= to)
+            inRange.push_back(p);
+    return inRange;
+}
+
+std::vector<std::pair<double, double>> downsampleLTTB(const std::vector<std::pair<double, double>> &points,
+                                                      size_t threshold)
+{
+    size_t n = points.size();
+    if (threshold >= n || threshold < 3)
+        return points;
+
+    std::vector<std::pair<double, double>> sampled;
+    sampled.reserve(threshold);
+    sampled.push_back(points[0]);
+
+    // First and last points are kept; the rest is split into threshold - 2 buckets
+    double bucketSize = (double)(n - 2) / (threshold - 2);
+    size_t selected = 0;
+
+    for (size_t bucket = 0; bucket < threshold - 2; ++bucket)
+    {
+        size_t start = (size_t)(bucket * bucketSize) + 1;
+        size_t end = (size_t)((bucket + 1) * bucketSize) + 1;
+
+        // Average of the next bucket (the last point for the final one) is
+        // the third corner of the triangle
+        size_t nextStart = std::min(end, n - 1);
+        size_t nextEnd = std::max(std::min((size_t)((bucket + 2) * bucketSize) + 1, n), nextStart + 1);
+        double avgX = 0.0, avgY = 0.0;
+        for (size_t i = nextStart; i < nextEnd; ++i)
+        {
+            avgX += points[i].first;
+            avgY += points[i].second;
+        }
+        avgX /= (double)(nextEnd - nextStart);
+        avgY /= (double)(nextEnd - nextStart);
+
+        const auto &a = points[selected];
+        double maxArea = -1.0;
+        size_t best = start;
+        for (size_t i = start; i < end; ++i)
+        {
+            double area = std::fabs((a.first - avgX) * (points[i].second - a.second) -
+                                    (a.first - points[i].first) * (avgY - a.second));
+            if (area > maxArea)
+            {
+                maxArea = area;
+                best = i;
+            }
+        }
+
+        sampled.push_back(points[best]);
+        selected = best;
+    }
+
+    sampled.push_back(points[n - 1]);
+    return sampled;
+}
+
+SeriesStats getSeriesStats()
+{
+    SeriesStats s = stats;
+    s.openBlocks = (int)openBlocks.size();
+    return s;
+}
@@ -0,0 +1,195 @@
+// Headless UI benchmark. Seeds a catalogue of each requested size, then
+// drives the real panels through Dear ImGui with no platform or renderer
+// backend: the frame is built and tessellated exactly as in the app, only
+// never drawn. Reports CPU time per frame and the geometry it would submit.
+#include "gui.hpp"
+#include "db.hpp"
+#include "fonts.hpp"
+#include "imgui.h"
+#include "seed.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+    std::vector<int> rows = {100, 1000, 10000, 100000};
+    int frames = 300;
+    int width = 1280;
+    int height = 800;
+    std::string dbPath = "ui-bench.db";
+};
+
+struct Scenario
+{
+    const char *name;
+    void (*render)();
+};
+
+// Each panel is measured on its own, in a window covering the display
+static const Scenario scenarios[] = {
+    {"Product list", renderProductList},
+    {"Search", renderSearchProduct},
+    {"Update", renderUpdateProduct},
+    {"Delete", renderDeleteProduct},
+};
+
+struct FrameStats
+{
+    double firstMs = 0.0; // includes the initial load of the panel's data
+    std::vector<double> ms;
+    int vertices = 0;
+    int indices = 0;
+    int commands = 0;
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: inventory-ui-bench [--rows N[,N...]] [--frames N] [--size WxH] [--db FILE]\n"
+                 "\n"
+                 "  --rows     catalogue sizes to seed (default 100,1000,10000,100000)\n"
+                 "  --frames   measured frames per panel (default 300)\n"
+                 "  --size     display size (default 1280x800)\n"
+                 "  --db       scratch database, recreated for every size (default ui-bench.db)\n";
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--rows" && i + 1 < argc)
+        {
+            options.rows.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ','))
+                options.rows.push_back(std::atoi(item.c_str()));
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+            options.frames = std::atoi(argv[++i]);
+        else if (arg == "--size" && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2)
+                return false;
+        }
+        else if (arg == "--db" && i + 1 < argc)
+            options.dbPath = argv[++i];
+        else
+            return false;
+    }
+    return options.frames > 0 && !options.rows.empty();
+}
+
+// One frame: the panel in a window covering the display
+static void runFrame(const BenchOptions &options, const Scenario &scenario, FrameStats &stats, bool first)
+{
+    ImGuiIO &io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)options.width, (float)options.height);
+    io.DeltaTime = 1.0f / 60.0f;
+
+    // Same between-frame work as the app: new glyphs in product names grow the atlas
+    updateFonts();
+
+    Clock::time_point start = Clock::now();
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0, 0));
+    ImGui::SetNextWindowSize(io.DisplaySize);
+    if (ImGui::Begin(scenario.name, nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings))
+        scenario.render();
+    ImGui::End();
+    ImGui::Render();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    if (first)
+    {
+        stats.firstMs = ms;
+        return;
+    }
+    stats.ms.push_back(ms);
+
+    const ImDrawData *drawData = ImGui::GetDrawData();
+    stats.vertices = drawData->TotalVtxCount;
+    stats.indices = drawData->TotalIdxCount;
+    stats.commands = 0;
+    for (const ImDrawList *list : drawData->CmdLists)
+        stats.commands += list->CmdBuffer.Size;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    size_t i = std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    return values[i];
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    ImGui::StyleColorsDark();
+
+    // Same fonts and style as the app, so glyph and text costs match
+    initFonts(17.0f, uiGlyphs, false);
+    ImGuiStyle &style = ImGui::GetStyle();
+    style.WindowRounding = 8.0f;
+    style.FrameRounding = 6.0f;
+    style.FramePadding = ImVec2(12, 8);
+    style.ItemSpacing = ImVec2(12, 10);
+    style.WindowPadding = ImVec2(15, 15);
+
+    // Search for something that matches about a tenth of the catalogue
+    setSearchKeyword("Widget 1");
+
+    std::printf("%8s  %-13s %9s %9s %9s %9s %9s %9s %6s\n", "rows", "panel", "first ms", "avg ms", "p50 ms",
+                "p99 ms", "vertices", "indices", "cmds");
+
+    for (int rows : options.rows)
+    {
+        removeDatabaseFiles(options.dbPath);
+        if (!initDB(options.dbPath) || !seedCatalogue(rows))
+        {
+            std::cerr << "Failed to seed " << rows << " products" << std::endl;
+            return 1;
+        }
+        initPanels();
+
+        for (const Scenario &scenario : scenarios)
+        {
+            FrameStats stats;
+            runFrame(options, scenario, stats, true);
+            for (int f = 0; f < options.frames; ++f)
+                runFrame(options, scenario, stats, false);
+
+            double total = 0.0;
+            for (double ms : stats.ms)
+                total += ms;
+            std::printf("%8d  %-13s %9.3f %9.3f %9.3f %9.3f %9d %9d %6d\n", rows, scenario.name, stats.firstMs,
+                        total / stats.ms.size(), percentile(stats.ms, 0.5), percentile(stats.ms, 0.99),
+                        stats.vertices, stats.indices, stats.commands);
+        }
+
+        shutdownPanels();
+        closeDB();
+        removeDatabaseFiles(options.dbPath);
+    }
+
+    ImGui::DestroyContext();
+    return 0;
+}
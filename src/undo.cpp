@@ -0,0 +1,648 @@
+#include "undo.hpp"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// In-memory limits; whichever is hit first spills the oldest commands
+static const size_t maxMemoryCommands = 100;
+static const long maxMemoryChanges = 20000;
+
+struct Command
+{
+    std::string label;
+    std::vector<ProductChange> changes;
+    int64_t committedAt = 0; // lastCommitTime(); orders commands across processes
+};
+
+// Oldest at the front. What this process spilled is older than undoStack;
+// other processes sharing the journal may have spilled newer commands.
+static std::deque<Command> undoStack;
+// Next command to redo at the back
+static std::deque<Command> redoStack;
+static long memoryChanges = 0;
+
+static std::string spillPath;
+static int spilledCount = 0;
+static off_t spillSize = 0; // file size when spilledCount was last right
+
+// Undo and redo give rows new versions while the journal keeps the ones it
+// recorded. Per product: the recorded version of the state the row is in
+// now, and the version the row really has.
+struct VersionAlias
+{
+    int recorded;
+    int actual;
+};
+static std::unordered_map<int, VersionAlias> versionAliases;
+
+static Command openGroup;
+static int groupDepth = 0;
+static bool replaying = false; // undo/redo must not record their own changes
+static int observerHandle = 0;
+
+// ---------------------------------------------------------------------------
+// Spill file: a stack of records, each followed by its uint32 length so the
+// newest one can be read and truncated away without scanning the file. The
+// GUI and any number of CLI runs share it, so records are kept sorted by
+// commit time whoever spills them, and every access holds an exclusive
+// flock for its whole read-modify-write.
+
+static void putRaw(std::string &out, const void *data, size_t size)
+{
+    out.append(static_cast<const char *>(data), size);
+}
+
+static void putInt(std::string &out, int32_t value) { putRaw(out, &value, sizeof(value)); }
+static void putInt64(std::string &out, int64_t value) { putRaw(out, &value, sizeof(value)); }
+
+static void putString(std::string &out, const std::string &value)
+{
+    putInt(out, (int32_t)value.size());
+    out += value;
+}
+
+// Changes whose kind carries these flags store each product's category and
+// then its version after the other fields; older journals lack them
+static const int32_t withCategory = 0x100;
+static const int32_t withVersion = 0x200;
+static const int32_t changeFlags = withCategory | withVersion;
+
+// Version of an image from a journal that did not keep versions; replaying
+// it cannot check for conflicts and overwrites the row as before
+static const int unknownVersion = -1;
+
+static void putProduct(std::string &out, const Product &p)
+{
+    putInt(out, p.id);
+    putString(out, p.name);
+    putInt(out, p.quantity);
+    putInt64(out, p.price.cents);
+    putInt(out, p.reorderLevel);
+    putString(out, p.sku);
+    putInt(out, p.categoryId);
+    putInt(out, p.version);
+}
+
+class Reader
+{
+public:
+    explicit Reader(const std::string &data) : data(data) {}
+
+    bool raw(void *out, size_t size)
+    {
+        if (pos + size > data.size())
+            return false;
+        std::memcpy(out, data.data() + pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool integer(int &out)
+    {
+        int32_t value;
+        if (!raw(&value, sizeof(value)))
+            return false;
+        out = value;
+        return true;
+    }
+
+    bool integer64(int64_t &out)
+    {
+        return raw(&out, sizeof(out));
+    }
+
+    bool money(Money &out)
+    {
+        int64_t cents;
+        if (!integer64(cents))
+            return false;
+        out = Money::fromCents(cents);
+        return true;
+    }
+
+    bool string(std::string &out)
+    {
+        int size;
+        if (!integer(size) || size < 0 || pos + size > data.size())
+            return false;
+        out.assign(data, pos, size);
+        pos += size;
+        return true;
+    }
+
+    bool product(Product &p, int flags)
+    {
+        p.version = unknownVersion;
+        return integer(p.id) && string(p.name) && integer(p.quantity) &&
+               money(p.price) && integer(p.reorderLevel) && string(p.sku) &&
+               (!(flags & withCategory) || integer(p.categoryId)) &&
+               (!(flags & withVersion) || integer(p.version));
+    }
+
+    bool atEnd() const { return pos == data.size(); }
+
+private:
+    const std::string &data;
+    size_t pos = 0;
+};
+
+class LockedSpill
+{
+public:
+    LockedSpill() : fd(open(spillPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644))
+    {
+        if (fd >= 0 && flock(fd, LOCK_EX) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+        if (fd < 0)
+            std::cerr << "Cannot open undo journal " << spillPath << std::endl;
+    }
+    ~LockedSpill()
+    {
+        if (fd >= 0)
+            close(fd); // drops the lock
+    }
+
+    bool ok() const { return fd >= 0; }
+
+    off_t size() const
+    {
+        struct stat info;
+        return fstat(fd, &info) == 0 ? info.st_size : 0;
+    }
+
+    bool read(off_t offset, void *out, size_t length) const
+    {
+        return pread(fd, out, length, offset) == (ssize_t)length;
+    }
+
+    bool write(off_t offset, const std::string &data) const
+    {
+        return pwrite(fd, data.data(), data.size(), offset) == (ssize_t)data.size();
+    }
+
+    bool truncate(off_t length) const { return ftruncate(fd, length) == 0; }
+
+    // Size of the record that ends at `end`, or 0 if the file is damaged there
+    uint32_t recordLengthBefore(off_t end) const
+    {
+        uint32_t length = 0;
+        if (end < (off_t)sizeof(length) || !read(end - sizeof(length), &length, sizeof(length)) ||
+            length + sizeof(length) > (uint64_t)end)
+            return 0;
+        return length;
+    }
+
+    // The record ending at `end` without its length; start is where it begins
+    bool recordBefore(off_t end, std::string &record, off_t &start) const
+    {
+        uint32_t length = recordLengthBefore(end);
+        start = end - length - sizeof(length);
+        record.assign(length, '\0');
+        return length > 0 && read(start, &record[0], length);
+    }
+
+    int countRecords() const
+    {
+        int count = 0;
+        for (off_t end = size(); end > 0; ++count)
+        {
+            uint32_t length = recordLengthBefore(end);
+            if (length == 0)
+                return 0;
+            end -= length + sizeof(length);
+        }
+        return count;
+    }
+
+private:
+    int fd;
+};
+
+// Another process may have spilled or loaded commands since this one looked
+static void syncSpilledCount(const LockedSpill &file)
+{
+    off_t size = file.size();
+    if (size != spillSize)
+        spilledCount = file.countRecords();
+    spillSize = size;
+}
+
+static std::string encodeCommand(const Command &command)
+{
+    std::string record;
+    putString(record, command.label);
+    putInt(record, (int32_t)command.changes.size());
+    for (const ProductChange &change : command.changes)
+    {
+        putInt(record, change.kind | changeFlags);
+        putProduct(record, change.before);
+        putProduct(record, change.after);
+    }
+    putInt64(record, command.committedAt);
+    uint32_t length = (uint32_t)record.size();
+    putRaw(record, &length, sizeof(length));
+    return record;
+}
+
+// Records written before commit times were kept end after the changes and
+// sort as the oldest
+static bool decodeCommand(const std::string &record, Command &command)
+{
+    Reader reader(record);
+    int count = 0;
+    bool ok = reader.string(command.label) && reader.integer(count) && count >= 0;
+    for (int i = 0; ok && i < count; ++i)
+    {
+        ProductChange change;
+        int kind = 0;
+        ok = reader.integer(kind) && reader.product(change.before, kind) && reader.product(change.after, kind);
+        int plainKind = kind & ~changeFlags;
+        ok = ok && plainKind >= ProductChange::Added && plainKind <= ProductChange::Deleted;
+        if (!ok)
+            break;
+        change.kind = (ProductChange::Kind)plainKind;
+        command.changes.push_back(std::move(change));
+    }
+    return ok && (reader.atEnd() || (reader.integer64(command.committedAt) && reader.atEnd()));
+}
+
+static void spillCommand(const Command &command)
+{
+    LockedSpill file;
+    if (!file.ok())
+        return;
+    syncSpilledCount(file);
+
+    // Commands another process committed later move up above this one
+    off_t insertAt = file.size();
+    std::vector<std::string> newer;
+    while (insertAt > 0)
+    {
+        std::string record;
+        off_t start;
+        Command other;
+        if (!file.recordBefore(insertAt, record, start) || !decodeCommand(record, other) ||
+            other.committedAt <= command.committedAt)
+            break;
+        uint32_t length = (uint32_t)record.size();
+        putRaw(record, &length, sizeof(length));
+        newer.push_back(std::move(record));
+        insertAt = start;
+    }
+
+    std::string data = encodeCommand(command);
+    for (auto it = newer.rbegin(); it != newer.rend(); ++it)
+        data += *it;
+    if (!file.write(insertAt, data))
+    {
+        std::cerr << "Cannot write undo journal " << spillPath << std::endl;
+        spillSize = -1; // recount next time
+        return;
+    }
+    ++spilledCount;
+    spillSize = file.size();
+}
+
+// Move the newest spilled command back into memory
+static bool loadSpilledCommand()
+{
+    if (spilledCount == 0)
+        return false;
+
+    LockedSpill file;
+    if (!file.ok())
+        return false;
+    syncSpilledCount(file);
+    if (spilledCount == 0)
+        return false;
+
+    std::string record;
+    off_t start;
+    Command command;
+    if (!file.recordBefore(file.size(), record, start) || !decodeCommand(record, command))
+    {
+        std::cerr << "Undo journal " << spillPath << " is damaged; discarding it" << std::endl;
+        file.truncate(0);
+        spilledCount = 0;
+        spillSize = 0;
+        return false;
+    }
+
+    file.truncate(start);
+    --spilledCount;
+    spillSize = start;
+    memoryChanges += (long)command.changes.size();
+    undoStack.push_back(std::move(command));
+    return true;
+}
+
+// Label of the newest spilled command, read without loading its changes
+static bool spilledLabel(std::string &label)
+{
+    if (spilledCount == 0)
+        return false;
+
+    LockedSpill file;
+    if (!file.ok())
+        return false;
+    syncSpilledCount(file);
+
+    off_t end = file.size();
+    uint32_t length = file.recordLengthBefore(end);
+    off_t start = end - length - sizeof(length);
+    int32_t size = 0;
+    if (length < sizeof(size) || !file.read(start, &size, sizeof(size)) || size < 0 ||
+        (uint32_t)size > length - sizeof(size))
+        return false;
+    label.assign(size, '\0');
+    return file.read(start + sizeof(size), &label[0], size);
+}
+
+// ---------------------------------------------------------------------------
+
+// A single command larger than the whole budget goes to disk as well; it
+// comes back only while undo applies it
+static void trimMemory()
+{
+    while (undoStack.size() > maxMemoryCommands ||
+           (memoryChanges > maxMemoryChanges && !undoStack.empty()))
+    {
+        spillCommand(undoStack.front());
+        memoryChanges -= (long)undoStack.front().changes.size();
+        undoStack.pop_front();
+    }
+
+    // Redo entries furthest from the present are simply forgotten
+    while (redoStack.size() > maxMemoryCommands ||
+           (memoryChanges > maxMemoryChanges && !redoStack.empty()))
+    {
+        memoryChanges -= (long)redoStack.front().changes.size();
+        redoStack.pop_front();
+    }
+}
+
+static void pushCommand(Command &&command)
+{
+    if (command.changes.empty())
+        return;
+
+    // A new action makes the undone future unreachable
+    for (const Command &c : redoStack)
+        memoryChanges -= (long)c.changes.size();
+    redoStack.clear();
+
+    command.committedAt = lastCommitTime();
+    memoryChanges += (long)command.changes.size();
+    undoStack.push_back(std::move(command));
+    trimMemory();
+}
+
+static int liveVersion(int id, int recorded)
+{
+    auto it = versionAliases.find(id);
+    return it != versionAliases.end() && it->second.recorded == recorded ? it->second.actual : recorded;
+}
+
+static std::string describe(const ProductChange &change)
+{
+    switch (change.kind)
+    {
+    case ProductChange::Added:
+        return "Add '" + change.after.name + "'";
+    case ProductChange::Deleted:
+        return "Delete '" + change.before.name + "'";
+    default:
+        return "Update '" + change.after.name + "'";
+    }
+}
+
+static void onProductChange(const ProductChange &change)
+{
+    if (replaying)
+        return;
+
+    if (groupDepth > 0)
+        openGroup.changes.push_back(change);
+    else
+        pushCommand({describe(change), {change}});
+}
+
+void initUndo(const std::string &path)
+{
+    if (observerHandle)
+        return;
+
+    spillPath = path;
+    LockedSpill file;
+    if (file.ok())
+        syncSpilledCount(file);
+    observerHandle = addProductObserver(onProductChange);
+}
+
+void shutdownUndo()
+{
+    if (!observerHandle)
+        return;
+
+    removeProductObserver(observerHandle);
+    observerHandle = 0;
+
+    groupDepth = 0;
+    pushCommand(std::move(openGroup));
+    openGroup = {};
+
+    // Keep the whole undo history for the next session, with the versions
+    // undo and redo gave the rows; the aliases themselves are not saved
+    for (Command &command : undoStack)
+    {
+        for (ProductChange &change : command.changes)
+        {
+            change.before.version = liveVersion(change.before.id, change.before.version);
+            change.after.version = liveVersion(change.after.id, change.after.version);
+        }
+        spillCommand(command);
+    }
+    undoStack.clear();
+    redoStack.clear();
+    versionAliases.clear();
+    memoryChanges = 0;
+}
+
+void beginUndoGroup(const std::string &label)
+{
+    if (groupDepth++ == 0)
+        openGroup = {label, {}};
+}
+
+void endUndoGroup()
+{
+    if (groupDepth > 0 && --groupDepth == 0)
+    {
+        pushCommand(std::move(openGroup));
+        openGroup = {};
+    }
+}
+
+void cancelUndoGroup()
+{
+    if (groupDepth > 0 && --groupDepth == 0)
+        openGroup = {};
+}
+
+bool canUndo()
+{
+    return groupDepth == 0 && (!undoStack.empty() || spilledCount > 0);
+}
+
+bool canRedo()
+{
+    return groupDepth == 0 && !redoStack.empty();
+}
+
+std::string undoLabel()
+{
+    std::string label;
+    if (!undoStack.empty())
+        label = undoStack.back().label;
+    else
+        spilledLabel(label);
+    return label;
+}
+
+std::string redoLabel()
+{
+    return redoStack.empty() ? "" : redoStack.back().label;
+}
+
+// Move one row from the image `from` to the image `to`; an image with id -1
+// is an absent row. The write happens only while the row is still as the
+// journal left it, or as this replay already left it (rows).
+static UpdateResult replayChange(const Product &from, const Product &to, std::unordered_map<int, VersionAlias> &rows)
+{
+    int id = from.id >= 0 ? from.id : to.id;
+    auto replayed = rows.find(id);
+    int expected = replayed != rows.end() ? replayed->second.actual : liveVersion(id, from.version);
+    Product current = getProductById(id);
+    int version = unknownVersion;
+
+    if (from.id < 0)
+    {
+        if (current.id >= 0)
+            return UpdateResult::Conflict;
+        if (!restoreProduct(to))
+            return UpdateResult::Failed;
+        version = to.version + 1; // restoreProduct bumps it
+    }
+    else if (current.id < 0)
+        return UpdateResult::NotFound;
+    else if (expected != unknownVersion && current.version != expected)
+        return UpdateResult::Conflict;
+    else if (to.id < 0)
+    {
+        if (!deleteProduct(id))
+            return UpdateResult::Failed;
+    }
+    else
+    {
+        Product target = to;
+        target.version = current.version;
+        UpdateResult result = updateProductIfUnchanged(target, current);
+        if (result != UpdateResult::Updated)
+            return result;
+        version = current.version;
+    }
+
+    rows[id] = {to.version, version};
+    return UpdateResult::Updated;
+}
+
+// Undo walks the changes backwards, redo forwards; all or nothing. A row
+// changed by anyone else since the command was recorded is a conflict, and
+// nothing is written.
+static bool applyCommand(const Command &command, bool reverse)
+{
+    if (!beginTransaction())
+        return false;
+
+    replaying = true;
+    UpdateResult result = UpdateResult::Updated;
+    std::unordered_map<int, VersionAlias> rows;
+    size_t n = command.changes.size();
+    size_t i = 0;
+    for (; result == UpdateResult::Updated && i < n; ++i)
+    {
+        const ProductChange &change = command.changes[reverse ? n - 1 - i : i];
+        result = reverse ? replayChange(change.after, change.before, rows)
+                         : replayChange(change.before, change.after, rows);
+    }
+
+    // The changes reach observers at COMMIT, which is still replaying
+    if (result == UpdateResult::Updated && commitTransaction())
+    {
+        replaying = false;
+        for (const auto &row : rows)
+        {
+            if (row.second.actual == unknownVersion)
+                versionAliases.erase(row.first); // deleted
+            else
+                versionAliases[row.first] = row.second;
+        }
+        return true;
+    }
+
+    rollbackTransaction();
+    replaying = false;
+    std::cerr << "Cannot " << (reverse ? "undo" : "redo") << " '" << command.label << "'";
+    if (result == UpdateResult::Conflict || result == UpdateResult::NotFound)
+    {
+        const ProductChange &change = command.changes[reverse ? n - i : i - 1];
+        const Product &from = reverse ? change.after : change.before;
+        const std::string &name = from.id >= 0 ? from.name : (reverse ? change.before : change.after).name;
+        std::cerr << ": '" << name << "' was "
+                  << (result == UpdateResult::Conflict ? "changed" : "deleted") << " by someone else since";
+    }
+    std::cerr << std::endl;
+    return false;
+}
+
+bool undo()
+{
+    if (!canUndo() || (undoStack.empty() && !loadSpilledCommand()))
+        return false;
+
+    if (!applyCommand(undoStack.back(), true))
+        return false;
+
+    redoStack.push_back(std::move(undoStack.back()));
+    undoStack.pop_back();
+    trimMemory();
+    return true;
+}
+
+bool redo()
+{
+    if (!canRedo() || !applyCommand(redoStack.back(), false))
+        return false;
+
+    // Re-applied now, so it sorts after whatever was committed meanwhile
+    redoStack.back().committedAt = lastCommitTime();
+    undoStack.push_back(std::move(redoStack.back()));
+    redoStack.pop_back();
+    trimMemory();
+    return true;
+}
+
+UndoStats getUndoStats()
+{
+    return {(int)undoStack.size(), spilledCount, (int)redoStack.size(), memoryChanges};
+}